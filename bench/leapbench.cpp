@@ -0,0 +1,576 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief leapbench : time the j.leapmotion output paths without Max
+ *
+ * @details Frames are loaded from recorded files, generated (see SyntheticSource) or read from
+ * a connected controller when built with the Leap SDK, then each path runs over them :
+ * lists, packed and matrix output, bones as lists and as a matrix, joint solving (against the same math
+ * done bone by bone with Leap::Matrix), signal sampling, recording and replay decoding
+ * (and extraction of live frames). For each path the driver reports the time, the heap
+ * allocations, the gensym calls and the outlet calls per frame, as a table or as JSON.
+ * A path looking a symbol up or allocating once its buffers are warm is a regression :
+ * the driver then exits with 1.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FrameOutput.h"
+#include "FrameFile.h"
+#include "ReplaySource.h"
+#include "SyntheticSource.h"
+#include "SignalRamp.h"
+#include "BangStats.h"
+#include "JointSolver.h"
+#include "FrameFilter.h"
+#include "FramePredictor.h"
+#include "TrajectoryStore.h"
+#include "LeapMath.h"
+
+#ifdef LEAPBENCH_LIVE
+#include "LiveSource.h"
+#include <chrono>
+#include <thread>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include <vector>
+
+/// heap allocations, counted by replacing the global operator new
+static std::atomic<uint64_t> s_allocations(0);
+
+void *operator new(size_t size)
+{
+    s_allocations++;
+
+    if (void *p = malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+/// quaternion of a rotation matrix, the usual way : from its largest diagonal term
+static void matrixToQuaternion(const Leap::Matrix &m, float *q)
+{
+    const float trace = m.xBasis.x + m.yBasis.y + m.zBasis.z;
+
+    if (trace > 0.f)
+    {
+        const float s = 2.f * sqrtf(1.f + trace);
+        q[0] = 0.25f * s;
+        q[1] = (m.yBasis.z - m.zBasis.y) / s;
+        q[2] = (m.zBasis.x - m.xBasis.z) / s;
+        q[3] = (m.xBasis.y - m.yBasis.x) / s;
+    }
+    else if (m.xBasis.x > m.yBasis.y && m.xBasis.x > m.zBasis.z)
+    {
+        const float s = 2.f * sqrtf(1.f + m.xBasis.x - m.yBasis.y - m.zBasis.z);
+        q[0] = (m.yBasis.z - m.zBasis.y) / s;
+        q[1] = 0.25f * s;
+        q[2] = (m.yBasis.x + m.xBasis.y) / s;
+        q[3] = (m.zBasis.x + m.xBasis.z) / s;
+    }
+    else if (m.yBasis.y > m.zBasis.z)
+    {
+        const float s = 2.f * sqrtf(1.f - m.xBasis.x + m.yBasis.y - m.zBasis.z);
+        q[0] = (m.zBasis.x - m.xBasis.z) / s;
+        q[1] = (m.yBasis.x + m.xBasis.y) / s;
+        q[2] = 0.25f * s;
+        q[3] = (m.zBasis.y + m.yBasis.z) / s;
+    }
+    else
+    {
+        const float s = 2.f * sqrtf(1.f - m.xBasis.x - m.yBasis.y + m.zBasis.z);
+        q[0] = (m.xBasis.y - m.yBasis.x) / s;
+        q[1] = (m.zBasis.x + m.xBasis.z) / s;
+        q[2] = (m.zBasis.y + m.yBasis.z) / s;
+        q[3] = 0.25f * s;
+    }
+}
+
+/// the basis of a bone row as a Leap::Matrix, made right-handed
+static Leap::Matrix boneMatrix(const BoneTable &bones, uint32_t row)
+{
+    Leap::Matrix m(Leap::Vector(bones.value(kBoneBasisXX, row), bones.value(kBoneBasisXY, row), bones.value(kBoneBasisXZ, row)),
+                   Leap::Vector(bones.value(kBoneBasisYX, row), bones.value(kBoneBasisYY, row), bones.value(kBoneBasisYZ, row)),
+                   Leap::Vector(bones.value(kBoneBasisZX, row), bones.value(kBoneBasisZY, row), bones.value(kBoneBasisZZ, row)));
+
+    if (m.xBasis.dot(m.yBasis.cross(m.zBasis)) < 0.f)
+        m.xBasis = -m.xBasis;
+
+    return m;
+}
+
+/// what JointSolver computes, one joint at a time with Leap::Matrix products
+static void naiveJoints(const FrameSnapshot &snapshot, std::vector<float> &joints)
+{
+    const HandTable &hands = snapshot.hands;
+    const BoneTable &bones = snapshot.bones;
+
+    joints.clear();
+
+    for (uint32_t h = 0, bone = 0; h < hands.count() && bone < bones.count(); h++)
+    {
+        const int32_t handId = hands.integer(kHandId, h);
+        uint32_t last = bone;
+
+        while (last < bones.count() && bones.integer(kBoneHandId, last) == handId)
+            last++;
+
+        if (last == bone)
+            continue;
+
+        const Leap::Vector direction(hands.value(kHandDirectionX, h), hands.value(kHandDirectionY, h), hands.value(kHandDirectionZ, h));
+        const Leap::Vector normal(hands.value(kHandNormalX, h), hands.value(kHandNormalY, h), hands.value(kHandNormalZ, h));
+        const Leap::Matrix palm(normal.cross(direction), -normal, -direction);
+        const Leap::Matrix arm = boneMatrix(bones, last - 1);
+
+        Leap::Matrix local[2] = {arm, arm.rigidInverse() * palm};
+        float q[4];
+
+        for (int j = 0; j < 2; j++)
+        {
+            matrixToQuaternion(local[j], q);
+            joints.insert(joints.end(), q, q + 4);
+        }
+
+        for (uint32_t b = bone; b < last - 1; b++)
+        {
+            const Leap::Matrix parent = bones.integer(kBoneType, b) == kBoneMetacarpal ? palm : boneMatrix(bones, b - 1);
+
+            matrixToQuaternion(parent.rigidInverse() * boneMatrix(bones, b), q);
+            joints.insert(joints.end(), q, q + 4);
+        }
+
+        bone = last;
+    }
+}
+
+struct Result
+{
+    const char  *path;
+    double      nsPerFrame;
+    double      allocationsPerFrame;
+    double      gensymPerFrame;
+    double      outletsPerFrame;
+    double      atomsPerFrame;
+};
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage : leapbench [--repeat count] [--json file|-] [--live frames]\n"
+            "                  [--synthetic hands fingers tools gestures frames] [file.jlm ...]\n");
+}
+
+/// read every frame of a source
+static void load(FrameSource &source, std::vector<FrameSnapshot> &frames)
+{
+    FrameSnapshot snapshot;
+
+    while (source.read(snapshot))
+    {
+        frames.push_back(FrameSnapshot());
+        frames.back().copy(snapshot);
+    }
+}
+
+/// run a path over count frames once to warm its buffers up, then repeat times measured
+template<class Path>
+static Result run(const char *name, size_t count, long repeat, Path path)
+{
+    for (size_t i = 0; i < count; i++)
+        path(i);
+
+    const t_shim_counters before = shim_counters;
+    const uint64_t allocations = s_allocations;
+    const int64_t start = statClock();
+
+    for (long r = 0; r < repeat; r++)
+        for (size_t i = 0; i < count; i++)
+            path(i);
+
+    const int64_t elapsed = statClock() - start;
+    const double frames = (double)count * repeat;
+
+    Result result;
+    result.path = name;
+    result.nsPerFrame = elapsed * 1000. / frames;
+    result.allocationsPerFrame = (s_allocations - allocations) / frames;
+    result.gensymPerFrame = (shim_counters.gensym - before.gensym) / frames;
+    result.outletsPerFrame = (shim_counters.outlets - before.outlets) / frames;
+    result.atomsPerFrame = (shim_counters.atoms - before.atoms) / frames;
+    return result;
+}
+
+static void writeJson(FILE *file, const std::vector<Result> &results, size_t frames, long repeat)
+{
+    fprintf(file, "{\n  \"frames\": %lu,\n  \"passes\": %ld,\n  \"results\": [\n", (unsigned long)frames, repeat);
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        fprintf(file, "    {\"path\": \"%s\", \"ns_per_frame\": %.1f, \"allocations_per_frame\": %.3f, "
+                "\"gensym_per_frame\": %.3f, \"outlets_per_frame\": %.3f, \"atoms_per_frame\": %.3f}%s\n",
+                r.path, r.nsPerFrame, r.allocationsPerFrame, r.gensymPerFrame, r.outletsPerFrame, r.atomsPerFrame,
+                i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<FrameSnapshot> frames;
+    const char *json = NULL;
+    long repeat = 10;
+
+#ifdef LEAPBENCH_LIVE
+    Leap::Controller *controller = NULL;
+    std::vector<Leap::Frame> liveFrames;
+#endif
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+            repeat = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+            json = argv[++i];
+        else if (!strcmp(argv[i], "--synthetic") && i + 5 < argc)
+        {
+            SyntheticSettings settings;
+            settings.hands = atol(argv[++i]);
+            settings.fingers = atol(argv[++i]);
+            settings.tools = atol(argv[++i]);
+            settings.gestures = atol(argv[++i]);
+            settings.frames = atol(argv[++i]);
+
+            SyntheticSource source(settings);
+            load(source, frames);
+        }
+#ifdef LEAPBENCH_LIVE
+        else if (!strcmp(argv[i], "--live") && i + 1 < argc)
+        {
+            // poll the controller until enough frames have been read, keeping them to time their extraction
+            if (!controller)
+                controller = new Leap::Controller;
+
+            LiveSource source(*controller);
+            FrameSnapshot snapshot;
+            const long count = atol(argv[++i]);
+
+            for (long n = 0; n < count; )
+            {
+                if (source.read(snapshot))
+                {
+                    frames.push_back(FrameSnapshot());
+                    frames.back().copy(snapshot);
+                    liveFrames.push_back(controller->frame());
+                    n++;
+                }
+                else
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+#endif
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+        {
+            ReplaySource source;
+
+            if (!source.replay().open(argv[i]))
+            {
+                fprintf(stderr, "leapbench : can't read %s\n", argv[i]);
+                return 2;
+            }
+
+            load(source, frames);
+        }
+    }
+
+    if (frames.empty() || repeat < 1)
+    {
+        usage();
+        return 2;
+    }
+
+    // what j.leapmotion prepares when it is instantiated
+    t_symbol *symbols[kSymbols];
+    void *outlets[kOutlets] = {NULL};
+    std::vector<t_atom> packed;
+    std::vector<float> matrix;
+    std::vector<float> boneCells;
+    std::vector<float> naive;
+    JointSolver solver;
+    std::vector<char> record;
+
+    encodeSymbols(symbols);
+
+    // the frames as a recorded file, to time decoding
+    std::vector<uint64_t> offsets;
+    std::vector<char> file;
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        offsets.push_back(file.size());
+        file.resize(file.size() + frameRecordSize(frames[i]));
+        writeFrameRecord(frames[i], &file[offsets.back()]);
+    }
+
+    std::vector<Result> results;
+
+    results.push_back(run("lists", frames.size(), repeat, [&](size_t i)
+    {
+        outputLists(frames[i], symbols, outlets);
+    }));
+
+    results.push_back(run("packed", frames.size(), repeat, [&](size_t i)
+    {
+        outputPacked(frames[i], symbols, packed, outlets[kOutletFrame]);
+    }));
+
+    // the frame bangs, frame info and gestures stay lists in matrix mode
+    results.push_back(run("matrix", frames.size(), repeat, [&](size_t i)
+    {
+        const long rows = matrixRows(frames[i]);
+
+        if (matrix.size() < (size_t)(rows * kMatrixPlanes))
+            matrix.resize(rows * kMatrixPlanes);
+
+        outputFrameStart(frames[i], symbols, outlets);
+
+        if (rows)
+            encodeMatrix(frames[i], &matrix[0], kMatrixPlanes);
+
+        outputFrameEnd(frames[i], symbols, outlets);
+    }));
+
+    results.push_back(run("bones", frames.size(), repeat, [&](size_t i)
+    {
+        outputBones(frames[i], symbols, outlets[kOutletBone]);
+    }));
+
+    results.push_back(run("bonemat", frames.size(), repeat, [&](size_t i)
+    {
+        const long rows = frames[i].bones.count();
+
+        if (boneCells.size() < (size_t)(rows * kBonePlanes))
+            boneCells.resize(rows * kBonePlanes);
+
+        if (rows)
+            encodeBoneMatrix(frames[i], &boneCells[0], kBonePlanes);
+    }));
+
+    results.push_back(run("joints", frames.size(), repeat, [&](size_t i)
+    {
+        solver.solve(frames[i]);
+        outputJoints(solver.joints(), symbols, outlets[kOutletBone]);
+    }));
+
+    results.push_back(run("solve", frames.size(), repeat, [&](size_t i)
+    {
+        solver.solve(frames[i]);
+    }));
+
+    naive.reserve(LEAP_HAND_JOINTS_MAX * 4 * 8);
+
+    results.push_back(run("naive", frames.size(), repeat, [&](size_t i)
+    {
+        naiveJoints(frames[i], naive);
+    }));
+
+    // smoothing works on a copy of each frame, as j.leapmotion does
+    FrameSnapshot filtered;
+    FrameFilter filter;
+    FilterSettings filterSettings;
+
+    filterSettings.mode = kFilterOneEuro;
+    filter.setup(filterSettings);
+
+    results.push_back(run("euro", frames.size(), repeat, [&](size_t i)
+    {
+        filtered.copy(frames[i]);
+        filter.apply(filtered);
+    }));
+
+    filterSettings.mode = kFilterKalman;
+    filter.setup(filterSettings);
+
+    results.push_back(run("kalman", frames.size(), repeat, [&](size_t i)
+    {
+        filtered.copy(frames[i]);
+        filter.apply(filtered);
+    }));
+
+    // 20 ms ahead, bones included
+    FramePredictor predictor;
+    PredictSettings predictSettings;
+
+    predictSettings.horizon = 20.;
+    predictor.setup(predictSettings);
+
+    results.push_back(run("predict", frames.size(), repeat, [&](size_t i)
+    {
+        filtered.copy(frames[i]);
+        predictor.apply(filtered);
+    }));
+
+    // about 2 s of history, then a 500 ms query of every hand once per frame
+    TrajectoryStore trajectories;
+    TrajectoryStats stats;
+    t_atom trajectory[LEAP_TRAJECTORY_ATOMS];
+
+    trajectories.setup(256);
+
+    results.push_back(run("history", frames.size(), repeat, [&](size_t i)
+    {
+        trajectories.push(frames[i]);
+    }));
+
+    results.push_back(run("trajectory", frames.size(), repeat, [&](size_t i)
+    {
+        const TrajectoryBank &hands = trajectories.hands();
+
+        trajectories.push(frames[i]);
+
+        for (uint32_t slot = 0; slot < hands.capacity(); slot++)
+        {
+            if (hands.id(slot) == SlotPool::kFreeSlot)
+                continue;
+
+            hands.queryStats(slot, 500., stats);
+            outlet_anything(outlets[kOutletHand], symbols[kSymbolTrajectory], encodeTrajectory(hands.id(slot), stats, trajectory), trajectory);
+        }
+    }));
+
+    // every signal channel of the first hand, one 64 samples vector per frame at 120 fps
+    long channels[kSignalChannels];
+    double values[kSignalChannels] = {0.};
+    std::vector<double> samples(kSignalChannels * 64);
+    double *outs[kSignalChannels];
+    SignalRamp ramp;
+
+    for (long c = 0; c < kSignalChannels; c++)
+    {
+        channels[c] = c;
+        outs[c] = &samples[c * 64];
+    }
+
+    results.push_back(run("signals", frames.size(), repeat, [&](size_t i)
+    {
+        if (sampleSignals(frames[i], kSignalHandFirst, channels, kSignalChannels, values))
+            ramp.pushTarget(values, kSignalChannels, 1. / 120.);
+
+        ramp.process(outs, kSignalChannels, 64, 44100.);
+    }));
+
+    results.push_back(run("record", frames.size(), repeat, [&](size_t i)
+    {
+        const uint32_t size = frameRecordSize(frames[i]);
+
+        if (record.size() < size)
+            record.resize(size);
+
+        writeFrameRecord(frames[i], &record[0]);
+    }));
+
+    FrameSnapshot decoded;
+
+    results.push_back(run("replay", frames.size(), repeat, [&](size_t i)
+    {
+        readFrameRecord(&file[offsets[i]], file.size() - offsets[i], decoded);
+    }));
+
+#ifdef LEAPBENCH_LIVE
+    if (!liveFrames.empty())
+    {
+        FrameSnapshot extracted;
+        GestureProgressCache circles;
+
+        results.push_back(run("extract", liveFrames.size(), repeat, [&](size_t i)
+        {
+            extractFrame(extracted, liveFrames[i], &circles);
+        }));
+    }
+#endif
+
+    int status = 0;
+
+    if (json)
+    {
+        FILE *output = strcmp(json, "-") ? fopen(json, "w") : stdout;
+
+        if (!output)
+        {
+            fprintf(stderr, "leapbench : can't write %s\n", json);
+            return 2;
+        }
+
+        writeJson(output, results, frames.size(), repeat);
+
+        if (output != stdout)
+            fclose(output);
+    }
+
+    if (!json || strcmp(json, "-"))
+    {
+        printf("%lu frames, %ld passes\n", (unsigned long)frames.size(), repeat);
+        printf("%-10s %12s %12s %12s %12s %12s\n", "path", "ns/frame", "allocs/frame", "gensym/frame", "outlets/frame", "atoms/frame");
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result &r = results[i];
+            printf("%-10s %12.1f %12.3f %12.3f %12.3f %12.3f\n",
+                   r.path, r.nsPerFrame, r.allocationsPerFrame, r.gensymPerFrame, r.outletsPerFrame, r.atomsPerFrame);
+        }
+    }
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (results[i].gensymPerFrame > 0.)
+        {
+            fprintf(stderr, "leapbench : the %s path looks symbols up while outputting frames\n", results[i].path);
+            status = 1;
+        }
+
+        if (results[i].allocationsPerFrame > 0.)
+        {
+            fprintf(stderr, "leapbench : the %s path allocates once warm\n", results[i].path);
+            status = 1;
+        }
+    }
+
+#ifdef LEAPBENCH_LIVE
+    delete controller;
+#endif
+
+    return status;
+}
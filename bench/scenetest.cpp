@@ -0,0 +1,270 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief scenetest : check the accelerated scene queries against the brute force loop over the objects
+ *
+ * @details Random scenes of every shape are built, moved (refitting the bounding volume hierarchy),
+ * grown (rebuilding it) and reset, then rays, contact spheres and swept contact spheres are tested
+ * through the scene and through the virtual methods of each object. The closest ray hit, the objects
+ * touched and the times of impact have to match, with the bounding volume hierarchy and with the
+ * spatial hash. Built once with the SSE lanes and once with LEAP_SCENE_NO_SSE.
+ * Exits with 1 on the first mismatches.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "LeapScene.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+using namespace Leap;
+
+static uint32_t s_seed = 1;
+
+/// a small generator of our own : the scenes are the same with every C library
+static float randomFloat(float low, float high)
+{
+    s_seed = s_seed * 1664525u + 1013904223u;
+
+    return low + (high - low) * ((s_seed >> 8) / 16777216.f);
+}
+
+static Vector randomVector(float extent)
+{
+    return Vector(randomFloat(-extent, extent), randomFloat(-extent, extent), randomFloat(-extent, extent));
+}
+
+static Vector randomDirection()
+{
+    Vector direction;
+
+    do
+        direction = randomVector(1.f);
+    while (direction.magnitudeSquared() < 1e-4f);
+
+    return direction.normalized();
+}
+
+/// adds an object of each shape in turn with planes now and then, sized between small and large
+static void addObjects(Scene &scene, int count, float extent, float thinness)
+{
+    for (int i = 0; i < count; i++) {
+
+        SceneObject *object;
+
+        switch (i % 5) {
+
+            case 0: {
+                SceneBox *box = scene.AddObject<SceneBox>();
+                box->SetSize(Vector(randomFloat(.1f, 2.f), randomFloat(.1f, 2.f), randomFloat(.1f * thinness, 2.f * thinness)));
+                object = box;
+                break;
+            }
+            case 1: {
+                SceneSphere *sphere = scene.AddObject<SceneSphere>();
+                sphere->SetRadius(randomFloat(.1f, 1.f));
+                object = sphere;
+                break;
+            }
+            case 2: {
+                SceneCylinder *cylinder = scene.AddObject<SceneCylinder>();
+                cylinder->SetRadius(randomFloat(.1f, 1.f));
+                cylinder->SetHeight(randomFloat(.1f, 2.f));
+                object = cylinder;
+                break;
+            }
+            case 3: {
+                SceneDisk *disk = scene.AddObject<SceneDisk>();
+                disk->SetRadius(randomFloat(.1f, 1.f));
+                object = disk;
+                break;
+            }
+            default: {
+                if (i % 100 == 4)
+                    object = scene.AddObject<ScenePlane>();
+                else {
+                    SceneSphere *sphere = scene.AddObject<SceneSphere>();
+                    sphere->SetRadius(randomFloat(.1f, 1.f));
+                    object = sphere;
+                }
+            }
+        }
+
+        object->SetCenter(randomVector(extent));
+        object->SetRotation(randomDirection(), randomFloat(0.f, 6.f));
+        object->SetScale(randomFloat(.5f, 2.f));
+    }
+}
+
+static void moveObjects(Scene &scene, int count)
+{
+    for (int i = 0; i < count; i++) {
+
+        SceneObject *object = scene.GetObjectByIndex(int(randomFloat(0.f, 1.f) * scene.GetNumObjects()) % scene.GetNumObjects());
+
+        object->Translate(randomVector(2.f));
+
+        if (i % 3 == 0)
+            object->Rotate(randomDirection(), randomFloat(0.f, 1.f));
+
+        if (i % 7 == 0)
+            object->Scale(randomFloat(.8f, 1.25f));
+    }
+}
+
+static void clearContacts(Scene &scene)
+{
+    for (uint32_t i = 0; i < scene.GetNumObjects(); i++)
+        scene.GetObjectByIndex(i)->ClearHits();
+}
+
+/// counts a mismatch, printing the first ones
+static int s_mismatches = 0;
+
+static void mismatch(const char *query, int index, float expected, float found)
+{
+    if (s_mismatches++ < 10)
+        printf("%s mismatch : object %d, expected %g, found %g\n", query, index, expected, found);
+}
+
+/// the closest hit of the scene has to be as close as the closest hit of the objects
+static void testRay(const Scene &scene, const SceneRay &ray)
+{
+    float closest = FLT_MAX;
+    int closestIndex = -1;
+
+    for (uint32_t i = 0; i < scene.GetNumObjects(); i++) {
+
+        float distance = FLT_MAX;
+
+        if (scene.GetObjectByIndex(i)->TestRayHit(ray, distance) && distance < closest) {
+            closest = distance;
+            closestIndex = i;
+        }
+    }
+
+    const SceneObjectPtr &hit = scene.TestRayHit(ray);
+    float distance = FLT_MAX;
+
+    if (!hit)
+        distance = -1.f;
+    else if (!hit->TestRayHit(ray, distance))
+        distance = FLT_MAX;
+
+    // another object at the same distance is as good
+    if ((closestIndex < 0) != !hit || (hit && fabsf(distance - closest) > 1e-3f * (1.f + closest)))
+        mismatch("ray", closestIndex, closestIndex < 0 ? -1.f : closest, distance);
+}
+
+/// the scene has to touch the objects the sphere touches
+static void testContact(Scene &scene, const Vector &point)
+{
+    clearContacts(scene);
+    scene.TestContact(SceneContactPoint(point, 1));
+
+    for (uint32_t i = 0; i < scene.GetNumObjects(); i++) {
+
+        const SceneObjectPtr &object = scene.GetObjectByIndex(i);
+        const bool touched = object->TestSphereHit(point, scene.GetPointableRadius());
+
+        if (touched != (object->GetNumContacts() > 0))
+            mismatch("contact", i, touched, object->GetNumContacts() > 0);
+    }
+}
+
+/// the scene has to touch the objects the swept sphere touches, at the same time of impact
+static void testSweptContact(Scene &scene, const Vector &from, const Vector &to)
+{
+    clearContacts(scene);
+    scene.TestContact(SceneContactPoint(to, 1), &from);
+
+    for (uint32_t i = 0; i < scene.GetNumObjects(); i++) {
+
+        const SceneObjectPtr &object = scene.GetObjectByIndex(i);
+        float time = 1.f;
+        const bool touched = object->TestSweptSphereHit(from, to, scene.GetPointableRadius(), time);
+
+        if (touched != (object->GetNumContacts() > 0))
+            mismatch("swept contact", i, touched, object->GetNumContacts() > 0);
+        else if (touched && fabsf(object->GetContactPoint(0)->m_fTimeOfImpact - time) > 1e-6f)
+            mismatch("time of impact", i, time, object->GetContactPoint(0)->m_fTimeOfImpact);
+    }
+}
+
+static void testScene(Scene::eContactBroadPhase broadPhase, float cellSize)
+{
+    Scene scene;
+
+    scene.SetContactBroadPhase(broadPhase);
+    scene.SetContactCellSize(cellSize);
+
+    for (int pass = 0; pass < 2; pass++) {
+
+        // the second pass starts over to check a reset scene builds anew
+        scene.Reset();
+        addObjects(scene, 600, 30.f, 1.f);
+
+        for (int frame = 0; frame < 60; frame++) {
+
+            moveObjects(scene, 20);
+
+            // more objects rebuild the hierarchy
+            if (frame % 20 == 19)
+                addObjects(scene, 50, 30.f, 1.f);
+
+            for (int query = 0; query < 20; query++) {
+
+                SceneRay ray(randomVector(35.f), randomDirection());
+
+                // along an axis, the reciprocal of the direction has infinite components
+                if (query % 10 == 0)
+                    ray.m_vDirection = Vector(0.f, 0.f, query % 20 ? 1.f : -1.f);
+
+                testRay(scene, ray);
+
+                scene.SetPointableRadius(randomFloat(.1f, 3.f));
+                testContact(scene, randomVector(32.f));
+
+                const Vector from = randomVector(32.f);
+
+                scene.SetPointableRadius(randomFloat(.05f, .5f));
+                testSweptContact(scene, from, from + randomVector(3.f));
+            }
+        }
+    }
+
+    // thin objects crossed in one step have to be touched by the swept sphere
+    scene.Reset();
+    addObjects(scene, 300, 15.f, .05f);
+
+    for (int query = 0; query < 200; query++) {
+
+        const Vector from = randomVector(16.f);
+
+        scene.SetPointableRadius(randomFloat(.05f, .5f));
+        testSweptContact(scene, from, from + randomVector(6.f));
+    }
+}
+
+int main()
+{
+    testScene(Scene::kCBP_BoundingVolumes, 0.f);
+    testScene(Scene::kCBP_SpatialHash, 0.f);
+    testScene(Scene::kCBP_SpatialHash, .5f);
+
+    if (s_mismatches) {
+        printf("%d mismatches\n", s_mismatches);
+        return 1;
+    }
+
+    printf("the scene queries match the objects\n");
+    return 0;
+}
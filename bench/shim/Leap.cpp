@@ -0,0 +1,41 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief Leap.h shim : the few Leap API members util/LeapScene.cpp links against
+ *
+ * @details Only used to build the scene test without the Leap runtime. The scene queries
+ * only need LeapMath.h, which is header only : these members are reached from Scene::Update()
+ * alone, which the test never calls, so each of them aborts.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "Leap.h"
+
+#include <stdlib.h>
+
+namespace Leap {
+
+Interface::~Interface() {}
+
+int32_t Pointable::id() const { abort(); }
+bool Pointable::isValid() const { abort(); }
+Vector Pointable::tipPosition() const { abort(); }
+Vector Pointable::direction() const { abort(); }
+
+int PointableList::count() const { abort(); }
+bool PointableList::isEmpty() const { abort(); }
+Pointable PointableList::operator[](int) const { abort(); }
+
+bool HandList::isEmpty() const { abort(); }
+
+HandList Frame::hands() const { abort(); }
+PointableList Frame::pointables() const { abort(); }
+Pointable Frame::pointable(int32_t) const { abort(); }
+
+}
@@ -0,0 +1,90 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief ext.h shim : the few Max API types and functions the core code uses
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "ext.h"
+
+#include <map>
+#include <string>
+
+t_shim_counters shim_counters = {0, 0, 0};
+
+t_symbol *gensym(const char *name)
+{
+    // symbols live as long as the program, as in Max
+    static std::map<std::string, t_symbol*> table;
+
+    shim_counters.gensym++;
+
+    t_symbol *&symbol = table[name];
+
+    if (!symbol)
+    {
+        std::map<std::string, t_symbol*>::iterator it = table.find(name);
+        symbol = new t_symbol;
+        symbol->s_name = it->first.c_str();
+        symbol->s_thing = NULL;
+    }
+
+    return symbol;
+}
+
+t_max_err atom_setlong(t_atom *a, t_atom_long b)
+{
+    a->a_type = A_LONG;
+    a->a_w.w_long = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setfloat(t_atom *a, double b)
+{
+    a->a_type = A_FLOAT;
+    a->a_w.w_float = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setsym(t_atom *a, t_symbol *b)
+{
+    a->a_type = A_SYM;
+    a->a_w.w_sym = b;
+    return MAX_ERR_NONE;
+}
+
+t_atom_long atom_getlong(const t_atom *a)
+{
+    return a->a_type == A_LONG ? a->a_w.w_long : a->a_type == A_FLOAT ? (t_atom_long)a->a_w.w_float : 0;
+}
+
+double atom_getfloat(const t_atom *a)
+{
+    return a->a_type == A_FLOAT ? a->a_w.w_float : a->a_type == A_LONG ? (double)a->a_w.w_long : 0.;
+}
+
+t_symbol *atom_getsym(const t_atom *a)
+{
+    return a->a_type == A_SYM ? a->a_w.w_sym : gensym("");
+}
+
+void *outlet_bang(void *o)
+{
+    shim_counters.outlets++;
+    return NULL;
+}
+
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av)
+{
+    shim_counters.outlets++;
+    shim_counters.atoms += ac;
+    return NULL;
+}
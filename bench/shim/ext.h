@@ -0,0 +1,81 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief ext.h shim : the few Max API types and functions the core code uses
+ *
+ * @details Only used to build the core and the benchmark driver without the Max SDK.
+ * Symbols are interned as Max does it, and every gensym and outlet call is counted
+ * so the driver can check what the output paths ask from Max per frame.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __shim_ext_h__
+#define __shim_ext_h__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int64_t t_atom_long;
+typedef double t_atom_float;
+typedef long t_max_err;
+
+typedef struct _symbol
+{
+    const char  *s_name;
+    void        *s_thing;
+} t_symbol;
+
+typedef union word
+{
+    t_atom_long w_long;
+    float       w_float;
+    t_symbol    *w_sym;
+    void        *w_obj;
+} t_word;
+
+typedef struct atom
+{
+    short       a_type;
+    union word  a_w;
+} t_atom;
+
+enum e_max_atomtypes
+{
+    A_NOTHING = 0,
+    A_LONG,
+    A_FLOAT,
+    A_SYM
+};
+
+#define MAX_ERR_NONE 0
+
+t_symbol *gensym(const char *name);
+
+t_max_err atom_setlong(t_atom *a, t_atom_long b);
+t_max_err atom_setfloat(t_atom *a, double b);
+t_max_err atom_setsym(t_atom *a, t_symbol *b);
+
+t_atom_long atom_getlong(const t_atom *a);
+double atom_getfloat(const t_atom *a);
+t_symbol *atom_getsym(const t_atom *a);
+
+void *outlet_bang(void *o);
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av);
+
+/// shim counters
+struct t_shim_counters
+{
+    uint64_t    gensym;     // gensym calls
+    uint64_t    outlets;    // outlet_bang and outlet_anything calls
+    uint64_t    atoms;      // atoms sent through outlet_anything
+};
+
+extern t_shim_counters shim_counters;
+
+#endif // __shim_ext_h__
@@ -0,0 +1,118 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief BangStats : timing of the output path over a window of frames
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "BangStats.h"
+
+#include <algorithm>
+#include <chrono>
+
+int64_t statClock()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BangStats::BangStats() :
+m_window(0),
+m_frames(0),
+m_bangs(0),
+m_duplicates(0),
+m_minOffset(0),
+m_hasOffset(false)
+{
+    setWindow(100);
+}
+
+void BangStats::setWindow(long frames)
+{
+    m_window = frames < 1 ? 1 : frames;
+    m_samples.assign(kStatPhases * m_window, 0.);
+    m_sorted.assign(m_window, 0.);
+    reset();
+}
+
+void BangStats::addBang(bool duplicate)
+{
+    m_bangs++;
+
+    if (duplicate)
+        m_duplicates++;
+}
+
+bool BangStats::addFrame(const double *phases)
+{
+    if (m_frames == m_window)
+        return true;
+
+    for (long p = 0; p < kStatPhases; p++)
+        m_samples[p * m_window + m_frames] = phases[p];
+
+    return ++m_frames == m_window;
+}
+
+double BangStats::frameAge(int64_t timestamp, int64_t fetched)
+{
+    // the Leap service clock is not ours : the difference between both clocks is only
+    // meaningful relatively to the smallest difference seen so far (the freshest frame)
+    const int64_t offset = fetched - timestamp;
+
+    if (!m_hasOffset || offset < m_minOffset)
+    {
+        m_minOffset = offset;
+        m_hasOffset = true;
+    }
+
+    return (offset - m_minOffset) * 0.001;
+}
+
+void BangStats::summary(long phase, double &min, double &mean, double &p99)
+{
+    min = mean = p99 = 0.;
+
+    if (!m_frames)
+        return;
+
+    const double *samples = &m_samples[phase * m_window];
+    double sum = 0.;
+
+    min = samples[0];
+
+    for (long i = 0; i < m_frames; i++)
+    {
+        m_sorted[i] = samples[i];
+        sum += samples[i];
+
+        if (samples[i] < min)
+            min = samples[i];
+    }
+
+    mean = sum / m_frames;
+
+    // nearest rank percentile
+    const long rank = (long)((m_frames * 99 + 99) / 100) - 1;
+    std::nth_element(m_sorted.begin(), m_sorted.begin() + rank, m_sorted.begin() + m_frames);
+    p99 = m_sorted[rank];
+}
+
+double BangStats::duplicateRatio() const
+{
+    return m_bangs ? (double)m_duplicates / m_bangs : 0.;
+}
+
+void BangStats::reset()
+{
+    m_frames = 0;
+    m_bangs = 0;
+    m_duplicates = 0;
+}
@@ -0,0 +1,79 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief BangStats : timing of the output path over a window of frames
+ *
+ * @details Each output frame adds one duration per phase. Once the window is full
+ * min, mean and 99th percentile are available for every phase, then the window restarts.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __BangStats_h__
+#define __BangStats_h__
+
+#include <stdint.h>
+#include <vector>
+
+/// measured phases (all in milliseconds)
+enum eStatPhase
+{
+    kPhaseFetch,        // getting the frame from the controller or from the push ring
+    kPhaseHands,        // extracting hands (without their fingers)
+    kPhaseFingers,      // extracting fingers
+    kPhaseTools,        // extracting tools
+    kPhaseGestures,     // extracting gestures
+    kPhaseOutput,       // encoding and outlet calls (includes the patch downstream)
+    kPhaseAge,          // how late the frame is compared to the freshest frame seen
+    kStatPhases
+};
+
+/// a monotonic clock in microseconds
+int64_t statClock();
+
+class BangStats
+{
+public:
+    BangStats();
+
+    /// number of output frames summarized at once (the window restarts)
+    void setWindow(long frames);
+
+    long window() const { return m_window; }
+
+    /// count a bang (or a pushed frame) and whether it was the same frame as the previous one
+    void addBang(bool duplicate);
+
+    /// add the kStatPhases durations of an output frame, return true when the window is full (then report and reset)
+    bool addFrame(const double *phases);
+
+    /// measure the age of a frame from its timestamp (service clock) and the local time it was fetched at
+    double frameAge(int64_t timestamp, int64_t fetched);
+
+    /// summary of a phase over the full window
+    void summary(long phase, double &min, double &mean, double &p99);
+
+    /// duplicate bangs / all bangs over the window
+    double duplicateRatio() const;
+
+    /// start a new window
+    void reset();
+
+private:
+    long                    m_window;
+    long                    m_frames;
+    long                    m_bangs;
+    long                    m_duplicates;
+    int64_t                 m_minOffset;    // smallest fetch time - timestamp seen, the freshest frame
+    bool                    m_hasOffset;
+    std::vector<double>     m_samples;      // kStatPhases runs of m_window durations
+    std::vector<double>     m_sorted;       // scratch to find percentiles
+};
+
+#endif // __BangStats_h__
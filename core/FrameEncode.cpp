@@ -0,0 +1,339 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameEncode : turn FrameSnapshot rows into Max atoms
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FrameEncode.h"
+
+void encodeSymbols(t_symbol **symbols)
+{
+    symbols[kSymbolInvalid] = gensym("invalid");
+    symbols[kSymbolStart] = gensym("start");
+    symbols[kSymbolUpdate] = gensym("update");
+    symbols[kSymbolEnd] = gensym("end");
+    symbols[kSymbolCircle] = gensym("circle");
+    symbols[kSymbolSwipe] = gensym("swipe");
+    symbols[kSymbolKeyTap] = gensym("key_tap");
+    symbols[kSymbolScreenTap] = gensym("screen_tap");
+    symbols[kSymbolList] = gensym("list");
+    symbols[kSymbolJoints] = gensym("joints");
+    symbols[kSymbolTrajectory] = gensym("trajectory");
+}
+
+long encodeFrame(const FrameSnapshot &snapshot, t_atom *atoms)
+{
+    atom_setlong(atoms+0, snapshot.id);
+    atom_setlong(atoms+1, snapshot.timestamp);
+    atom_setlong(atoms+2, snapshot.hands.count());
+    atom_setlong(atoms+3, snapshot.tools.count());
+    atom_setlong(atoms+4, snapshot.gestures.count());
+    
+    return LEAP_FRAME_ATOMS;
+}
+
+long encodeHand(const FrameSnapshot &snapshot, uint32_t hand, t_atom *atoms)
+{
+    const HandTable &hands = snapshot.hands;
+    
+    atom_setlong(atoms+0, hands.integer(kHandId, hand));
+    
+    // palm position, direction, velocity, normal, sphere center, sphere radius, pinch and grab are consecutive channels
+    for (long c = kHandPalmX; c <= kHandGrab; c++)
+        atom_setfloat(atoms+1+c, hands.value(c, hand));
+    
+    atom_setlong(atoms+19, hands.integer(kHandIsLeft, hand));
+    
+    return LEAP_HAND_ATOMS;
+}
+
+long encodeFinger(const FrameSnapshot &snapshot, uint32_t finger, t_atom *atoms)
+{
+    const FingerTable &fingers = snapshot.fingers;
+    
+    atom_setlong(atoms+0, fingers.integer(kFingerId, finger));
+    atom_setlong(atoms+1, fingers.integer(kFingerHandId, finger));
+    
+    // tip position, direction, velocity, width and length are consecutive channels
+    for (long c = kFingerTipX; c <= kFingerLength; c++)
+        atom_setfloat(atoms+2+c, fingers.value(c, finger));
+    
+    atom_setlong(atoms+13, fingers.integer(kFingerIsExtended, finger));
+    atom_setlong(atoms+14, fingers.integer(kFingerType, finger));
+    
+    return LEAP_FINGER_ATOMS;
+}
+
+long encodeTool(const FrameSnapshot &snapshot, uint32_t tool, t_atom *atoms)
+{
+    const ToolTable &tools = snapshot.tools;
+    
+    atom_setlong(atoms+0, tools.integer(kToolId, tool));
+    
+    // tip position, direction, velocity, width and length are consecutive channels
+    for (long c = kToolTipX; c <= kToolLength; c++)
+        atom_setfloat(atoms+1+c, tools.value(c, tool));
+    
+    atom_setlong(atoms+12, tools.integer(kToolIsExtended, tool));
+    
+    return LEAP_TOOL_ATOMS;
+}
+
+long encodeBone(const FrameSnapshot &snapshot, uint32_t bone, t_atom *atoms)
+{
+    const BoneTable &bones = snapshot.bones;
+    
+    atom_setlong(atoms+0, bones.integer(kBoneFingerType, bone));
+    atom_setlong(atoms+1, bones.integer(kBoneType, bone));
+    
+    // joints, center, direction, basis, length and width are consecutive channels
+    for (long c = kBonePrevX; c <= kBoneWidth; c++)
+        atom_setfloat(atoms+2+c, bones.value(c, bone));
+    
+    return LEAP_BONE_ATOMS;
+}
+
+uint32_t handBoneCount(const FrameSnapshot &snapshot, uint32_t first)
+{
+    const BoneTable &bones = snapshot.bones;
+    uint32_t last = first;
+    
+    while (last < bones.count() && bones.integer(kBoneHandId, last) == bones.integer(kBoneHandId, first))
+        last++;
+    
+    return last - first;
+}
+
+long encodeHandBones(const FrameSnapshot &snapshot, uint32_t first, uint32_t count, t_atom *atoms)
+{
+    if (count > LEAP_HAND_BONES_MAX)
+        count = LEAP_HAND_BONES_MAX;
+    
+    t_atom *a = atoms;
+    
+    atom_setlong(a++, count ? snapshot.bones.integer(kBoneHandId, first) : 0);
+    atom_setlong(a++, count);
+    
+    for (uint32_t i = first; i < first + count; i++)
+        a += encodeBone(snapshot, i, a);
+    
+    return a - atoms;
+}
+
+long encodeHandJoints(const JointTable &joints, uint32_t first, uint32_t count, t_atom *atoms)
+{
+    if (count > LEAP_HAND_JOINTS_MAX)
+        count = LEAP_HAND_JOINTS_MAX;
+    
+    t_atom *a = atoms;
+    
+    atom_setlong(a++, count ? joints.integer(kJointHandId, first) : 0);
+    atom_setlong(a++, count);
+    
+    for (uint32_t i = first; i < first + count; i++)
+        for (long c = kJointW; c <= kJointZ; c++)
+            atom_setfloat(a++, joints.value(c, i));
+    
+    return a - atoms;
+}
+
+long encodeTrajectory(int32_t id, const TrajectoryStats &stats, t_atom *atoms)
+{
+    t_atom *a = atoms;
+    
+    atom_setlong(a++, id);
+    atom_setfloat(a++, stats.duration);
+    atom_setfloat(a++, stats.pathLength);
+    atom_setfloat(a++, stats.meanSpeed);
+    atom_setfloat(a++, stats.peakAcceleration);
+    
+    for (long c = 0; c < 3; c++)
+        atom_setfloat(a++, stats.min[c]);
+    
+    for (long c = 0; c < 3; c++)
+        atom_setfloat(a++, stats.max[c]);
+    
+    return a - atoms;
+}
+
+long encodeGesture(const FrameSnapshot &snapshot, uint32_t gesture, t_symbol **symbols, t_atom *atoms)
+{
+    const GestureTable &gestures = snapshot.gestures;
+    
+    // id and state
+    atom_setlong(atoms+1, gestures.integer(kGestureId, gesture));
+    atom_setsym(atoms+2, symbols[kSymbolInvalid + gestures.integer(kGestureState, gesture)]);
+    
+    // type (as first data for routing)
+    atom_setsym(atoms+0, symbols[kSymbolCircle + gestures.integer(kGestureType, gesture)]);
+    
+    // type specific data
+    switch (gestures.integer(kGestureType, gesture))
+    {
+        case kGestureCircle:
+            atom_setfloat(atoms+3, gestures.value(kGestureProgress, gesture));
+            atom_setfloat(atoms+4, gestures.value(kGestureRadius, gesture));
+            atom_setfloat(atoms+5, gestures.value(kGestureSweptAngle, gesture));
+            atom_setlong(atoms+6, gestures.integer(kGestureClockwise, gesture));
+            return 7;
+            
+        case kGestureSwipe:
+            atom_setfloat(atoms+3, gestures.value(kGestureDirectionX, gesture));
+            atom_setfloat(atoms+4, gestures.value(kGestureDirectionY, gesture));
+            atom_setfloat(atoms+5, gestures.value(kGestureDirectionZ, gesture));
+            atom_setfloat(atoms+6, gestures.value(kGestureSpeed, gesture));
+            return 7;
+            
+        case kGestureKeyTap:
+        case kGestureScreenTap:
+            for (long c = kGesturePositionX; c <= kGestureDirectionZ; c++)
+                atom_setfloat(atoms+3+c-kGesturePositionX, gestures.value(c, gesture));
+            return 9;
+    }
+    
+    return 0;
+}
+
+long packedSize(const FrameSnapshot &snapshot)
+{
+    return LEAP_PACKED_HEADER_ATOMS +
+        snapshot.hands.count() * LEAP_HAND_ATOMS +
+        snapshot.fingers.count() * LEAP_FINGER_ATOMS +
+        snapshot.tools.count() * LEAP_TOOL_ATOMS +
+        snapshot.gestures.count() * LEAP_GESTURE_ATOMS_MAX;
+}
+
+long encodePacked(const FrameSnapshot &snapshot, t_symbol **symbols, t_atom *atoms)
+{
+    t_atom *a = atoms;
+    
+    // header
+    atom_setlong(a++, snapshot.id);
+    atom_setlong(a++, snapshot.timestamp);
+    atom_setlong(a++, snapshot.hands.count());
+    atom_setlong(a++, snapshot.fingers.count());
+    atom_setlong(a++, snapshot.tools.count());
+    atom_setlong(a++, snapshot.gestures.count());
+    
+    for (uint32_t i = 0; i < snapshot.hands.count(); i++)
+        a += encodeHand(snapshot, i, a);
+    
+    for (uint32_t i = 0; i < snapshot.fingers.count(); i++)
+        a += encodeFinger(snapshot, i, a);
+    
+    for (uint32_t i = 0; i < snapshot.tools.count(); i++)
+        a += encodeTool(snapshot, i, a);
+    
+    for (uint32_t i = 0; i < snapshot.gestures.count(); i++)
+    {
+        long size = encodeGesture(snapshot, i, symbols, a);
+        
+        for (; size < LEAP_GESTURE_ATOMS_MAX; size++)
+            atom_setlong(a + size, 0);
+        
+        a += LEAP_GESTURE_ATOMS_MAX;
+    }
+    
+    return a - atoms;
+}
+
+long matrixRows(const FrameSnapshot &snapshot)
+{
+    return snapshot.hands.count() + snapshot.fingers.count() + snapshot.tools.count();
+}
+
+void encodeMatrix(const FrameSnapshot &snapshot, float *cells, long stride)
+{
+    float *cell = cells;
+    
+    const HandTable &hands = snapshot.hands;
+    
+    for (uint32_t i = 0; i < hands.count(); i++, cell += stride)
+    {
+        cell[kMatrixKind] = kMatrixHand;
+        cell[kMatrixId] = hands.integer(kHandId, i);
+        cell[kMatrixParentId] = -1;
+        
+        for (long k = 0; k < 3; k++)
+        {
+            cell[kMatrixPositionX+k] = hands.value(kHandPalmX+k, i);
+            cell[kMatrixDirectionX+k] = hands.value(kHandDirectionX+k, i);
+            cell[kMatrixVelocityX+k] = hands.value(kHandVelocityX+k, i);
+            cell[kMatrixNormalX+k] = hands.value(kHandNormalX+k, i);
+        }
+        
+        cell[kMatrixWidth] = hands.value(kHandSphereRadius, i);
+        cell[kMatrixLength] = 0;
+        cell[kMatrixState0] = hands.value(kHandPinch, i);
+        cell[kMatrixState1] = hands.value(kHandGrab, i);
+    }
+    
+    const FingerTable &fingers = snapshot.fingers;
+    
+    for (uint32_t i = 0; i < fingers.count(); i++, cell += stride)
+    {
+        cell[kMatrixKind] = kMatrixFinger;
+        cell[kMatrixId] = fingers.integer(kFingerId, i);
+        cell[kMatrixParentId] = fingers.integer(kFingerHandId, i);
+        
+        for (long k = 0; k < 3; k++)
+        {
+            cell[kMatrixPositionX+k] = fingers.value(kFingerTipX+k, i);
+            cell[kMatrixDirectionX+k] = fingers.value(kFingerDirectionX+k, i);
+            cell[kMatrixVelocityX+k] = fingers.value(kFingerVelocityX+k, i);
+            cell[kMatrixNormalX+k] = 0;
+        }
+        
+        cell[kMatrixWidth] = fingers.value(kFingerWidth, i);
+        cell[kMatrixLength] = fingers.value(kFingerLength, i);
+        cell[kMatrixState0] = fingers.integer(kFingerIsExtended, i);
+        cell[kMatrixState1] = fingers.integer(kFingerType, i);
+    }
+    
+    const ToolTable &tools = snapshot.tools;
+    
+    for (uint32_t i = 0; i < tools.count(); i++, cell += stride)
+    {
+        cell[kMatrixKind] = kMatrixTool;
+        cell[kMatrixId] = tools.integer(kToolId, i);
+        cell[kMatrixParentId] = -1;
+        
+        for (long k = 0; k < 3; k++)
+        {
+            cell[kMatrixPositionX+k] = tools.value(kToolTipX+k, i);
+            cell[kMatrixDirectionX+k] = tools.value(kToolDirectionX+k, i);
+            cell[kMatrixVelocityX+k] = tools.value(kToolVelocityX+k, i);
+            cell[kMatrixNormalX+k] = 0;
+        }
+        
+        cell[kMatrixWidth] = tools.value(kToolWidth, i);
+        cell[kMatrixLength] = tools.value(kToolLength, i);
+        cell[kMatrixState0] = tools.integer(kToolIsExtended, i);
+        cell[kMatrixState1] = 0;
+    }
+}
+
+void encodeBoneMatrix(const FrameSnapshot &snapshot, float *cells, long stride)
+{
+    const BoneTable &bones = snapshot.bones;
+    float *cell = cells;
+    
+    for (uint32_t i = 0; i < bones.count(); i++, cell += stride)
+    {
+        cell[kBonePlaneHandId] = bones.integer(kBoneHandId, i);
+        cell[kBonePlaneFingerType] = bones.integer(kBoneFingerType, i);
+        cell[kBonePlaneType] = bones.integer(kBoneType, i);
+        
+        for (long c = 0; c < kBoneChannels; c++)
+            cell[kBonePlaneChannels+c] = bones.value(c, i);
+    }
+}
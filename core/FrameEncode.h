@@ -0,0 +1,153 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameEncode : turn FrameSnapshot rows into Max atoms
+ *
+ * @details Each function writes the atoms of one row into a caller provided array
+ * and returns the number of atoms written. The layouts are the ones of the j.leapmotion outlets.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameEncode_h__
+#define __FrameEncode_h__
+
+#include "ext.h"
+#include "FrameSnapshot.h"
+#include "JointSolver.h"
+#include "TrajectoryStore.h"
+
+// number of atoms of each list
+#define LEAP_FRAME_ATOMS 5
+#define LEAP_HAND_ATOMS 20
+#define LEAP_FINGER_ATOMS 15
+#define LEAP_TOOL_ATOMS 13
+#define LEAP_GESTURE_ATOMS_MAX 9
+#define LEAP_PACKED_HEADER_ATOMS 6
+#define LEAP_BONE_ATOMS 25
+#define LEAP_BONES_HEADER_ATOMS 2
+#define LEAP_HAND_BONES_MAX 21      // 4 bones per finger and the arm
+#define LEAP_JOINT_ATOMS 4
+#define LEAP_HAND_JOINTS_MAX 22     // the arm, the palm and 4 bones per finger
+#define LEAP_TRAJECTORY_ATOMS 11
+
+/// symbols output by the encoders, looked up once (see encodeSymbols) so that encoding a frame never calls gensym
+enum eSymbol
+{
+    kSymbolInvalid,         // gesture states, in Leap::Gesture::State order
+    kSymbolStart,
+    kSymbolUpdate,
+    kSymbolEnd,
+    kSymbolCircle,          // gesture types, in eGestureType order
+    kSymbolSwipe,
+    kSymbolKeyTap,
+    kSymbolScreenTap,
+    kSymbolList,
+    kSymbolJoints,
+    kSymbolTrajectory,
+    kSymbols
+};
+
+/// fill a kSymbols long array
+void encodeSymbols(t_symbol **symbols);
+
+/// id, timestamp, number of hands, number of tools, number of gestures
+long encodeFrame(const FrameSnapshot &snapshot, t_atom *atoms);
+
+/// id, palm position xyz, direction xyz, palm velocity xyz, palm normal xyz, sphere center xyz, sphere radius, pinch, grab, is left
+long encodeHand(const FrameSnapshot &snapshot, uint32_t hand, t_atom *atoms);
+
+/// id, hand id, tip position xyz, direction xyz, tip velocity xyz, width, length, is extended, type
+long encodeFinger(const FrameSnapshot &snapshot, uint32_t finger, t_atom *atoms);
+
+/// id, tip position xyz, direction xyz, tip velocity xyz, width, length, is extended
+long encodeTool(const FrameSnapshot &snapshot, uint32_t tool, t_atom *atoms);
+
+/// finger type (-1 for the arm), bone type (0 metacarpal, 1 proximal, 2 intermediate, 3 distal, 4 arm),
+/// prev joint xyz, next joint xyz, center xyz, direction xyz, basis x axis xyz, y axis xyz, z axis xyz, length, width
+long encodeBone(const FrameSnapshot &snapshot, uint32_t bone, t_atom *atoms);
+
+/// number of bones of the hand whose bones start at row first (they are the consecutive rows of the same hand id)
+uint32_t handBoneCount(const FrameSnapshot &snapshot, uint32_t first);
+
+/// the skeleton of a hand as one list : hand id, number of bones then every bone with the layout above.
+/// count bones from row first are encoded, at most LEAP_HAND_BONES_MAX.
+long encodeHandBones(const FrameSnapshot &snapshot, uint32_t first, uint32_t count, t_atom *atoms);
+
+/// the joints of a hand as one list : hand id, number of joints then the w x y z quaternion of every joint
+/// (arm, palm then metacarpal, proximal, intermediate and distal of each finger, see JointSolver).
+/// count joints from row first are encoded, at most LEAP_HAND_JOINTS_MAX.
+long encodeHandJoints(const JointTable &joints, uint32_t first, uint32_t count, t_atom *atoms);
+
+/// id, duration (ms), path length (mm), mean speed (mm/s), peak acceleration (mm/s²), bounding box min xyz, max xyz
+long encodeTrajectory(int32_t id, const TrajectoryStats &stats, t_atom *atoms);
+
+/// type name, id, state name then : @n
+/// circle : progress, radius, swept angle, clockwiseness @n
+/// swipe : direction xyz, speed @n
+/// key_tap and screen_tap : position xyz, direction xyz
+long encodeGesture(const FrameSnapshot &snapshot, uint32_t gesture, t_symbol **symbols, t_atom *atoms);
+
+/// number of atoms of the packed list of a snapshot
+long packedSize(const FrameSnapshot &snapshot);
+
+/// the whole frame as one flat list : @n
+/// header : id, timestamp, number of hands, number of fingers, number of tools, number of gestures @n
+/// then every hand, every finger, every tool and every gesture with the same layouts as above,
+/// except that gestures are padded with zeros to LEAP_GESTURE_ATOMS_MAX atoms so all rows of a kind have the same size.
+long encodePacked(const FrameSnapshot &snapshot, t_symbol **symbols, t_atom *atoms);
+
+/// kinds of matrix rows
+enum eMatrixKind
+{
+    kMatrixHand,
+    kMatrixFinger,
+    kMatrixTool
+};
+
+/// planes of the float32 frame matrix (one cell per hand, finger or tool)
+enum eMatrixPlane
+{
+    kMatrixKind,                // an eMatrixKind
+    kMatrixId,
+    kMatrixParentId,            // hand id of a finger, -1 otherwise
+    kMatrixPositionX, kMatrixPositionY, kMatrixPositionZ,       // palm or tip position
+    kMatrixDirectionX, kMatrixDirectionY, kMatrixDirectionZ,
+    kMatrixVelocityX, kMatrixVelocityY, kMatrixVelocityZ,       // palm or tip velocity
+    kMatrixNormalX, kMatrixNormalY, kMatrixNormalZ,             // palm normal, 0 otherwise
+    kMatrixWidth,               // sphere radius of a hand
+    kMatrixLength,              // 0 for a hand
+    kMatrixState0,              // pinch of a hand, is extended otherwise
+    kMatrixState1,              // grab of a hand, type of a finger, 0 for a tool
+    kMatrixPlanes
+};
+
+#define LEAP_MATRIX_PLANES kMatrixPlanes
+
+/// planes of the float32 bone matrix (one cell per bone)
+enum eBonePlane
+{
+    kBonePlaneHandId,
+    kBonePlaneFingerType,       // -1 for the arm
+    kBonePlaneType,             // an eBoneType
+    kBonePlaneChannels,         // then every eBoneChannel, from prev joint x to width
+    kBonePlanes = kBonePlaneChannels + kBoneChannels
+};
+
+#define LEAP_BONE_PLANES kBonePlanes
+
+/// number of cells of the frame matrix : every hand, then every finger, then every tool
+long matrixRows(const FrameSnapshot &snapshot);
+
+/// write the frame matrix into float32 cells of kMatrixPlanes planes, stride floats apart
+void encodeMatrix(const FrameSnapshot &snapshot, float *cells, long stride);
+
+/// write every bone of every hand into float32 cells of kBonePlanes planes, stride floats apart
+void encodeBoneMatrix(const FrameSnapshot &snapshot, float *cells, long stride);
+
+#endif // __FrameEncode_h__
@@ -0,0 +1,286 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameExtract : fill a FrameSnapshot from a Leap::Frame
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FrameExtract.h"
+
+#define _USE_MATH_DEFINES // To get definition of M_PI
+#include <math.h>
+
+static void extractBasis(BoneTable &bones, uint32_t row, const Leap::Matrix &basis)
+{
+    bones.setVector(kBoneBasisXX, row, basis.xBasis.x, basis.xBasis.y, basis.xBasis.z);
+    bones.setVector(kBoneBasisYX, row, basis.yBasis.x, basis.yBasis.y, basis.yBasis.z);
+    bones.setVector(kBoneBasisZX, row, basis.zBasis.x, basis.zBasis.y, basis.zBasis.z);
+}
+
+void extractFrame(FrameSnapshot &snapshot, const Leap::Frame &frame, GestureProgressCache *circles, double *phases, bool bones)
+{
+    snapshot.clear();
+    snapshot.id = frame.id();
+    snapshot.timestamp = frame.timestamp();
+
+    // optional timing of each kind of data (fingers are timed inside the hand loop)
+    int64_t start = phases ? statClock() : 0;
+    int64_t fingersTime = 0;
+
+    /// extract hand info ///////////////////////////////////////////////////
+    const Leap::HandList hands = frame.hands();
+    const uint32_t numHands = hands.count();
+
+    HandTable &handTable = snapshot.hands;
+    FingerTable &fingerTable = snapshot.fingers;
+    BoneTable &boneTable = snapshot.bones;
+
+    handTable.resize(numHands);
+    fingerTable.reserve(numHands * 5);
+
+    if (bones)
+        boneTable.reserve(numHands * 21);
+
+    for (uint32_t i = 0; i < numHands; i++)
+    {
+        const Leap::Hand hand = hands[i];
+        const int32_t hand_id = hand.id();
+
+        const Leap::Vector position = hand.palmPosition();
+        const Leap::Vector direction = hand.direction();
+        const Leap::Vector velocity = hand.palmVelocity();
+        const Leap::Vector normal = hand.palmNormal();
+        const Leap::Vector sphereCenter = hand.sphereCenter();
+
+        handTable.setVector(kHandPalmX, i, position.x, position.y, position.z);
+        handTable.setVector(kHandDirectionX, i, direction.x, direction.y, direction.z);
+        handTable.setVector(kHandVelocityX, i, velocity.x, velocity.y, velocity.z);
+        handTable.setVector(kHandNormalX, i, normal.x, normal.y, normal.z);
+        handTable.setVector(kHandSphereX, i, sphereCenter.x, sphereCenter.y, sphereCenter.z);
+        handTable.value(kHandSphereRadius, i) = hand.sphereRadius();
+        handTable.value(kHandPinch, i) = hand.pinchStrength();
+        handTable.value(kHandGrab, i) = hand.grabStrength();
+
+        handTable.integer(kHandId, i) = hand_id;
+        handTable.integer(kHandIsLeft, i) = hand.isLeft();
+
+        /// extract finger info /////////////////////////////////////////////
+        const Leap::FingerList fingers = hand.fingers();
+        const uint32_t numFingers = fingers.count();
+
+        handTable.integer(kHandFirstFinger, i) = fingerTable.count();
+        handTable.integer(kHandFingerCount, i) = numFingers;
+
+        const int64_t fingersStart = phases ? statClock() : 0;
+
+        for (uint32_t j = 0; j < numFingers; j++)
+        {
+            const Leap::Finger finger = fingers[j];
+            const uint32_t row = fingerTable.addRow();
+
+            const Leap::Vector position = finger.tipPosition();
+            const Leap::Vector direction = finger.direction();
+            const Leap::Vector velocity = finger.tipVelocity();
+
+            fingerTable.setVector(kFingerTipX, row, position.x, position.y, position.z);
+            fingerTable.setVector(kFingerDirectionX, row, direction.x, direction.y, direction.z);
+            fingerTable.setVector(kFingerVelocityX, row, velocity.x, velocity.y, velocity.z);
+            fingerTable.value(kFingerWidth, row) = finger.width();
+            fingerTable.value(kFingerLength, row) = finger.length();
+
+            fingerTable.integer(kFingerId, row) = finger.id();
+            fingerTable.integer(kFingerHandId, row) = hand_id;
+            fingerTable.integer(kFingerIsExtended, row) = finger.isExtended();
+            fingerTable.integer(kFingerType, row) = finger.type();
+
+            if (!bones)
+                continue;
+
+            /// extract bone info ///////////////////////////////////////////
+            for (int b = Leap::Bone::TYPE_METACARPAL; b <= Leap::Bone::TYPE_DISTAL; b++)
+            {
+                const Leap::Bone bone = finger.bone((Leap::Bone::Type)b);
+                const uint32_t boneRow = boneTable.addRow();
+
+                const Leap::Vector prev = bone.prevJoint();
+                const Leap::Vector next = bone.nextJoint();
+                const Leap::Vector center = bone.center();
+                const Leap::Vector direction = bone.direction();
+
+                boneTable.setVector(kBonePrevX, boneRow, prev.x, prev.y, prev.z);
+                boneTable.setVector(kBoneNextX, boneRow, next.x, next.y, next.z);
+                boneTable.setVector(kBoneCenterX, boneRow, center.x, center.y, center.z);
+                boneTable.setVector(kBoneDirectionX, boneRow, direction.x, direction.y, direction.z);
+                extractBasis(boneTable, boneRow, bone.basis());
+                boneTable.value(kBoneLength, boneRow) = bone.length();
+                boneTable.value(kBoneWidth, boneRow) = bone.width();
+
+                boneTable.integer(kBoneHandId, boneRow) = hand_id;
+                boneTable.integer(kBoneFingerType, boneRow) = finger.type();
+                boneTable.integer(kBoneType, boneRow) = b;
+            }
+        }
+
+        if (bones)
+        {
+            // the arm goes from the elbow to the wrist
+            const Leap::Arm arm = hand.arm();
+            const uint32_t boneRow = boneTable.addRow();
+
+            const Leap::Vector prev = arm.elbowPosition();
+            const Leap::Vector next = arm.wristPosition();
+            const Leap::Vector center = arm.center();
+            const Leap::Vector direction = arm.direction();
+
+            boneTable.setVector(kBonePrevX, boneRow, prev.x, prev.y, prev.z);
+            boneTable.setVector(kBoneNextX, boneRow, next.x, next.y, next.z);
+            boneTable.setVector(kBoneCenterX, boneRow, center.x, center.y, center.z);
+            boneTable.setVector(kBoneDirectionX, boneRow, direction.x, direction.y, direction.z);
+            extractBasis(boneTable, boneRow, arm.basis());
+            boneTable.value(kBoneLength, boneRow) = prev.distanceTo(next);
+            boneTable.value(kBoneWidth, boneRow) = arm.width();
+
+            boneTable.integer(kBoneHandId, boneRow) = hand_id;
+            boneTable.integer(kBoneFingerType, boneRow) = -1;
+            boneTable.integer(kBoneType, boneRow) = kBoneArm;
+        }
+
+        if (phases)
+            fingersTime += statClock() - fingersStart;
+    }
+
+    if (phases)
+    {
+        const int64_t now = statClock();
+        phases[kPhaseHands] = (now - start - fingersTime) * 0.001;
+        phases[kPhaseFingers] = fingersTime * 0.001;
+        start = now;
+    }
+
+    /// extract tool info ///////////////////////////////////////////////////
+    const Leap::ToolList tools = frame.tools();
+    const uint32_t numTools = tools.count();
+
+    ToolTable &toolTable = snapshot.tools;
+    toolTable.resize(numTools);
+
+    for (uint32_t i = 0; i < numTools; i++)
+    {
+        const Leap::Tool tool = tools[i];
+
+        const Leap::Vector position = tool.tipPosition();
+        const Leap::Vector direction = tool.direction();
+        const Leap::Vector velocity = tool.tipVelocity();
+
+        toolTable.setVector(kToolTipX, i, position.x, position.y, position.z);
+        toolTable.setVector(kToolDirectionX, i, direction.x, direction.y, direction.z);
+        toolTable.setVector(kToolVelocityX, i, velocity.x, velocity.y, velocity.z);
+        toolTable.value(kToolWidth, i) = tool.width();
+        toolTable.value(kToolLength, i) = tool.length();
+
+        toolTable.integer(kToolId, i) = tool.id();
+        toolTable.integer(kToolIsExtended, i) = tool.isExtended();
+    }
+
+    if (phases)
+    {
+        const int64_t now = statClock();
+        phases[kPhaseTools] = (now - start) * 0.001;
+        start = now;
+    }
+
+    /// extract gesture info ////////////////////////////////////////////////
+    const Leap::GestureList gestures = frame.gestures();
+    const uint32_t numGestures = gestures.count();
+
+    GestureTable &gestureTable = snapshot.gestures;
+    gestureTable.reserve(numGestures);
+
+    for (uint32_t i = 0; i < numGestures; i++)
+    {
+        const Leap::Gesture gesture = gestures[i];
+        uint32_t row;
+
+        // depending on the type of the gesture
+        switch (gesture.type())
+        {
+            case Leap::Gesture::TYPE_CIRCLE:
+            {
+                Leap::CircleGesture circle = gesture;
+                row = gestureTable.addRow();
+
+                // clockwiseness
+                const bool clockwiseness = circle.pointable().direction().angleTo(circle.normal()) <= M_PI/2;
+
+                gestureTable.integer(kGestureType, row) = kGestureCircle;
+                gestureTable.integer(kGestureClockwise, row) = clockwiseness ? 1 : 0;
+                gestureTable.value(kGestureProgress, row) = circle.progress();
+                gestureTable.value(kGestureRadius, row) = circle.radius();
+                gestureTable.value(kGestureSweptAngle, row) = 0;   // measured once the state is known (see below)
+                break;
+            }
+
+            case Leap::Gesture::TYPE_SWIPE:
+            {
+                Leap::SwipeGesture swipe = gesture;
+                row = gestureTable.addRow();
+
+                const Leap::Vector direction = swipe.direction();
+
+                gestureTable.integer(kGestureType, row) = kGestureSwipe;
+                gestureTable.setVector(kGestureDirectionX, row, direction.x, direction.y, direction.z);
+                gestureTable.value(kGestureSpeed, row) = swipe.speed();
+                break;
+            }
+
+            case Leap::Gesture::TYPE_KEY_TAP:
+            {
+                Leap::KeyTapGesture key_tap = gesture;
+                row = gestureTable.addRow();
+
+                const Leap::Vector position = key_tap.position();
+                const Leap::Vector direction = key_tap.direction();
+
+                gestureTable.integer(kGestureType, row) = kGestureKeyTap;
+                gestureTable.setVector(kGesturePositionX, row, position.x, position.y, position.z);
+                gestureTable.setVector(kGestureDirectionX, row, direction.x, direction.y, direction.z);
+                break;
+            }
+
+            case Leap::Gesture::TYPE_SCREEN_TAP:
+            {
+                Leap::ScreenTapGesture screen_tap = gesture;
+                row = gestureTable.addRow();
+
+                const Leap::Vector position = screen_tap.position();
+                const Leap::Vector direction = screen_tap.direction();
+
+                gestureTable.integer(kGestureType, row) = kGestureScreenTap;
+                gestureTable.setVector(kGesturePositionX, row, position.x, position.y, position.z);
+                gestureTable.setVector(kGestureDirectionX, row, direction.x, direction.y, direction.z);
+                break;
+            }
+
+            default:
+                // unknown gesture types are not part of the snapshot
+                continue;
+        }
+
+        gestureTable.integer(kGestureId, row) = gesture.id();
+        gestureTable.integer(kGestureState, row) = gesture.state();
+    }
+
+    if (circles)
+        circles->measure(gestureTable);
+
+    if (phases)
+        phases[kPhaseGestures] = (statClock() - start) * 0.001;
+}
@@ -0,0 +1,32 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameExtract : fill a FrameSnapshot from a Leap::Frame
+ *
+ * @details This is the only place where the Leap SDK getters are called for output data.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameExtract_h__
+#define __FrameExtract_h__
+
+#include "Leap.h"
+#include "FrameSnapshot.h"
+#include "GestureProgressCache.h"
+#include "BangStats.h"
+
+/** Pull all hand, finger, tool and gesture data of a frame into a snapshot, and the bones of every hand when bones is true.
+    The swept angle of circle gestures is measured from the previous frame passed to extractFrame with the same circles
+    (the previous extracted frame, not the previous frame of the Leap history) : circles holds their progress.
+    Without circles the swept angles are left at 0, for the reader of the snapshot to measure (see GestureProgressCache::measure).
+    When phases is given, the time spent on hands, fingers, tools and gestures is written at their eStatPhase
+    (bones are timed with fingers). */
+void extractFrame(FrameSnapshot &snapshot, const Leap::Frame &frame, GestureProgressCache *circles, double *phases = NULL, bool bones = true);
+
+#endif // __FrameExtract_h__
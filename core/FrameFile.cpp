@@ -0,0 +1,183 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameFile : binary layout of recorded FrameSnapshots
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FrameFile.h"
+
+template<class Table>
+static uint32_t tableSize(const Table &table)
+{
+    return table.count() * (Table::channels * sizeof(float) + Table::fields * sizeof(int32_t));
+}
+
+template<class Table>
+static char *writeTable(const Table &table, char *bytes)
+{
+    const uint32_t count = table.count();
+
+    if (!count)
+        return bytes;
+
+    for (int c = 0; c < Table::channels; c++, bytes += count * sizeof(float))
+        memcpy(bytes, table.channel(c), count * sizeof(float));
+
+    for (int f = 0; f < Table::fields; f++, bytes += count * sizeof(int32_t))
+        memcpy(bytes, table.field(f), count * sizeof(int32_t));
+
+    return bytes;
+}
+
+template<class Table>
+static const char *readTable(Table &table, uint32_t count, const char *bytes)
+{
+    table.resize(count);
+
+    if (!count)
+        return bytes;
+
+    for (int c = 0; c < Table::channels; c++, bytes += count * sizeof(float))
+        memcpy(table.channel(c), bytes, count * sizeof(float));
+
+    for (int f = 0; f < Table::fields; f++, bytes += count * sizeof(int32_t))
+        memcpy(table.field(f), bytes, count * sizeof(int32_t));
+
+    return bytes;
+}
+
+/// false if a field used as an index by the output (finger ranges, gesture and bone types, gesture states) is out of range
+static bool checkSnapshot(const FrameSnapshot &snapshot)
+{
+    const HandTable &hands = snapshot.hands;
+    const GestureTable &gestures = snapshot.gestures;
+    const BoneTable &bones = snapshot.bones;
+
+    for (uint32_t i = 0; i < hands.count(); i++)
+    {
+        const int64_t first = hands.integer(kHandFirstFinger, i);
+        const int64_t count = hands.integer(kHandFingerCount, i);
+
+        if (first < 0 || count < 0 || first + count > snapshot.fingers.count())
+            return false;
+    }
+
+    // gesture states go from invalid (0) to end (3)
+    for (uint32_t i = 0; i < gestures.count(); i++)
+    {
+        const int32_t type = gestures.integer(kGestureType, i);
+        const int32_t state = gestures.integer(kGestureState, i);
+
+        if (type < 0 || type >= kGestureTypes || state < 0 || state > 3)
+            return false;
+    }
+
+    for (uint32_t i = 0; i < bones.count(); i++)
+    {
+        const int32_t finger = bones.integer(kBoneFingerType, i);
+        const int32_t type = bones.integer(kBoneType, i);
+
+        // finger types go from the thumb (0) to the pinky (4), -1 for the arm
+        if (finger < -1 || finger > 4 || type < 0 || type >= kBoneTypes)
+            return false;
+    }
+
+    return true;
+}
+
+void frameFileHeader(FrameFileHeader &header)
+{
+    header.magic = LEAP_FILE_MAGIC;
+    header.version = LEAP_FILE_VERSION;
+    header.endianness = 0x01020304;
+    header.reserved = 0;
+}
+
+bool frameFileCheck(const FrameFileHeader &header)
+{
+    return header.magic == LEAP_FILE_MAGIC && header.version >= 1 && header.version <= LEAP_FILE_VERSION && header.endianness == 0x01020304;
+}
+
+uint32_t frameRecordSize(const FrameSnapshot &snapshot)
+{
+    return sizeof(FrameRecordHeader) +
+        tableSize(snapshot.hands) +
+        tableSize(snapshot.fingers) +
+        tableSize(snapshot.tools) +
+        tableSize(snapshot.gestures) +
+        tableSize(snapshot.bones);
+}
+
+uint32_t writeFrameRecord(const FrameSnapshot &snapshot, char *bytes)
+{
+    FrameRecordHeader header;
+
+    header.size = frameRecordSize(snapshot);
+    header.counts[0] = snapshot.hands.count();
+    header.counts[1] = snapshot.fingers.count();
+    header.counts[2] = snapshot.tools.count();
+    header.counts[3] = snapshot.gestures.count();
+    header.bones = snapshot.bones.count();
+    header.id = snapshot.id;
+    header.timestamp = snapshot.timestamp;
+
+    memcpy(bytes, &header, sizeof(header));
+
+    char *end = bytes + sizeof(header);
+    end = writeTable(snapshot.hands, end);
+    end = writeTable(snapshot.fingers, end);
+    end = writeTable(snapshot.tools, end);
+    end = writeTable(snapshot.gestures, end);
+    writeTable(snapshot.bones, end);
+
+    return header.size;
+}
+
+uint32_t readFrameRecord(const char *bytes, uint64_t available, FrameSnapshot &snapshot)
+{
+    FrameRecordHeader header;
+
+    if (available < sizeof(header))
+        return 0;
+
+    memcpy(&header, bytes, sizeof(header));
+
+    // check the size announced by the header against the counts before trusting them
+    const uint64_t size = sizeof(header) +
+        (uint64_t)header.counts[0] * (kHandChannels * sizeof(float) + kHandFields * sizeof(int32_t)) +
+        (uint64_t)header.counts[1] * (kFingerChannels * sizeof(float) + kFingerFields * sizeof(int32_t)) +
+        (uint64_t)header.counts[2] * (kToolChannels * sizeof(float) + kToolFields * sizeof(int32_t)) +
+        (uint64_t)header.counts[3] * (kGestureChannels * sizeof(float) + kGestureFields * sizeof(int32_t)) +
+        (uint64_t)header.bones * (kBoneChannels * sizeof(float) + kBoneFields * sizeof(int32_t));
+
+    if (size != header.size || size > available)
+        return 0;
+
+    snapshot.id = header.id;
+    snapshot.timestamp = header.timestamp;
+
+    const char *data = bytes + sizeof(header);
+    data = readTable(snapshot.hands, header.counts[0], data);
+    data = readTable(snapshot.fingers, header.counts[1], data);
+    data = readTable(snapshot.tools, header.counts[2], data);
+    data = readTable(snapshot.gestures, header.counts[3], data);
+    readTable(snapshot.bones, header.bones, data);
+
+    // a corrupted or foreign record must not make the output index out of its tables
+    if (!checkSnapshot(snapshot))
+    {
+        snapshot.clear();
+        return 0;
+    }
+
+    return header.size;
+}
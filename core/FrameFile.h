@@ -0,0 +1,81 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameFile : binary layout of recorded FrameSnapshots
+ *
+ * @details A file starts with a FrameFileHeader followed by one record per frame.
+ * A record is a FrameRecordHeader followed by the hand, finger, tool, gesture and bone tables,
+ * each stored as in memory : every channel (count floats) then every field (count integers).
+ * A file closed properly ends with a sparse index (one FrameIndexEntry every LEAP_INDEX_STRIDE frames)
+ * followed by a FrameFileTrailer, so a reader can seek without scanning the records.
+ * Values are written in the byte order of the recording machine.
+ * Version 1 files have no bones : they are read as version 2 files whose records have none.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameFile_h__
+#define __FrameFile_h__
+
+#include "FrameSnapshot.h"
+
+#define LEAP_FILE_MAGIC 0x464D4C4A      // "JLMF"
+#define LEAP_FILE_VERSION 2
+#define LEAP_INDEX_MAGIC 0x494D4C4A     // "JLMI"
+#define LEAP_INDEX_STRIDE 64
+
+struct FrameFileHeader
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    endianness;     // 0x01020304 as written by the recording machine
+    uint32_t    reserved;
+};
+
+struct FrameRecordHeader
+{
+    uint32_t    size;           // of the whole record, header included
+    uint32_t    counts[4];      // hands, fingers, tools, gestures
+    uint32_t    bones;          // 0 in version 1 files
+    int64_t     id;
+    int64_t     timestamp;
+};
+
+struct FrameIndexEntry
+{
+    int64_t     id;
+    int64_t     timestamp;
+    uint64_t    offset;         // of the record in the file
+};
+
+struct FrameFileTrailer
+{
+    uint32_t    magic;
+    uint32_t    entries;        // number of FrameIndexEntry before the trailer
+    uint64_t    frames;         // number of records
+    uint64_t    indexOffset;    // where the records end and the index starts
+};
+
+/// a header for a new file
+void frameFileHeader(FrameFileHeader &header);
+
+/// false if the header is not one of a file we can read
+bool frameFileCheck(const FrameFileHeader &header);
+
+/// number of bytes of the record of a snapshot
+uint32_t frameRecordSize(const FrameSnapshot &snapshot);
+
+/// write the record of a snapshot (frameRecordSize bytes) and return its size
+uint32_t writeFrameRecord(const FrameSnapshot &snapshot, char *bytes);
+
+/// read a record of at most available bytes into a snapshot, return its size or 0 if it is truncated or corrupted
+/// (a record whose finger ranges, gesture or bone types or gesture states are out of range is corrupted)
+uint32_t readFrameRecord(const char *bytes, uint64_t available, FrameSnapshot &snapshot);
+
+#endif // __FrameFile_h__
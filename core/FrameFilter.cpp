@@ -0,0 +1,273 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameFilter : One-Euro or Kalman smoothing of the tracked values of a FrameSnapshot
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FrameFilter.h"
+#include "LeapSimd.h"
+
+#define _USE_MATH_DEFINES // To get definition of M_PI
+#include <math.h>
+
+// a pause longer than this (in seconds) starts the filters again
+#define LEAP_FILTER_GAP 0.5
+
+// mm per unit of the direction, normal and strength channels (a unit vector is a 100 mm long motion)
+#define LEAP_FILTER_UNIT 100.f
+
+static const float handScales[kHandChannels] =
+{
+    1.f, 1.f, 1.f,                                          // palm position
+    LEAP_FILTER_UNIT, LEAP_FILTER_UNIT, LEAP_FILTER_UNIT,   // direction
+    1.f, 1.f, 1.f,                                          // palm velocity
+    LEAP_FILTER_UNIT, LEAP_FILTER_UNIT, LEAP_FILTER_UNIT,   // palm normal
+    1.f, 1.f, 1.f,                                          // sphere center
+    1.f,                                                    // sphere radius
+    LEAP_FILTER_UNIT,                                       // pinch
+    LEAP_FILTER_UNIT                                        // grab
+};
+
+// fingers and tools share the same layout
+static const float pointableScales[kFingerChannels] =
+{
+    1.f, 1.f, 1.f,                                          // tip position
+    LEAP_FILTER_UNIT, LEAP_FILTER_UNIT, LEAP_FILTER_UNIT,   // direction
+    1.f, 1.f, 1.f,                                          // tip velocity
+    1.f,                                                    // width
+    1.f                                                     // length
+};
+
+void filterStart(float *state, const float *values, const float *params, long stride)
+{
+    for (long c = 0; c < stride; c++)
+    {
+        state[kStateValue * stride + c] = values[c];
+        state[kStateDerivative * stride + c] = 0.f;
+        state[kStateP00 * stride + c] = params[kParamB * stride + c];
+        state[kStateP01 * stride + c] = 0.f;
+        state[kStateP11 * stride + c] = params[kParamC * stride + c];
+    }
+}
+
+/// smoothing factor of a first order low-pass of cutoff fc (in Hz) sampled every dt seconds
+static inline float smoothing(float fc, float dt)
+{
+    const float r = 2.f * (float)M_PI * fc * dt;
+    return r / (1.f + r);
+}
+
+void filterOneEuro(float *values, float *states, const uint32_t *slots, uint32_t rows, const float *params, float dt, long stride)
+{
+    const float *minCutoff = params + kParamA * stride;
+    const float *beta = params + kParamB * stride;
+    const float *derivativeCutoff = params + kParamC * stride;
+    const float rate = 1.f / dt;
+
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        float *z = values + r * stride;
+        float *x = states + slots[r] * kFilterStates * stride;
+        float *d = x + kStateDerivative * stride;
+        long c = 0;
+
+#ifdef LEAP_SSE
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 tau = _mm_set1_ps(2.f * (float)M_PI * dt);
+        const __m128 sign = _mm_set1_ps(-0.f);
+
+        for (; c + 4 <= stride; c += 4)
+        {
+            const __m128 zc = _mm_loadu_ps(z + c);
+            const __m128 xc = _mm_loadu_ps(x + c);
+            const __m128 dc = _mm_loadu_ps(d + c);
+
+            // the speed, low-passed at the derivative cutoff
+            const __m128 rd = _mm_mul_ps(tau, _mm_loadu_ps(derivativeCutoff + c));
+            const __m128 ad = _mm_div_ps(rd, _mm_add_ps(one, rd));
+            const __m128 speed = _mm_mul_ps(_mm_sub_ps(zc, xc), _mm_set1_ps(rate));
+            const __m128 dn = _mm_add_ps(dc, _mm_mul_ps(ad, _mm_sub_ps(speed, dc)));
+
+            // the value, low-passed at a cutoff rising with the speed
+            const __m128 fc = _mm_add_ps(_mm_loadu_ps(minCutoff + c), _mm_mul_ps(_mm_loadu_ps(beta + c), _mm_andnot_ps(sign, dn)));
+            const __m128 rv = _mm_mul_ps(tau, fc);
+            const __m128 a = _mm_div_ps(rv, _mm_add_ps(one, rv));
+            const __m128 xn = _mm_add_ps(xc, _mm_mul_ps(a, _mm_sub_ps(zc, xc)));
+
+            _mm_storeu_ps(d + c, dn);
+            _mm_storeu_ps(x + c, xn);
+            _mm_storeu_ps(z + c, xn);
+        }
+#endif
+
+        for (; c < stride; c++)
+        {
+            d[c] += smoothing(derivativeCutoff[c], dt) * ((z[c] - x[c]) * rate - d[c]);
+            x[c] += smoothing(minCutoff[c] + beta[c] * fabsf(d[c]), dt) * (z[c] - x[c]);
+            z[c] = x[c];
+        }
+    }
+}
+
+void filterKalman(float *values, float *states, const uint32_t *slots, uint32_t rows, const float *params, float dt, long stride)
+{
+    const float *q = params + kParamA * stride;
+    const float *noise = params + kParamB * stride;
+
+    // white acceleration noise over dt
+    const float q00 = dt * dt * dt * dt * 0.25f;
+    const float q01 = dt * dt * dt * 0.5f;
+    const float q11 = dt * dt;
+
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        float *z = values + r * stride;
+        float *p = states + slots[r] * kFilterStates * stride;
+        float *v = p + kStateDerivative * stride;
+        float *p00 = p + kStateP00 * stride;
+        float *p01 = p + kStateP01 * stride;
+        float *p11 = p + kStateP11 * stride;
+        long c = 0;
+
+#ifdef LEAP_SSE
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 t = _mm_set1_ps(dt);
+        const __m128 two = _mm_set1_ps(2.f);
+
+        for (; c + 4 <= stride; c += 4)
+        {
+            const __m128 qc = _mm_loadu_ps(q + c);
+            const __m128 vc = _mm_loadu_ps(v + c);
+            const __m128 b01 = _mm_loadu_ps(p01 + c);
+            const __m128 b11 = _mm_loadu_ps(p11 + c);
+
+            // predict
+            const __m128 pp = _mm_add_ps(_mm_loadu_ps(p + c), _mm_mul_ps(vc, t));
+            const __m128 a00 = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(p00 + c), _mm_mul_ps(t, _mm_add_ps(_mm_mul_ps(two, b01), _mm_mul_ps(t, b11)))),
+                                          _mm_mul_ps(qc, _mm_set1_ps(q00)));
+            const __m128 a01 = _mm_add_ps(_mm_add_ps(b01, _mm_mul_ps(t, b11)), _mm_mul_ps(qc, _mm_set1_ps(q01)));
+            const __m128 a11 = _mm_add_ps(b11, _mm_mul_ps(qc, _mm_set1_ps(q11)));
+
+            // update with the measure
+            const __m128 s = _mm_add_ps(a00, _mm_loadu_ps(noise + c));
+            const __m128 k0 = _mm_div_ps(a00, s);
+            const __m128 k1 = _mm_div_ps(a01, s);
+            const __m128 y = _mm_sub_ps(_mm_loadu_ps(z + c), pp);
+            const __m128 pn = _mm_add_ps(pp, _mm_mul_ps(k0, y));
+
+            _mm_storeu_ps(p + c, pn);
+            _mm_storeu_ps(v + c, _mm_add_ps(vc, _mm_mul_ps(k1, y)));
+            _mm_storeu_ps(p00 + c, _mm_mul_ps(_mm_sub_ps(one, k0), a00));
+            _mm_storeu_ps(p01 + c, _mm_mul_ps(_mm_sub_ps(one, k0), a01));
+            _mm_storeu_ps(p11 + c, _mm_sub_ps(a11, _mm_mul_ps(k1, a01)));
+            _mm_storeu_ps(z + c, pn);
+        }
+#endif
+
+        for (; c < stride; c++)
+        {
+            const float pp = p[c] + v[c] * dt;
+            const float a00 = p00[c] + dt * (2.f * p01[c] + dt * p11[c]) + q[c] * q00;
+            const float a01 = p01[c] + dt * p11[c] + q[c] * q01;
+            const float a11 = p11[c] + q[c] * q11;
+
+            const float s = a00 + noise[c];
+            const float k0 = a00 / s;
+            const float k1 = a01 / s;
+            const float y = z[c] - pp;
+
+            p[c] = pp + k0 * y;
+            v[c] += k1 * y;
+            p00[c] = (1.f - k0) * a00;
+            p01[c] = (1.f - k0) * a01;
+            p11[c] = a11 - k1 * a01;
+            z[c] = p[c];
+        }
+    }
+}
+
+/// make the 3 channels from c unit vectors again
+template<class Table>
+static void normalize(Table &table, int c)
+{
+    float *x = table.channel(c);
+    float *y = table.channel(c + 1);
+    float *z = table.channel(c + 2);
+
+    for (uint32_t r = 0; r < table.count(); r++)
+    {
+        const float norm = sqrtf(x[r] * x[r] + y[r] * y[r] + z[r] * z[r]);
+        const float inverse = norm > 0.f ? 1.f / norm : 0.f;
+
+        x[r] *= inverse;
+        y[r] *= inverse;
+        z[r] *= inverse;
+    }
+}
+
+FrameFilter::FrameFilter() :
+m_hands(handScales),
+m_fingers(pointableScales),
+m_tools(pointableScales),
+m_timestamp(0)
+{
+}
+
+void FrameFilter::setup(const FilterSettings &settings)
+{
+    // the states of one filter mean nothing to the other
+    if (settings.mode != m_settings.mode)
+        reset();
+
+    m_settings = settings;
+    m_hands.setup(settings);
+    m_fingers.setup(settings);
+    m_tools.setup(settings);
+}
+
+void FrameFilter::reset()
+{
+    m_hands.reset();
+    m_fingers.reset();
+    m_tools.reset();
+    m_timestamp = 0;
+}
+
+void FrameFilter::apply(FrameSnapshot &snapshot)
+{
+    if (m_settings.mode == kFilterOff)
+        return;
+
+    // going back in time (e.g. a replay looping) or a long pause starts again from the measures
+    double dt = (snapshot.timestamp - m_timestamp) * 0.000001;
+
+    if (!m_timestamp || dt < 0. || dt > LEAP_FILTER_GAP)
+    {
+        reset();
+        dt = 0.;
+    }
+
+    // the same frame output twice or frames closer than 1 ms (a catch-up) barely move the filters
+    if (dt < 0.001)
+        dt = 0.001;
+
+    m_timestamp = snapshot.timestamp;
+
+    m_hands.apply(snapshot.hands, kHandId, m_settings.mode, dt);
+    m_fingers.apply(snapshot.fingers, kFingerId, m_settings.mode, dt);
+    m_tools.apply(snapshot.tools, kToolId, m_settings.mode, dt);
+
+    normalize(snapshot.hands, kHandDirectionX);
+    normalize(snapshot.hands, kHandNormalX);
+    normalize(snapshot.fingers, kFingerDirectionX);
+    normalize(snapshot.tools, kToolDirectionX);
+}
@@ -0,0 +1,216 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameFilter : One-Euro or Kalman smoothing of the tracked values of a FrameSnapshot
+ *
+ * @details Every float channel of hands, fingers and tools (positions, directions, velocities and scalars)
+ * is filtered, either by a One-Euro filter (a low-pass whose cutoff rises with speed) or by a constant
+ * velocity Kalman filter. The state of each tracked object lives in a slot of a SlotPool, found again by id
+ * at each frame : an id that disappears gives its slot back and an id that appears (e.g. a hand coming back)
+ * starts from its first measure instead of from another hand. A slot holds the channels of one object
+ * side by side, padded to a multiple of 4, so the filters run 4 channels at a time with SSE.
+ * Directions are normalized again once filtered. Bones and gestures are left as they are.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameFilter_h__
+#define __FrameFilter_h__
+
+#include "FrameSnapshot.h"
+#include "SlotPool.h"
+
+enum eFilterMode
+{
+    kFilterOff,
+    kFilterOneEuro,
+    kFilterKalman
+};
+
+struct FilterSettings
+{
+    FilterSettings() :
+    mode(kFilterOff),
+    minCutoff(1.), beta(0.007), derivativeCutoff(1.),
+    acceleration(3000.), noise(1.5) {}
+
+    long        mode;               // an eFilterMode
+    double      minCutoff;          // One-Euro : cutoff at rest (in Hz)
+    double      beta;               // One-Euro : cutoff increase per mm/s
+    double      derivativeCutoff;   // One-Euro : cutoff of the speed estimation (in Hz)
+    double      acceleration;       // Kalman : standard deviation of the acceleration (in mm/s²)
+    double      noise;              // Kalman : standard deviation of the measure (in mm)
+};
+
+/// state of a slot : kFilterStates runs of channels
+enum eFilterState
+{
+    kStateValue,            // filtered value
+    kStateDerivative,       // One-Euro : filtered speed, Kalman : speed
+    kStateP00,              // Kalman covariance
+    kStateP01,
+    kStateP11,
+    kFilterStates
+};
+
+/// per channel parameters : One-Euro min cutoff, beta and derivative cutoff or Kalman process noise, measure noise and initial speed variance
+enum eFilterParam
+{
+    kParamA,
+    kParamB,
+    kParamC,
+    kFilterParams
+};
+
+/// make the state of a new slot from its first measure
+void filterStart(float *state, const float *values, const float *params, long stride);
+
+/// filter rows of stride values in place, the state of row r being in the slot slots[r]
+void filterOneEuro(float *values, float *states, const uint32_t *slots, uint32_t rows, const float *params, float dt, long stride);
+void filterKalman(float *values, float *states, const uint32_t *slots, uint32_t rows, const float *params, float dt, long stride);
+
+/** The filter states of the rows of one kind of SnapshotTable, pooled by id.
+    Memory only grows : once it has seen its largest number of objects, filtering does not allocate. */
+template<int kChannels>
+class FilterBank
+{
+public:
+    enum { stride = (kChannels + 3) & ~3 };
+
+    /// scales[c] is the number of mm one unit of channel c stands for (1 for positions, e.g. 100 for directions)
+    FilterBank(const float *scales) : m_rows(0)
+    {
+        for (int c = 0; c < stride; c++)
+            m_scales[c] = c < kChannels ? scales[c] : 1.f;
+
+        setup(FilterSettings());
+    }
+
+    /// parameters of every channel, expressed in its own unit
+    void setup(const FilterSettings &settings)
+    {
+        for (int c = 0; c < stride; c++)
+        {
+            const double scale = m_scales[c];
+
+            if (settings.mode == kFilterKalman)
+            {
+                m_params[kParamA * stride + c] = settings.acceleration * settings.acceleration / (scale * scale);
+                m_params[kParamB * stride + c] = settings.noise * settings.noise / (scale * scale);
+                m_params[kParamC * stride + c] = 1000. * 1000. / (scale * scale);
+            }
+            else
+            {
+                m_params[kParamA * stride + c] = settings.minCutoff;
+                m_params[kParamB * stride + c] = settings.beta * scale;
+                m_params[kParamC * stride + c] = settings.derivativeCutoff;
+            }
+        }
+    }
+
+    /// give every slot back
+    void reset()
+    {
+        m_pool.reset();
+        m_rows = 0;
+    }
+
+    /// number of objects being filtered
+    uint32_t active() const { return m_pool.active(); }
+
+    /// filter the rows of a table, whose ids are in field idField
+    template<class Table>
+    void apply(Table &table, int idField, long mode, float dt)
+    {
+        const uint32_t rows = table.count();
+
+        if (m_values.size() < (size_t)rows * stride)
+            m_values.resize(rows * stride, 0.f);
+
+        if (m_rowSlots.size() < rows)
+            m_rowSlots.resize(rows);
+
+        m_pool.begin();
+
+        // the slot of each row : most of the time the one of the same row in the previous frame
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            const int32_t id = table.integer(idField, r);
+            float *values = &m_values[r * stride];
+
+            for (int c = 0; c < kChannels; c++)
+                values[c] = table.value(c, r);
+
+            uint32_t slot = m_pool.find(id, r < m_rows ? m_rowSlots[r] : 0);
+
+            if (slot == m_pool.capacity())
+            {
+                slot = m_pool.acquire(id);
+
+                if (m_states.size() < (size_t)m_pool.capacity() * kFilterStates * stride)
+                    m_states.resize(m_pool.capacity() * kFilterStates * stride, 0.f);
+
+                filterStart(&m_states[slot * kFilterStates * stride], values, m_params, stride);
+            }
+
+            m_pool.mark(slot);
+            m_rowSlots[r] = slot;
+        }
+
+        // the slots of the ids that disappeared are given back
+        m_pool.end();
+        m_rows = rows;
+
+        if (!rows)
+            return;
+
+        if (mode == kFilterKalman)
+            filterKalman(&m_values[0], &m_states[0], &m_rowSlots[0], rows, m_params, dt, stride);
+        else
+            filterOneEuro(&m_values[0], &m_states[0], &m_rowSlots[0], rows, m_params, dt, stride);
+
+        for (uint32_t r = 0; r < rows; r++)
+            for (int c = 0; c < kChannels; c++)
+                table.value(c, r) = m_values[r * stride + c];
+    }
+
+private:
+    float                   m_scales[stride];
+    float                   m_params[kFilterParams * stride];
+    SlotPool                m_pool;
+    std::vector<float>      m_states;       // kFilterStates runs of stride floats per slot
+    std::vector<uint32_t>   m_rowSlots;     // slot of each row of the latest frame
+    uint32_t                m_rows;         // rows of the latest frame
+    std::vector<float>      m_values;       // the rows being filtered, stride floats each
+};
+
+class FrameFilter
+{
+public:
+    FrameFilter();
+
+    void setup(const FilterSettings &settings);
+
+    const FilterSettings &settings() const { return m_settings; }
+
+    /// filter a snapshot in place (nothing happens when the mode is kFilterOff)
+    void apply(FrameSnapshot &snapshot);
+
+    /// forget every object : the next frame starts the filters again
+    void reset();
+
+private:
+    FilterSettings              m_settings;
+    FilterBank<kHandChannels>   m_hands;
+    FilterBank<kFingerChannels> m_fingers;
+    FilterBank<kToolChannels>   m_tools;
+    int64_t                     m_timestamp;    // of the latest filtered frame, 0 after a reset
+};
+
+#endif // __FrameFilter_h__
@@ -0,0 +1,143 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameOutput : send a FrameSnapshot to outlets as lists or as one packed list
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FrameOutput.h"
+
+/// output the bones of the hand whose bones start at row first and return the row after them
+static uint32_t outputHandBones(const FrameSnapshot &snapshot, uint32_t first, t_symbol **symbols, void *outlet)
+{
+    t_atom data[LEAP_BONES_HEADER_ATOMS + LEAP_HAND_BONES_MAX * LEAP_BONE_ATOMS];
+    
+    const uint32_t count = handBoneCount(snapshot, first);
+    const long size = encodeHandBones(snapshot, first, count, data);
+    
+    outlet_anything(outlet, symbols[kSymbolList], size, data);
+    return first + count;
+}
+
+/// output the joints of the hand whose joints start at row first and return the row after them
+static uint32_t outputHandJoints(const JointTable &joints, uint32_t first, t_symbol **symbols, void *outlet)
+{
+    t_atom data[LEAP_BONES_HEADER_ATOMS + LEAP_HAND_JOINTS_MAX * LEAP_JOINT_ATOMS];
+    uint32_t last = first;
+    
+    while (last < joints.count() && joints.integer(kJointHandId, last) == joints.integer(kJointHandId, first))
+        last++;
+    
+    const long size = encodeHandJoints(joints, first, last - first, data);
+    
+    outlet_anything(outlet, symbols[kSymbolJoints], size, data);
+    return last;
+}
+
+void outputLists(const FrameSnapshot &snapshot, t_symbol **symbols, void **outlets, bool bones, const JointTable *joints)
+{
+    // theo : use our own list symbol because the _sym_list crashes
+    t_symbol *j_sym_list = symbols[kSymbolList];
+    
+    t_atom data[LEAP_HAND_ATOMS];
+    long size;
+	
+    outputFrameStart(snapshot, symbols, outlets);
+    
+    /// output hand and finger info /////////////////////////////////////////
+    const HandTable &hands = snapshot.hands;
+    const BoneTable &boneTable = snapshot.bones;
+    uint32_t bone = 0;
+    uint32_t joint = 0;
+    
+    for (uint32_t i = 0; i < hands.count(); i++)
+    {
+        size = encodeHand(snapshot, i, data);
+        outlet_anything(outlets[kOutletHand], j_sym_list, size, data);
+        
+        const uint32_t first = hands.integer(kHandFirstFinger, i);
+        const uint32_t last = first + hands.integer(kHandFingerCount, i);
+        
+        for (uint32_t j = first; j < last; j++)
+        {
+            size = encodeFinger(snapshot, j, data);
+            outlet_anything(outlets[kOutletFinger], j_sym_list, size, data);
+        }
+        
+        // the whole skeleton of the hand in one message
+        if (bones && bone < boneTable.count() && boneTable.integer(kBoneHandId, bone) == hands.integer(kHandId, i))
+            bone = outputHandBones(snapshot, bone, symbols, outlets[kOutletBone]);
+        
+        if (joints && joint < joints->count() && joints->integer(kJointHandId, joint) == hands.integer(kHandId, i))
+            joint = outputHandJoints(*joints, joint, symbols, outlets[kOutletBone]);
+    }
+    
+    /// output tool info ////////////////////////////////////////////////////
+    for (uint32_t i = 0; i < snapshot.tools.count(); i++)
+    {
+        size = encodeTool(snapshot, i, data);
+        outlet_anything(outlets[kOutletTool], j_sym_list, size, data);
+    }
+    
+    outputFrameEnd(snapshot, symbols, outlets);
+}
+
+void outputFrameStart(const FrameSnapshot &snapshot, t_symbol **symbols, void **outlets)
+{
+    t_atom data[LEAP_FRAME_ATOMS];
+    
+    /// output start frame bang /////////////////////////////////////////////
+    outlet_bang(outlets[kOutletStartFrame]);
+    
+    /// output frame info ///////////////////////////////////////////////////
+    const long size = encodeFrame(snapshot, data);
+	outlet_anything(outlets[kOutletFrame], symbols[kSymbolList], size, data);
+}
+
+void outputFrameEnd(const FrameSnapshot &snapshot, t_symbol **symbols, void **outlets)
+{
+    t_atom data[LEAP_GESTURE_ATOMS_MAX];
+    
+    /// output gesture info /////////////////////////////////////////////////
+    for (uint32_t i = 0; i < snapshot.gestures.count(); i++)
+    {
+        const long size = encodeGesture(snapshot, i, symbols, data);
+        outlet_anything(outlets[kOutletGesture], symbols[kSymbolList], size, data);
+    }
+	
+     /// output end frame bang /////////////////////////////////////////////
+	outlet_bang(outlets[kOutletEndFrame]);
+}
+
+void outputPacked(const FrameSnapshot &snapshot, t_symbol **symbols, std::vector<t_atom> &packed, void *outlet)
+{
+    // the buffer only grows so steady state output does not allocate
+    const long size = packedSize(snapshot);
+    if (packed.size() < (size_t)size)
+        packed.resize(size);
+    
+    encodePacked(snapshot, symbols, &packed[0]);
+    
+    // the whole frame in one message
+    outlet_anything(outlet, symbols[kSymbolList], size, &packed[0]);
+}
+
+void outputBones(const FrameSnapshot &snapshot, t_symbol **symbols, void *outlet)
+{
+    for (uint32_t bone = 0; bone < snapshot.bones.count(); )
+        bone = outputHandBones(snapshot, bone, symbols, outlet);
+}
+
+void outputJoints(const JointTable &joints, t_symbol **symbols, void *outlet)
+{
+    for (uint32_t joint = 0; joint < joints.count(); )
+        joint = outputHandJoints(joints, joint, symbols, outlet);
+}
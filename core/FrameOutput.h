@@ -0,0 +1,58 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameOutput : send a FrameSnapshot to outlets as lists or as one packed list
+ *
+ * @details These are the list and packed output paths of j.leapmotion, kept apart from the
+ * object so that the benchmark driver runs exactly the same code (see bench/).
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameOutput_h__
+#define __FrameOutput_h__
+
+#include "FrameEncode.h"
+
+#include <vector>
+
+/// the list outlets, in the order of j.leapmotion outlets (right to left creation makes end frame the leftmost)
+/// except for the bone outlet which comes after the matrix and stats outlets
+enum eOutlet
+{
+    kOutletEndFrame,
+    kOutletGesture,
+    kOutletTool,
+    kOutletFinger,
+    kOutletHand,
+    kOutletFrame,
+    kOutletStartFrame,
+    kOutletBone,
+    kOutlets
+};
+
+/// start frame bang, frame, every hand followed by its fingers (then its bones when bones is true
+/// and its joints when joints are given), every tool, every gesture then end frame bang
+void outputLists(const FrameSnapshot &snapshot, t_symbol **symbols, void **outlets, bool bones = false, const JointTable *joints = NULL);
+
+/// start frame bang then frame (what outputLists sends before the hands)
+void outputFrameStart(const FrameSnapshot &snapshot, t_symbol **symbols, void **outlets);
+
+/// every gesture then end frame bang (what outputLists sends after the tools)
+void outputFrameEnd(const FrameSnapshot &snapshot, t_symbol **symbols, void **outlets);
+
+/// the skeleton of every hand, one list per hand (see encodeHandBones)
+void outputBones(const FrameSnapshot &snapshot, t_symbol **symbols, void *outlet);
+
+/// the joints of every hand, one joints message per hand (see encodeHandJoints)
+void outputJoints(const JointTable &joints, t_symbol **symbols, void *outlet);
+
+/// the whole frame as one list (see encodePacked) on the frame outlet, packed only grows
+void outputPacked(const FrameSnapshot &snapshot, t_symbol **symbols, std::vector<t_atom> &packed, void *outlet);
+
+#endif // __FrameOutput_h__
@@ -0,0 +1,240 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FramePredictor : extrapolate the positions of a FrameSnapshot forward in time
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FramePredictor.h"
+#include "LeapSimd.h"
+
+// a pause longer than this (in microseconds) starts new histories
+#define LEAP_PREDICT_GAP 500000
+
+void predictWeights(const int64_t *times, uint32_t count, double horizon, double damping, float *weights)
+{
+    for (uint32_t i = 0; i < count; i++)
+        weights[i] = 0.f;
+
+    if (count < 2)
+        return;
+
+    // times in ms from the newest sample
+    double t[LEAP_PREDICT_HISTORY];
+
+    for (uint32_t i = 0; i < count; i++)
+        t[i] = (times[i] - times[0]) * 0.001;
+
+    // least squares fit of x(t) = c0 + c1 t + c2 t² : c1 and c2 are rows of the inverse of the normal matrix
+    // applied to (1, t, t²) of each sample, the prediction adds c1 h + c2 h² (1 - damping) to the newest sample
+    if (count >= 3)
+    {
+        double s[5] = {0., 0., 0., 0., 0.};
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            double power = 1.;
+
+            for (int k = 0; k < 5; k++)
+            {
+                s[k] += power;
+                power *= t[i];
+            }
+        }
+
+        // cofactors of the symmetric matrix [s0 s1 s2, s1 s2 s3, s2 s3 s4]
+        const double c01 = s[2] * s[3] - s[1] * s[4];
+        const double c02 = s[1] * s[3] - s[2] * s[2];
+        const double c11 = s[0] * s[4] - s[2] * s[2];
+        const double c12 = s[1] * s[2] - s[0] * s[3];
+        const double c22 = s[0] * s[2] - s[1] * s[1];
+        const double det = s[0] * (s[2] * s[4] - s[3] * s[3]) + s[1] * c01 + s[2] * c02;
+
+        // samples too close in time to tell an acceleration fall back to a line
+        if (det > 1e-6 * s[0] * s[2] * s[4])
+        {
+            const double k1 = horizon / det;
+            const double k2 = horizon * horizon * (1. - damping) / det;
+
+            for (uint32_t i = 0; i < count; i++)
+                weights[i] = k1 * (c01 + t[i] * (c11 + t[i] * c12)) + k2 * (c02 + t[i] * (c12 + t[i] * c22));
+
+            return;
+        }
+    }
+
+    // least squares fit of x(t) = c0 + c1 t
+    double mean = 0.;
+    double spread = 0.;
+
+    for (uint32_t i = 0; i < count; i++)
+        mean += t[i];
+
+    mean /= count;
+
+    for (uint32_t i = 0; i < count; i++)
+        spread += (t[i] - mean) * (t[i] - mean);
+
+    if (spread > 0.)
+        for (uint32_t i = 0; i < count; i++)
+            weights[i] = horizon * (t[i] - mean) / spread;
+}
+
+void predictValues(float *values, const float *const *samples, uint32_t count, const float *weights, long stride)
+{
+    long c = 0;
+
+#ifdef LEAP_SSE
+    for (; c + 4 <= stride; c += 4)
+    {
+        __m128 value = _mm_loadu_ps(values + c);
+
+        for (uint32_t i = 0; i < count; i++)
+            value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(samples[i] + c)));
+
+        _mm_storeu_ps(values + c, value);
+    }
+#endif
+
+    for (; c < stride; c++)
+        for (uint32_t i = 0; i < count; i++)
+            values[c] += weights[i] * samples[i][c];
+}
+
+PredictorBank::PredictorBank(int first, int channels) :
+m_first(first),
+m_channels(channels),
+m_stride((channels + 3) & ~3),
+m_rows(0),
+m_weightCount(0)
+{
+    for (int c = 0; c < LEAP_PREDICT_STRIDE_MAX; c++)
+        m_values[c] = 0.f;
+}
+
+void PredictorBank::reset()
+{
+    m_pool.reset();
+    m_rows = 0;
+}
+
+uint32_t PredictorBank::acquire(int32_t id)
+{
+    const uint32_t slot = m_pool.acquire(id);
+    const uint32_t capacity = m_pool.capacity();
+
+    if (m_counts.size() < capacity)
+    {
+        m_history.resize(capacity * LEAP_PREDICT_HISTORY * m_stride, 0.f);
+        m_times.resize(capacity * LEAP_PREDICT_HISTORY, 0);
+        m_counts.resize(capacity, 0);
+        m_heads.resize(capacity, 0);
+    }
+
+    m_counts[slot] = 0;
+    m_heads[slot] = 0;
+    return slot;
+}
+
+void PredictorBank::predict(uint32_t slot, int64_t timestamp, const PredictSettings &settings)
+{
+    float *history = &m_history[slot * LEAP_PREDICT_HISTORY * m_stride];
+    int64_t *times = &m_times[slot * LEAP_PREDICT_HISTORY];
+    uint32_t &count = m_counts[slot];
+    uint32_t &head = m_heads[slot];
+
+    // the same frame output twice replaces its sample instead of adding one
+    if (!count || times[head] != timestamp)
+    {
+        head = (head + 1) % LEAP_PREDICT_HISTORY;
+
+        if (count < LEAP_PREDICT_HISTORY)
+            count++;
+    }
+
+    times[head] = timestamp;
+    memcpy(history + head * m_stride, m_values, m_stride * sizeof(float));
+
+    // newest first
+    const float *samples[LEAP_PREDICT_HISTORY];
+    bool same = count == m_weightCount &&
+        settings.horizon == m_weightSettings.horizon && settings.damping == m_weightSettings.damping;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t sample = (head + LEAP_PREDICT_HISTORY - i) % LEAP_PREDICT_HISTORY;
+
+        samples[i] = history + sample * m_stride;
+        same = same && times[sample] == m_weightTimes[i];
+        m_weightTimes[i] = times[sample];
+    }
+
+    if (!same)
+    {
+        m_weightCount = count;
+        m_weightSettings = settings;
+        predictWeights(m_weightTimes, count, settings.horizon, settings.damping, m_weights);
+    }
+
+    predictValues(m_values, samples, count, m_weights, m_stride);
+}
+
+/// the ids of the rows of a table (NULL when it has none)
+template<class Table>
+static const int32_t *rowIds(Table &table, int idField)
+{
+    return table.count() ? &table.integer(idField, 0) : NULL;
+}
+
+FramePredictor::FramePredictor() :
+m_hands(kHandPalmX, 3),
+m_fingers(kFingerTipX, 3),
+m_tools(kToolTipX, 3),
+m_bones(kBonePrevX, 9),     // previous joint, next joint and center
+m_timestamp(0)
+{
+}
+
+void FramePredictor::reset()
+{
+    m_hands.reset();
+    m_fingers.reset();
+    m_tools.reset();
+    m_bones.reset();
+    m_timestamp = 0;
+}
+
+void FramePredictor::apply(FrameSnapshot &snapshot)
+{
+    if (m_settings.horizon <= 0.)
+        return;
+
+    // going back in time (e.g. a replay looping) or a long pause makes the histories meaningless
+    if (m_timestamp && (snapshot.timestamp < m_timestamp || snapshot.timestamp - m_timestamp > LEAP_PREDICT_GAP))
+        reset();
+
+    m_timestamp = snapshot.timestamp;
+
+    m_hands.apply(snapshot.hands, rowIds(snapshot.hands, kHandId), snapshot.timestamp, m_settings);
+    m_fingers.apply(snapshot.fingers, rowIds(snapshot.fingers, kFingerId), snapshot.timestamp, m_settings);
+    m_tools.apply(snapshot.tools, rowIds(snapshot.tools, kToolId), snapshot.timestamp, m_settings);
+
+    const BoneTable &bones = snapshot.bones;
+
+    if (m_boneIds.size() < bones.count())
+        m_boneIds.resize(bones.count());
+
+    // the arm has finger type -1
+    for (uint32_t r = 0; r < bones.count(); r++)
+        m_boneIds[r] = (bones.integer(kBoneHandId, r) * 6 + bones.integer(kBoneFingerType, r) + 1) * kBoneTypes + bones.integer(kBoneType, r);
+
+    m_bones.apply(snapshot.bones, m_boneIds.empty() ? NULL : &m_boneIds[0], snapshot.timestamp, m_settings);
+}
@@ -0,0 +1,149 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FramePredictor : extrapolate the positions of a FrameSnapshot forward in time
+ *
+ * @details The palm, fingertip, tool tip and bone joint positions are moved forward by a horizon
+ * (e.g. 10 to 30 ms) to compensate for the latency of what comes after the external (a projector, a
+ * renderer...). Each tracked object keeps its LEAP_PREDICT_HISTORY latest positions with their
+ * timestamps in a slot of a SlotPool, found again by id. The velocity and the acceleration are fitted
+ * by least squares over that history, so that the uneven spacing of the frames is taken into account,
+ * and the acceleration term is damped to avoid overshooting when a motion stops or turns back.
+ * Prediction is linear in the positions : the joints shared by two bones stay shared.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FramePredictor_h__
+#define __FramePredictor_h__
+
+#include "FrameSnapshot.h"
+#include "SlotPool.h"
+
+// number of positions an object remembers (at 110 fps, the last 30 ms)
+#define LEAP_PREDICT_HISTORY 4
+
+// most channels predicted per row (the 9 of a bone) padded to a multiple of 4
+#define LEAP_PREDICT_STRIDE_MAX 12
+
+struct PredictSettings
+{
+    PredictSettings() : horizon(0.), damping(0.5) {}
+
+    double      horizon;            // how far to predict (in ms), 0 turns prediction off
+    double      damping;            // share of the acceleration left out : 0 for a quadratic motion, 1 for a linear one
+};
+
+/** Weights that give the prediction from the count latest samples of an object (times in µs, newest first) :
+    prediction = sample 0 + sum of weights[i] × sample i. Less than 2 samples give null weights. */
+void predictWeights(const int64_t *times, uint32_t count, double horizon, double damping, float *weights);
+
+/// apply the weights to stride values, the samples being count runs of stride floats
+void predictValues(float *values, const float *const *samples, uint32_t count, const float *weights, long stride);
+
+/** The position histories of the rows of one kind of SnapshotTable, pooled by id.
+    Memory only grows : once it has seen its largest number of objects, predicting does not allocate. */
+class PredictorBank
+{
+public:
+    /// predict the channels [first, first + channels[ of a table (e.g. the 3 channels of the palm position)
+    PredictorBank(int first, int channels);
+
+    void reset();
+
+    /// number of objects being predicted
+    uint32_t active() const { return m_pool.active(); }
+
+    /// remember the positions of the rows of a table, whose ids are in ids, then replace them by their prediction
+    template<class Table>
+    void apply(Table &table, const int32_t *ids, int64_t timestamp, const PredictSettings &settings)
+    {
+        const uint32_t rows = table.count();
+
+        if (m_rowSlots.size() < rows)
+            m_rowSlots.resize(rows);
+
+        m_pool.begin();
+
+        // the slot of each row : most of the time the one of the same row in the previous frame
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            uint32_t slot = m_pool.find(ids[r], r < m_rows ? m_rowSlots[r] : 0);
+
+            if (slot == m_pool.capacity())
+                slot = acquire(ids[r]);
+
+            m_pool.mark(slot);
+            m_rowSlots[r] = slot;
+
+            for (int c = 0; c < m_channels; c++)
+                m_values[c] = table.value(m_first + c, r);
+
+            predict(slot, timestamp, settings);
+
+            for (int c = 0; c < m_channels; c++)
+                table.value(m_first + c, r) = m_values[c];
+        }
+
+        // the histories of the ids that disappeared are given back
+        m_pool.end();
+        m_rows = rows;
+    }
+
+private:
+    uint32_t acquire(int32_t id);
+
+    /// push m_values into the history of a slot and replace them by their prediction
+    void predict(uint32_t slot, int64_t timestamp, const PredictSettings &settings);
+
+    int                     m_first;
+    int                     m_channels;
+    long                    m_stride;       // channels padded to a multiple of 4
+    SlotPool                m_pool;
+    std::vector<float>      m_history;      // LEAP_PREDICT_HISTORY runs of m_stride floats per slot
+    std::vector<int64_t>    m_times;        // LEAP_PREDICT_HISTORY timestamps per slot
+    std::vector<uint32_t>   m_counts;       // samples in the history of each slot
+    std::vector<uint32_t>   m_heads;        // newest sample of each slot
+    std::vector<uint32_t>   m_rowSlots;     // slot of each row of the latest frame
+    uint32_t                m_rows;         // rows of the latest frame
+    float                   m_values[LEAP_PREDICT_STRIDE_MAX];  // the row being predicted
+
+    // the objects tracked since a few frames share their sample times : their weights are computed once
+    int64_t                 m_weightTimes[LEAP_PREDICT_HISTORY];
+    uint32_t                m_weightCount;
+    PredictSettings         m_weightSettings;
+    float                   m_weights[LEAP_PREDICT_HISTORY];
+};
+
+class FramePredictor
+{
+public:
+    FramePredictor();
+
+    void setup(const PredictSettings &settings) { m_settings = settings; }
+
+    const PredictSettings &settings() const { return m_settings; }
+
+    /// predict a snapshot in place (nothing happens when the horizon is 0)
+    void apply(FrameSnapshot &snapshot);
+
+    /// forget every object : the next frames start new histories
+    void reset();
+
+private:
+    PredictSettings         m_settings;
+    PredictorBank           m_hands;
+    PredictorBank           m_fingers;
+    PredictorBank           m_tools;
+    PredictorBank           m_bones;
+    std::vector<int32_t>    m_boneIds;      // a bone has no id : one is made of its hand id, finger type and bone type
+    int64_t                 m_timestamp;    // of the latest predicted frame, 0 after a reset
+};
+
+#endif // __FramePredictor_h__
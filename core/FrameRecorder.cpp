@@ -0,0 +1,217 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameRecorder : append snapshots to a FrameFile from a background thread
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FrameRecorder.h"
+
+#include <chrono>
+#include <thread>
+
+// how long the writer thread sleeps when there is nothing to write
+#define LEAP_RECORD_PERIOD_MS 10
+
+FrameRecorder::FrameRecorder() :
+m_file(NULL),
+m_running(false),
+m_accepting(false),
+m_pushing(0),
+m_failed(false),
+m_ring(new char[LEAP_RECORD_RING_SIZE]),
+m_head(0),
+m_tail(0),
+m_recorded(0),
+m_dropped(0),
+m_offset(0),
+m_written(0)
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+    delete [] m_ring;
+}
+
+bool FrameRecorder::open(const char *path)
+{
+    close();
+
+    m_file = fopen(path, "wb");
+
+    if (!m_file)
+        return false;
+
+    // large writes : the writer thread hands whole batches over
+    setvbuf(m_file, NULL, _IOFBF, 256 * 1024);
+
+    FrameFileHeader header;
+    frameFileHeader(header);
+
+    // push never allocates
+    m_scratch.resize(LEAP_RECORD_MAX_SIZE);
+
+    m_head.store(0);
+    m_tail.store(0);
+    m_recorded = 0;
+    m_dropped = 0;
+    m_index.clear();
+    m_offset = sizeof(header);
+    m_written = 0;
+    m_failed.store(fwrite(&header, sizeof(header), 1, m_file) != 1);
+
+    m_running.store(true);
+    m_thread = std::thread(&FrameRecorder::run, this);
+
+    // from now on push queues frames
+    m_accepting.store(true);
+    return true;
+}
+
+bool FrameRecorder::close()
+{
+    if (!m_file)
+        return true;
+
+    // no push starts from now on and the one in progress (if any) ends in the ring
+    m_accepting.store(false);
+
+    while (m_pushing.load())
+        std::this_thread::yield();
+
+    // the writer thread writes what is still queued before it stops
+    m_running.store(false);
+    m_thread.join();
+
+    // the sparse index then the trailer pointing at it
+    // (a file missing some records must not look complete : it is left without them)
+    bool failed = m_failed.load();
+
+    if (!failed)
+    {
+        FrameFileTrailer trailer;
+        trailer.magic = LEAP_INDEX_MAGIC;
+        trailer.entries = m_index.size();
+        trailer.frames = m_written;
+        trailer.indexOffset = m_offset;
+
+        if (!m_index.empty())
+            failed = fwrite(&m_index[0], sizeof(FrameIndexEntry), m_index.size(), m_file) != m_index.size();
+
+        if (!failed)
+            failed = fwrite(&trailer, sizeof(trailer), 1, m_file) != 1;
+    }
+
+    if (fclose(m_file) != 0)
+        failed = true;
+
+    m_file = NULL;
+    return !failed;
+}
+
+bool FrameRecorder::push(const FrameSnapshot &snapshot)
+{
+    // close waits for m_pushing to fall back to 0 once it stopped accepting frames
+    m_pushing++;
+
+    if (!m_accepting.load())
+    {
+        m_pushing--;
+        return false;
+    }
+
+    const uint32_t size = frameRecordSize(snapshot);
+    const uint64_t head = m_head.load(std::memory_order_relaxed);
+
+    if (size > m_scratch.size() || head + size - m_tail.load(std::memory_order_acquire) > LEAP_RECORD_RING_SIZE)
+    {
+        m_dropped++;
+        m_pushing--;
+        return false;
+    }
+
+    writeFrameRecord(snapshot, &m_scratch[0]);
+
+    // copy the record into the ring, in two parts when it wraps around
+    const uint32_t start = head % LEAP_RECORD_RING_SIZE;
+    const uint32_t first = size < LEAP_RECORD_RING_SIZE - start ? size : LEAP_RECORD_RING_SIZE - start;
+
+    memcpy(m_ring + start, &m_scratch[0], first);
+    memcpy(m_ring, &m_scratch[first], size - first);
+
+    m_head.store(head + size, std::memory_order_release);
+    m_recorded++;
+    m_pushing--;
+    return true;
+}
+
+void FrameRecorder::run()
+{
+    bool running = true;
+
+    while (running)
+    {
+        // read the flag before writing so that nothing pushed before close is left behind
+        running = m_running.load();
+
+        write();
+
+        if (running)
+            std::this_thread::sleep_for(std::chrono::milliseconds(LEAP_RECORD_PERIOD_MS));
+    }
+
+    if (fflush(m_file) != 0)
+        m_failed.store(true);
+}
+
+void FrameRecorder::write()
+{
+    const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    const uint64_t head = m_head.load(std::memory_order_acquire);
+
+    if (head == tail)
+        return;
+
+    // index the records about to be written
+    for (uint64_t record = tail; record < head; )
+    {
+        FrameRecordHeader header;
+        const uint32_t at = record % LEAP_RECORD_RING_SIZE;
+        const uint32_t first = sizeof(header) < LEAP_RECORD_RING_SIZE - at ? sizeof(header) : LEAP_RECORD_RING_SIZE - at;
+
+        memcpy(&header, m_ring + at, first);
+        memcpy((char*)&header + first, m_ring, sizeof(header) - first);
+
+        if (m_written % LEAP_INDEX_STRIDE == 0)
+        {
+            FrameIndexEntry entry = {header.id, header.timestamp, m_offset};
+            m_index.push_back(entry);
+        }
+
+        m_offset += header.size;
+        m_written++;
+        record += header.size;
+    }
+
+    // everything queued at once, in two parts when it wraps around
+    // (after a failed write the ring is still emptied so that the caller never blocks)
+    const uint32_t start = tail % LEAP_RECORD_RING_SIZE;
+    const uint64_t size = head - tail;
+    const uint64_t first = size < LEAP_RECORD_RING_SIZE - start ? size : LEAP_RECORD_RING_SIZE - start;
+
+    if (!m_failed.load(std::memory_order_relaxed) &&
+        (fwrite(m_ring + start, 1, first, m_file) != first || fwrite(m_ring, 1, size - first, m_file) != size - first))
+        m_failed.store(true);
+
+    m_tail.store(head, std::memory_order_release);
+}
@@ -0,0 +1,88 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameRecorder : append snapshots to a FrameFile from a background thread
+ *
+ * @details The caller (the Max scheduler) only serializes each snapshot into a preallocated
+ * lock-free byte ring. A writer thread wakes up regularly, writes whatever is queued in as few
+ * calls as possible and leaves the disk syncs to itself. When the ring is full (the disk stalled
+ * for longer than the ring holds) frames are dropped and counted instead of blocking the caller.
+ * While writing, the writer thread keeps the sparse index that close appends to the file.
+ * open and close may be called from another thread than push : close stops accepting frames
+ * and waits for a push in progress before the writer thread is stopped.
+ * A file whose writes failed (e.g. the disk is full) is closed without index, and close reports it.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameRecorder_h__
+#define __FrameRecorder_h__
+
+#include "FrameFile.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+// bytes queued between the caller and the writer thread (a few seconds of frames at 120 fps)
+#define LEAP_RECORD_RING_SIZE (4 * 1024 * 1024)
+
+// largest record pushed (a few hundred bones), larger ones are dropped
+#define LEAP_RECORD_MAX_SIZE (64 * 1024)
+
+class FrameRecorder
+{
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+
+    /// create (or truncate) a file and start the writer thread, false if the file can't be opened
+    bool open(const char *path);
+
+    /// queue the remaining frames to the file, stop the writer thread and close the file,
+    /// false if something could not be written (the file then has no index)
+    bool close();
+
+    bool isOpen() const { return m_accepting.load(); }
+
+    /// caller side : queue a snapshot, false (and counted as dropped) if the ring is full or the record too large
+    bool push(const FrameSnapshot &snapshot);
+
+    uint64_t recorded() const { return m_recorded; }
+
+    uint64_t dropped() const { return m_dropped; }
+
+private:
+    void run();
+    void write();
+
+    FILE                    *m_file;
+    std::thread             m_thread;
+    std::atomic<bool>       m_running;
+    std::atomic<bool>       m_accepting;    // push queues frames (between open and close)
+    std::atomic<int>        m_pushing;      // number of push in progress, close waits for none
+    std::atomic<bool>       m_failed;       // a write failed
+
+    char                    *m_ring;        // LEAP_RECORD_RING_SIZE bytes
+    char                    m_padHead[64];  // keep producer and consumer indices on separate cache lines
+    std::atomic<uint64_t>   m_head;         // bytes pushed since open
+    char                    m_padTail[64 - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t>   m_tail;         // bytes written since open
+
+    std::vector<char>       m_scratch;      // the record being pushed (LEAP_RECORD_MAX_SIZE bytes once opened)
+    uint64_t                m_recorded;
+    uint64_t                m_dropped;
+
+    // writer thread side
+    std::vector<FrameIndexEntry>    m_index;
+    uint64_t                m_offset;       // in the file of the next record
+    uint64_t                m_written;      // number of records written
+};
+
+#endif // __FrameRecorder_h__
@@ -0,0 +1,301 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameReplay : read a FrameFile through a memory map
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "FrameReplay.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FrameReplay::FrameReplay() :
+m_data(NULL),
+m_size(0),
+m_mapping(NULL),
+m_handle(NULL),
+m_begin(0),
+m_end(0),
+m_cursor(0),
+m_frames(0),
+m_firstTimestamp(0),
+m_index(NULL),
+m_entries(0)
+{
+}
+
+FrameReplay::~FrameReplay()
+{
+    close();
+}
+
+bool FrameReplay::open(const char *path)
+{
+    close();
+
+#ifdef WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+
+    if (GetFileSizeEx(file, &size) && size.QuadPart)
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    m_size = size.QuadPart;
+    m_mapping = mapping;
+    m_handle = file;
+#else
+    const int file = ::open(path, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    void *data = MAP_FAILED;
+
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+        data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // the mapping stays valid once the file is closed
+    ::close(file);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    m_data = (const char*)data;
+    m_size = status.st_size;
+#endif
+
+    if (!m_data)
+    {
+        close();
+        return false;
+    }
+
+    FrameFileHeader header;
+
+    if (m_size < sizeof(header))
+    {
+        close();
+        return false;
+    }
+
+    memcpy(&header, m_data, sizeof(header));
+
+    if (!frameFileCheck(header))
+    {
+        close();
+        return false;
+    }
+
+    m_begin = sizeof(header);
+
+    // use the index written at the end of the file when there is one
+    FrameFileTrailer trailer;
+    bool indexed = false;
+
+    if (m_size >= m_begin + sizeof(trailer))
+    {
+        memcpy(&trailer, m_data + m_size - sizeof(trailer), sizeof(trailer));
+
+        indexed = trailer.magic == LEAP_INDEX_MAGIC &&
+            trailer.indexOffset >= m_begin &&
+            trailer.indexOffset + trailer.entries * sizeof(FrameIndexEntry) + sizeof(trailer) == m_size;
+    }
+
+    if (indexed)
+    {
+        m_end = trailer.indexOffset;
+        m_frames = trailer.frames;
+        m_index = m_data + trailer.indexOffset;
+        m_entries = trailer.entries;
+    }
+    else
+        buildIndex();
+
+    m_firstTimestamp = m_entries ? entry(0).timestamp : 0;
+    m_cursor = m_begin;
+    return true;
+}
+
+void FrameReplay::close()
+{
+    if (m_data)
+    {
+#ifdef WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap((void*)m_data, m_size);
+#endif
+    }
+
+#ifdef WIN32
+    if (m_mapping)
+        CloseHandle((HANDLE)m_mapping);
+
+    if (m_handle)
+        CloseHandle((HANDLE)m_handle);
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+    m_mapping = NULL;
+    m_handle = NULL;
+    m_begin = m_end = m_cursor = 0;
+    m_frames = 0;
+    m_firstTimestamp = 0;
+    m_index = NULL;
+    m_entries = 0;
+    m_builtIndex.clear();
+}
+
+void FrameReplay::buildIndex()
+{
+    FrameRecordHeader header;
+    uint64_t offset = m_begin;
+
+    m_frames = 0;
+
+    // walk the records headers, stopping at the first truncated one
+    while (m_size - offset >= sizeof(header))
+    {
+        memcpy(&header, m_data + offset, sizeof(header));
+
+        if (header.size < sizeof(header) || header.size > m_size - offset)
+            break;
+
+        if (m_frames % LEAP_INDEX_STRIDE == 0)
+        {
+            FrameIndexEntry entry = {header.id, header.timestamp, offset};
+            m_builtIndex.push_back(entry);
+        }
+
+        offset += header.size;
+        m_frames++;
+    }
+
+    m_end = offset;
+    m_index = m_builtIndex.empty() ? NULL : (const char*)&m_builtIndex[0];
+    m_entries = m_builtIndex.size();
+}
+
+bool FrameReplay::nextTimestamp(int64_t &timestamp) const
+{
+    FrameRecordHeader header;
+
+    if (m_cursor >= m_end || m_end - m_cursor < sizeof(header))
+        return false;
+
+    memcpy(&header, m_data + m_cursor, sizeof(header));
+    timestamp = header.timestamp;
+    return true;
+}
+
+bool FrameReplay::read(FrameSnapshot &snapshot)
+{
+    if (m_cursor >= m_end)
+        return false;
+
+    const uint32_t size = readFrameRecord(m_data + m_cursor, m_end - m_cursor, snapshot);
+
+    // a corrupted record ends the file
+    if (!size)
+    {
+        m_cursor = m_end;
+        return false;
+    }
+
+    m_cursor += size;
+    return true;
+}
+
+void FrameReplay::seekTime(int64_t timestamp)
+{
+    seek(timestamp, false);
+}
+
+void FrameReplay::seekFrame(int64_t id)
+{
+    seek(id, true);
+}
+
+FrameIndexEntry FrameReplay::entry(size_t i) const
+{
+    FrameIndexEntry e;
+    memcpy(&e, m_index + i * sizeof(FrameIndexEntry), sizeof(e));
+    return e;
+}
+
+size_t FrameReplay::findEntry(int64_t value, bool byId) const
+{
+    // entries are sorted by time and by id (within a recording both only grow)
+    size_t low = 0;
+    size_t high = m_entries;
+
+    while (high - low > 1)
+    {
+        const size_t middle = (low + high) / 2;
+        const FrameIndexEntry e = entry(middle);
+        const int64_t key = byId ? e.id : e.timestamp;
+
+        if (key <= value)
+            low = middle;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+void FrameReplay::seek(int64_t value, bool byId)
+{
+    if (!m_entries)
+    {
+        m_cursor = m_end;
+        return;
+    }
+
+    m_cursor = entry(findEntry(value, byId)).offset;
+
+    FrameRecordHeader header;
+
+    while (m_cursor < m_end && m_end - m_cursor >= sizeof(header))
+    {
+        memcpy(&header, m_data + m_cursor, sizeof(header));
+
+        if ((byId ? header.id : header.timestamp) >= value)
+            break;
+
+        if (header.size < sizeof(header) || header.size > m_end - m_cursor)
+        {
+            m_cursor = m_end;
+            break;
+        }
+
+        m_cursor += header.size;
+    }
+}
@@ -0,0 +1,90 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameReplay : read a FrameFile through a memory map
+ *
+ * @details The whole file is mapped once, records are decoded in place into a reused snapshot.
+ * Seeking by time or by frame id is a binary search in the sparse index followed by at most
+ * LEAP_INDEX_STRIDE records. Files without an index (e.g. a recording that was not closed)
+ * are indexed once when they are opened, and read up to their last complete record.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameReplay_h__
+#define __FrameReplay_h__
+
+#include "FrameFile.h"
+
+class FrameReplay
+{
+public:
+    FrameReplay();
+    ~FrameReplay();
+
+    /// map a file and go to its first frame, false if it can't be mapped or is not a FrameFile
+    bool open(const char *path);
+
+    void close();
+
+    bool isOpen() const { return m_data != NULL; }
+
+    /// number of frames of the file
+    uint64_t frames() const { return m_frames; }
+
+    /// timestamp of the first frame (in microseconds)
+    int64_t firstTimestamp() const { return m_firstTimestamp; }
+
+    /// true when all the frames have been read
+    bool atEnd() const { return m_cursor >= m_end; }
+
+    /// timestamp of the frame the next read returns, false at the end
+    bool nextTimestamp(int64_t &timestamp) const;
+
+    /// decode the next frame into a snapshot, false at the end
+    bool read(FrameSnapshot &snapshot);
+
+    /// go to the first frame
+    void rewind() { m_cursor = m_begin; }
+
+    /// go to the first frame whose timestamp is at least timestamp (the end if there is none)
+    void seekTime(int64_t timestamp);
+
+    /// go to the first frame whose id is at least id (the end if there is none)
+    void seekFrame(int64_t id);
+
+private:
+    /// index of the last entry whose key is not greater than value (0 if there is none)
+    size_t findEntry(int64_t value, bool byId) const;
+
+    /// entry i of the index, copied out : in the mapped file it is only as aligned as the last record
+    FrameIndexEntry entry(size_t i) const;
+
+    /// move forward from an index entry until the key reaches value
+    void seek(int64_t value, bool byId);
+
+    void buildIndex();
+
+    const char                      *m_data;    // the mapped file
+    uint64_t                        m_size;
+    void                            *m_mapping; // platform specific handles
+    void                            *m_handle;
+
+    uint64_t                        m_begin;    // first record
+    uint64_t                        m_end;      // end of the records
+    uint64_t                        m_cursor;   // next record
+    uint64_t                        m_frames;
+    int64_t                         m_firstTimestamp;
+
+    const char                      *m_index;   // in the mapped file or in m_builtIndex
+    size_t                          m_entries;
+    std::vector<FrameIndexEntry>    m_builtIndex;
+};
+
+#endif // __FrameReplay_h__
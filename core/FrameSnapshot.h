@@ -0,0 +1,296 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameSnapshot : all the data of a Leap frame pulled out once
+ *
+ * @details Hands, fingers, bones, tools and gestures are stored in structure-of-arrays tables :
+ * each channel (e.g. palm position x) is a contiguous run of floats, one per row.
+ * Once extracted, a snapshot is read by every output path without any further Leap SDK call.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameSnapshot_h__
+#define __FrameSnapshot_h__
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+/** Rows of kChannels float channels and kFields integer fields, stored channel by channel.
+    Memory only grows : a table reused frame after frame stops allocating once it has seen its largest count. */
+template<int kChannels, int kFields>
+class SnapshotTable
+{
+public:
+    enum { channels = kChannels, fields = kFields };
+
+    SnapshotTable() : m_count(0), m_capacity(0) {}
+
+    uint32_t count() const { return m_count; }
+
+    uint32_t capacity() const { return m_capacity; }
+
+    /// forget all rows but keep the memory
+    void clear() { m_count = 0; }
+
+    /// make room for at least count rows (existing rows are kept)
+    void reserve(uint32_t count)
+    {
+        if (count <= m_capacity)
+            return;
+
+        uint32_t capacity = m_capacity ? m_capacity * 2 : 4;
+        while (capacity < count)
+            capacity *= 2;
+
+        std::vector<float> channels(kChannels * capacity, 0.f);
+        std::vector<int32_t> fields(kFields * capacity, 0);
+
+        for (int c = 0; c < kChannels && m_count; c++)
+            memcpy(&channels[c * capacity], &m_channels[c * m_capacity], m_count * sizeof(float));
+
+        for (int f = 0; f < kFields && m_count; f++)
+            memcpy(&fields[f * capacity], &m_fields[f * m_capacity], m_count * sizeof(int32_t));
+
+        m_channels.swap(channels);
+        m_fields.swap(fields);
+        m_capacity = capacity;
+    }
+
+    /// set the number of rows (new rows are not initialized)
+    void resize(uint32_t count)
+    {
+        reserve(count);
+        m_count = count;
+    }
+
+    /// append a row and return its index
+    uint32_t addRow()
+    {
+        reserve(m_count + 1);
+        return m_count++;
+    }
+
+    float *channel(int c) { return m_capacity ? &m_channels[c * m_capacity] : NULL; }
+
+    const float *channel(int c) const { return m_capacity ? &m_channels[c * m_capacity] : NULL; }
+
+    int32_t *field(int f) { return m_capacity ? &m_fields[f * m_capacity] : NULL; }
+
+    const int32_t *field(int f) const { return m_capacity ? &m_fields[f * m_capacity] : NULL; }
+
+    float &value(int c, uint32_t row) { return m_channels[c * m_capacity + row]; }
+
+    float value(int c, uint32_t row) const { return m_channels[c * m_capacity + row]; }
+
+    int32_t &integer(int f, uint32_t row) { return m_fields[f * m_capacity + row]; }
+
+    int32_t integer(int f, uint32_t row) const { return m_fields[f * m_capacity + row]; }
+
+    /// write 3 consecutive channels (e.g. x, y, z) of a row
+    void setVector(int c, uint32_t row, float x, float y, float z)
+    {
+        float *v = &m_channels[c * m_capacity + row];
+        v[0] = x;
+        v[m_capacity] = y;
+        v[2 * m_capacity] = z;
+    }
+
+    /// copy all the rows of another table (reusing our memory when possible)
+    void copy(const SnapshotTable &other)
+    {
+        resize(other.m_count);
+
+        if (!m_count)
+            return;
+
+        for (int c = 0; c < kChannels; c++)
+            memcpy(channel(c), other.channel(c), m_count * sizeof(float));
+
+        for (int f = 0; f < kFields; f++)
+            memcpy(field(f), other.field(f), m_count * sizeof(int32_t));
+    }
+
+private:
+    uint32_t                m_count;
+    uint32_t                m_capacity;
+    std::vector<float>      m_channels;     // kChannels runs of m_capacity floats
+    std::vector<int32_t>    m_fields;       // kFields runs of m_capacity integers
+};
+
+/// hand channels
+enum eHandChannel
+{
+    kHandPalmX, kHandPalmY, kHandPalmZ,
+    kHandDirectionX, kHandDirectionY, kHandDirectionZ,
+    kHandVelocityX, kHandVelocityY, kHandVelocityZ,
+    kHandNormalX, kHandNormalY, kHandNormalZ,
+    kHandSphereX, kHandSphereY, kHandSphereZ,
+    kHandSphereRadius,
+    kHandPinch,
+    kHandGrab,
+    kHandChannels
+};
+
+enum eHandField
+{
+    kHandId,
+    kHandIsLeft,
+    kHandFirstFinger,       // row of the first finger of this hand in the finger table
+    kHandFingerCount,
+    kHandFields
+};
+
+/// finger channels
+enum eFingerChannel
+{
+    kFingerTipX, kFingerTipY, kFingerTipZ,
+    kFingerDirectionX, kFingerDirectionY, kFingerDirectionZ,
+    kFingerVelocityX, kFingerVelocityY, kFingerVelocityZ,
+    kFingerWidth,
+    kFingerLength,
+    kFingerChannels
+};
+
+enum eFingerField
+{
+    kFingerId,
+    kFingerHandId,
+    kFingerIsExtended,
+    kFingerType,
+    kFingerFields
+};
+
+/// tool channels
+enum eToolChannel
+{
+    kToolTipX, kToolTipY, kToolTipZ,
+    kToolDirectionX, kToolDirectionY, kToolDirectionZ,
+    kToolVelocityX, kToolVelocityY, kToolVelocityZ,
+    kToolWidth,
+    kToolLength,
+    kToolChannels
+};
+
+enum eToolField
+{
+    kToolId,
+    kToolIsExtended,
+    kToolFields
+};
+
+/// gesture channels (which ones are meaningful depends on the gesture type)
+enum eGestureChannel
+{
+    kGestureProgress,       // circle
+    kGestureRadius,         // circle
+    kGestureSweptAngle,     // circle
+    kGesturePositionX, kGesturePositionY, kGesturePositionZ,        // key tap, screen tap
+    kGestureDirectionX, kGestureDirectionY, kGestureDirectionZ,     // swipe, key tap, screen tap
+    kGestureSpeed,          // swipe
+    kGestureChannels
+};
+
+enum eGestureField
+{
+    kGestureId,
+    kGestureType,           // an eGestureType
+    kGestureState,          // 0 invalid, 1 start, 2 update, 3 end (as Leap::Gesture::State)
+    kGestureClockwise,      // circle
+    kGestureFields
+};
+
+/// bone channels (the arm is a bone from the elbow to the wrist)
+enum eBoneChannel
+{
+    kBonePrevX, kBonePrevY, kBonePrevZ,         // joint nearer to the elbow
+    kBoneNextX, kBoneNextY, kBoneNextZ,         // joint nearer to the tip
+    kBoneCenterX, kBoneCenterY, kBoneCenterZ,
+    kBoneDirectionX, kBoneDirectionY, kBoneDirectionZ,
+    kBoneBasisXX, kBoneBasisXY, kBoneBasisXZ,   // orthonormal basis : x axis, y axis then z axis
+    kBoneBasisYX, kBoneBasisYY, kBoneBasisYZ,
+    kBoneBasisZX, kBoneBasisZY, kBoneBasisZZ,
+    kBoneLength,
+    kBoneWidth,
+    kBoneChannels
+};
+
+enum eBoneField
+{
+    kBoneHandId,
+    kBoneFingerType,        // as Leap::Finger::Type, -1 for the arm
+    kBoneType,              // an eBoneType
+    kBoneFields
+};
+
+enum eBoneType
+{
+    kBoneMetacarpal,        // as Leap::Bone::Type
+    kBoneProximal,
+    kBoneIntermediate,
+    kBoneDistal,
+    kBoneArm,
+    kBoneTypes
+};
+
+enum eGestureType
+{
+    kGestureCircle,
+    kGestureSwipe,
+    kGestureKeyTap,
+    kGestureScreenTap,
+    kGestureTypes
+};
+
+typedef SnapshotTable<kHandChannels, kHandFields>           HandTable;
+typedef SnapshotTable<kFingerChannels, kFingerFields>       FingerTable;
+typedef SnapshotTable<kBoneChannels, kBoneFields>           BoneTable;
+typedef SnapshotTable<kToolChannels, kToolFields>           ToolTable;
+typedef SnapshotTable<kGestureChannels, kGestureFields>     GestureTable;
+
+/** Everything j.leapmotion outputs about one frame.
+    Fingers are grouped by hand, in hand order (see kHandFirstFinger and kHandFingerCount).
+    Bones are grouped by hand too, in hand order : the four bones of each finger in finger order then the arm.
+    They are only extracted when asked for, so a snapshot may have hands without bones. */
+struct FrameSnapshot
+{
+    FrameSnapshot() : id(-1), timestamp(0) {}
+
+    void clear()
+    {
+        hands.clear();
+        fingers.clear();
+        bones.clear();
+        tools.clear();
+        gestures.clear();
+    }
+
+    void copy(const FrameSnapshot &other)
+    {
+        id = other.id;
+        timestamp = other.timestamp;
+        hands.copy(other.hands);
+        fingers.copy(other.fingers);
+        bones.copy(other.bones);
+        tools.copy(other.tools);
+        gestures.copy(other.gestures);
+    }
+
+    int64_t         id;
+    int64_t         timestamp;  // in microseconds
+
+    HandTable       hands;
+    FingerTable     fingers;
+    BoneTable       bones;
+    ToolTable       tools;
+    GestureTable    gestures;
+};
+
+#endif // __FrameSnapshot_h__
@@ -0,0 +1,38 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief FrameSource : where snapshots come from (the Leap controller, a recorded file, a generator...)
+ *
+ * @details A source fills a caller provided snapshot frame after frame. Sources that are not live
+ * (replay, generators) also tell when their next frame is due so that it can be scheduled.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __FrameSource_h__
+#define __FrameSource_h__
+
+#include "FrameSnapshot.h"
+
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    /// fill the snapshot with the next frame, false when there is none (not yet for a live source, no more otherwise)
+    virtual bool read(FrameSnapshot &snapshot) = 0;
+
+    /// timestamp (in microseconds) of the frame the next read returns, false when unknown or when there is no more frame
+    virtual bool nextTimestamp(int64_t &timestamp) const { return false; }
+
+    /// go back to the first frame (does nothing for a live source)
+    virtual void rewind() {}
+};
+
+#endif // __FrameSource_h__
@@ -0,0 +1,162 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief GestureProgressCache : circle progress of the previous measured frame, by gesture id
+ *
+ * @details Two small open-addressed tables (linear probing) are swapped at each frame :
+ * one is read for the previous progress, the other is filled for the next frame.
+ * Nothing is allocated after construction.
+ * The frames measured are the ones a cache sees : an instance outputting every other frame
+ * gets the angle swept since the frame it output before.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __GestureProgressCache_h__
+#define __GestureProgressCache_h__
+
+#include <stdint.h>
+#include "FrameSnapshot.h"
+
+class GestureProgressCache
+{
+public:
+    GestureProgressCache() : m_previous(&m_tables[0]), m_current(&m_tables[1])
+    {
+        m_tables[0].clear();
+        m_tables[1].clear();
+    }
+
+    /// forget every progress (e.g. when the frames start coming from another source)
+    void reset()
+    {
+        m_previous->clear();
+        m_current->clear();
+    }
+
+    /// forget the previous frame, what has been stored since becomes the previous frame
+    void nextFrame()
+    {
+        Table *previous = m_previous;
+        m_previous = m_current;
+        m_current = previous;
+        m_current->clear();
+    }
+
+    /// the progress of a gesture in the previous frame, false if it was not there
+    bool previous(int32_t id, float &progress) const
+    {
+        const int32_t slot = m_previous->find(id);
+
+        if (slot < 0)
+            return false;
+
+        progress = m_previous->progress[slot];
+        return true;
+    }
+
+    /// store the progress of a gesture for the next frame (ignored when more than kCapacity / 2 circles are tracked)
+    void store(int32_t id, float progress)
+    {
+        m_current->insert(id, progress);
+    }
+
+    /// write the angle swept by each circle since the previous measured frame (kGestureSweptAngle)
+    /// and keep their progress for the next one
+    void measure(GestureTable &gestures)
+    {
+        nextFrame();
+
+        for (uint32_t g = 0; g < gestures.count(); g++)
+        {
+            if (gestures.integer(kGestureType, g) != kGestureCircle)
+                continue;
+
+            const int32_t id = gestures.integer(kGestureId, g);
+            const float progress = gestures.value(kGestureProgress, g);
+            float previousProgress;
+            float sweptAngle = 0;
+
+            // a circle that starts sweeps from where it is (state 1 is start)
+            if (gestures.integer(kGestureState, g) != 1 && previous(id, previousProgress))
+                sweptAngle = (progress - previousProgress) * 6.28318530717958647692f;
+
+            store(id, progress);
+            gestures.value(kGestureSweptAngle, g) = sweptAngle;
+        }
+    }
+
+    /// true if a gesture table has a circle to measure
+    static bool hasCircles(const GestureTable &gestures)
+    {
+        for (uint32_t g = 0; g < gestures.count(); g++)
+            if (gestures.integer(kGestureType, g) == kGestureCircle)
+                return true;
+
+        return false;
+    }
+
+private:
+    enum { kCapacity = 64 };        // a power of two, at most half full
+
+    struct Table
+    {
+        int32_t     ids[kCapacity];
+        float       progress[kCapacity];
+        bool        used[kCapacity];
+        uint32_t    count;
+
+        void clear()
+        {
+            for (uint32_t i = 0; i < kCapacity; i++)
+                used[i] = false;
+
+            count = 0;
+        }
+
+        static uint32_t hash(int32_t id)
+        {
+            return ((uint32_t)id * 2654435761u) >> 26;     // 6 bits for 64 slots
+        }
+
+        int32_t find(int32_t id) const
+        {
+            for (uint32_t i = hash(id), n = 0; n < kCapacity && used[i]; i = (i + 1) & (kCapacity - 1), n++)
+                if (ids[i] == id)
+                    return i;
+
+            return -1;
+        }
+
+        void insert(int32_t id, float value)
+        {
+            if (count >= kCapacity / 2)
+                return;
+
+            uint32_t i = hash(id);
+
+            while (used[i] && ids[i] != id)
+                i = (i + 1) & (kCapacity - 1);
+
+            if (!used[i])
+            {
+                used[i] = true;
+                ids[i] = id;
+                count++;
+            }
+
+            progress[i] = value;
+        }
+    };
+
+    Table       m_tables[2];
+    Table       *m_previous;
+    Table       *m_current;
+};
+
+#endif // __GestureProgressCache_h__
@@ -0,0 +1,249 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief JointSolver : local joint rotations of the hand skeletons as quaternions
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "JointSolver.h"
+#include "LeapSimd.h"
+
+#include <math.h>
+
+/// max(v, 0) as a plain comparison (fmaxf handles NaN and is a library call on some compilers)
+static inline float positive(float v)
+{
+    return v > 0.f ? v : 0.f;
+}
+
+/// quaternion of the rotation whose columns are the x, y and z axes (without branches, see copysignf)
+static inline void basisToQuaternion(float xx, float xy, float xz, float yx, float yy, float yz, float zx, float zy, float zz,
+                                     float &w, float &x, float &y, float &z)
+{
+    w = 0.5f * sqrtf(positive(1.f + xx + yy + zz));
+    x = copysignf(0.5f * sqrtf(positive(1.f + xx - yy - zz)), yz - zy);
+    y = copysignf(0.5f * sqrtf(positive(1.f - xx + yy - zz)), zx - xz);
+    z = copysignf(0.5f * sqrtf(positive(1.f - xx - yy + zz)), xy - yx);
+}
+
+void JointSolver::solve(const FrameSnapshot &snapshot)
+{
+    const HandTable &hands = snapshot.hands;
+    const BoneTable &bones = snapshot.bones;
+    const uint32_t numBones = bones.count();
+
+    m_joints.clear();
+
+    if (!numBones)
+        return;
+
+    /// rotation of every bone //////////////////////////////////////////////
+    m_global.resize(numBones);
+
+    const float *bxx = bones.channel(kBoneBasisXX), *bxy = bones.channel(kBoneBasisXY), *bxz = bones.channel(kBoneBasisXZ);
+    const float *byx = bones.channel(kBoneBasisYX), *byy = bones.channel(kBoneBasisYY), *byz = bones.channel(kBoneBasisYZ);
+    const float *bzx = bones.channel(kBoneBasisZX), *bzy = bones.channel(kBoneBasisZY), *bzz = bones.channel(kBoneBasisZZ);
+
+    float *gw = m_global.channel(kJointW), *gx = m_global.channel(kJointX);
+    float *gy = m_global.channel(kJointY), *gz = m_global.channel(kJointZ);
+
+    uint32_t first = 0;
+
+#ifdef LEAP_SSE
+    {
+        const __m128 sign = _mm_set1_ps(-0.f);
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; first + 4 <= numBones; first += 4)
+        {
+            const uint32_t i = first;
+            const __m128 yx = _mm_loadu_ps(byx + i), yy = _mm_loadu_ps(byy + i), yz = _mm_loadu_ps(byz + i);
+            const __m128 zx = _mm_loadu_ps(bzx + i), zy = _mm_loadu_ps(bzy + i), zz = _mm_loadu_ps(bzz + i);
+            __m128 xx = _mm_loadu_ps(bxx + i), xy = _mm_loadu_ps(bxy + i), xz = _mm_loadu_ps(bxz + i);
+
+            // mirror the left-handed bases : flip the x axis by the sign of the determinant
+            const __m128 det = _mm_add_ps(_mm_sub_ps(
+                _mm_mul_ps(xx, _mm_sub_ps(_mm_mul_ps(yy, zz), _mm_mul_ps(yz, zy))),
+                _mm_mul_ps(xy, _mm_sub_ps(_mm_mul_ps(yx, zz), _mm_mul_ps(yz, zx)))),
+                _mm_mul_ps(xz, _mm_sub_ps(_mm_mul_ps(yx, zy), _mm_mul_ps(yy, zx))));
+            const __m128 flip = _mm_and_ps(det, sign);
+
+            xx = _mm_xor_ps(xx, flip);
+            xy = _mm_xor_ps(xy, flip);
+            xz = _mm_xor_ps(xz, flip);
+
+            // as basisToQuaternion
+            const __m128 w = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_add_ps(one, _mm_add_ps(xx, _mm_add_ps(yy, zz))))));
+            const __m128 x = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_add_ps(one, _mm_sub_ps(_mm_sub_ps(xx, yy), zz)))));
+            const __m128 y = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_add_ps(one, _mm_sub_ps(_mm_sub_ps(yy, xx), zz)))));
+            const __m128 z = _mm_mul_ps(half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_add_ps(one, _mm_sub_ps(_mm_sub_ps(zz, xx), yy)))));
+
+            _mm_storeu_ps(gw + i, w);
+            _mm_storeu_ps(gx + i, _mm_or_ps(x, _mm_and_ps(sign, _mm_sub_ps(yz, zy))));
+            _mm_storeu_ps(gy + i, _mm_or_ps(y, _mm_and_ps(sign, _mm_sub_ps(zx, xz))));
+            _mm_storeu_ps(gz + i, _mm_or_ps(z, _mm_and_ps(sign, _mm_sub_ps(xy, yx))));
+        }
+    }
+#endif
+
+    for (uint32_t i = first; i < numBones; i++)
+    {
+        // a left-handed basis (negative determinant) is mirrored by flipping its x axis
+        const float det = bxx[i] * (byy[i] * bzz[i] - byz[i] * bzy[i]) -
+                          bxy[i] * (byx[i] * bzz[i] - byz[i] * bzx[i]) +
+                          bxz[i] * (byx[i] * bzy[i] - byy[i] * bzx[i]);
+        const float mirror = copysignf(1.f, det);
+
+        basisToQuaternion(mirror * bxx[i], mirror * bxy[i], mirror * bxz[i],
+                          byx[i], byy[i], byz[i],
+                          bzx[i], bzy[i], bzz[i],
+                          gw[i], gx[i], gy[i], gz[i]);
+    }
+
+    /// each joint with its parent //////////////////////////////////////////
+    // at most the arm and the palm of each hand more than the bones : sized once, trimmed at the end
+    m_joints.resize(numBones + 2 * hands.count());
+    m_parent.resize(numBones + 2 * hands.count());
+
+    float *jw = m_joints.channel(kJointW), *jx = m_joints.channel(kJointX);
+    float *jy = m_joints.channel(kJointY), *jz = m_joints.channel(kJointZ);
+    float *pw = m_parent.channel(kJointW), *px = m_parent.channel(kJointX);
+    float *py = m_parent.channel(kJointY), *pz = m_parent.channel(kJointZ);
+    int32_t *jHand = m_joints.field(kJointHandId), *jFinger = m_joints.field(kJointFingerType), *jType = m_joints.field(kJointType);
+
+    const int32_t *boneHand = bones.field(kBoneHandId);
+    const int32_t *boneFinger = bones.field(kBoneFingerType);
+    const int32_t *boneType = bones.field(kBoneType);
+
+    uint32_t bone = 0;
+    uint32_t row = 0;
+
+    for (uint32_t h = 0; h < hands.count() && bone < numBones; h++)
+    {
+        const int32_t handId = hands.integer(kHandId, h);
+
+        if (boneHand[bone] != handId)
+            continue;
+
+        uint32_t last = bone;
+        while (last < numBones && boneHand[last] == handId)
+            last++;
+
+        // the palm basis : z axis opposite to the hand direction, y axis opposite to the palm normal, x axis = y x z
+        const float dx = hands.value(kHandDirectionX, h), dy = hands.value(kHandDirectionY, h), dz = hands.value(kHandDirectionZ, h);
+        const float nx = hands.value(kHandNormalX, h), ny = hands.value(kHandNormalY, h), nz = hands.value(kHandNormalZ, h);
+        float palmW, palmX, palmY, palmZ;
+
+        basisToQuaternion(ny * dz - nz * dy, nz * dx - nx * dz, nx * dy - ny * dx,
+                          -nx, -ny, -nz,
+                          -dx, -dy, -dz,
+                          palmW, palmX, palmY, palmZ);
+
+        // the arm is the last bone of the hand, without one the palm is relative to the device
+        const bool hasArm = boneType[last - 1] == kBoneArm;
+        const uint32_t a = last - 1;
+
+        // arm, relative to the device
+        jw[row] = hasArm ? gw[a] : 1.f;
+        jx[row] = hasArm ? gx[a] : 0.f;
+        jy[row] = hasArm ? gy[a] : 0.f;
+        jz[row] = hasArm ? gz[a] : 0.f;
+        pw[row] = 1.f;
+        px[row] = py[row] = pz[row] = 0.f;
+        jHand[row] = handId;
+        jFinger[row] = -1;
+        jType[row] = kBoneArm;
+        row++;
+
+        // palm, relative to the arm
+        jw[row] = palmW;
+        jx[row] = palmX;
+        jy[row] = palmY;
+        jz[row] = palmZ;
+        pw[row] = jw[row - 1];
+        px[row] = jx[row - 1];
+        py[row] = jy[row - 1];
+        pz[row] = jz[row - 1];
+        jHand[row] = handId;
+        jFinger[row] = -1;
+        jType[row] = kJointPalm;
+        row++;
+
+        // finger bones : a metacarpal hangs from the palm, the others from the previous bone
+        for (uint32_t b = bone; b < last - (hasArm ? 1 : 0); b++, row++)
+        {
+            const bool metacarpal = boneType[b] == kBoneMetacarpal || b == bone;
+
+            jw[row] = gw[b];
+            jx[row] = gx[b];
+            jy[row] = gy[b];
+            jz[row] = gz[b];
+            pw[row] = metacarpal ? palmW : gw[b - 1];
+            px[row] = metacarpal ? palmX : gx[b - 1];
+            py[row] = metacarpal ? palmY : gy[b - 1];
+            pz[row] = metacarpal ? palmZ : gz[b - 1];
+            jHand[row] = handId;
+            jFinger[row] = boneFinger[b];
+            jType[row] = boneType[b];
+        }
+
+        bone = last;
+    }
+
+    m_joints.resize(row);
+
+    /// local rotations : conjugate of the parent times the joint ///////////
+    first = 0;
+
+#ifdef LEAP_SSE
+    {
+        const __m128 sign = _mm_set1_ps(-0.f);
+
+        for (; first + 4 <= row; first += 4)
+        {
+            const uint32_t i = first;
+            const __m128 qw = _mm_loadu_ps(jw + i), qx = _mm_loadu_ps(jx + i), qy = _mm_loadu_ps(jy + i), qz = _mm_loadu_ps(jz + i);
+            const __m128 rw = _mm_loadu_ps(pw + i), rx = _mm_loadu_ps(px + i), ry = _mm_loadu_ps(py + i), rz = _mm_loadu_ps(pz + i);
+
+            const __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rw, qw), _mm_mul_ps(rx, qx)), _mm_add_ps(_mm_mul_ps(ry, qy), _mm_mul_ps(rz, qz)));
+            const __m128 x = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, qx), _mm_mul_ps(rx, qw)), _mm_sub_ps(_mm_mul_ps(rz, qy), _mm_mul_ps(ry, qz)));
+            const __m128 y = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, qy), _mm_mul_ps(ry, qw)), _mm_sub_ps(_mm_mul_ps(rx, qz), _mm_mul_ps(rz, qx)));
+            const __m128 z = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, qz), _mm_mul_ps(rz, qw)), _mm_sub_ps(_mm_mul_ps(ry, qx), _mm_mul_ps(rx, qy)));
+
+            // keep w positive : flip every component by the sign of w
+            const __m128 flip = _mm_and_ps(w, sign);
+
+            _mm_storeu_ps(jw + i, _mm_xor_ps(w, flip));
+            _mm_storeu_ps(jx + i, _mm_xor_ps(x, flip));
+            _mm_storeu_ps(jy + i, _mm_xor_ps(y, flip));
+            _mm_storeu_ps(jz + i, _mm_xor_ps(z, flip));
+        }
+    }
+#endif
+
+    for (uint32_t i = first; i < row; i++)
+    {
+        const float w = pw[i] * jw[i] + px[i] * jx[i] + py[i] * jy[i] + pz[i] * jz[i];
+        const float x = pw[i] * jx[i] - px[i] * jw[i] - py[i] * jz[i] + pz[i] * jy[i];
+        const float y = pw[i] * jy[i] + px[i] * jz[i] - py[i] * jw[i] - pz[i] * jx[i];
+        const float z = pw[i] * jz[i] - px[i] * jy[i] + py[i] * jx[i] - pz[i] * jw[i];
+
+        // q and -q are the same rotation : keep w positive
+        const float sign = copysignf(1.f, w);
+
+        jw[i] = sign * w;
+        jx[i] = sign * x;
+        jy[i] = sign * y;
+        jz[i] = sign * z;
+    }
+}
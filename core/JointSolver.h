@@ -0,0 +1,62 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief JointSolver : local joint rotations of the hand skeletons as quaternions
+ *
+ * @details The rotation of every bone is taken relative to its parent along the chain
+ * arm → palm → metacarpal → proximal → intermediate → distal, the arm being relative to the Leap device.
+ * Bases are first turned into quaternions for all the bones of the frame at once, then every joint
+ * is divided by its parent : both passes run over contiguous channels without branches, 4 joints at a time
+ * with SSE when it is available. Left hand bases (left-handed in the Leap SDK) are mirrored into right-handed ones.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __JointSolver_h__
+#define __JointSolver_h__
+
+#include "FrameSnapshot.h"
+
+/// joint channels : a unit quaternion with w >= 0
+enum eJointChannel
+{
+    kJointW, kJointX, kJointY, kJointZ,
+    kJointChannels
+};
+
+enum eJointField
+{
+    kJointHandId,
+    kJointFingerType,       // as Leap::Finger::Type, -1 for the arm and the palm
+    kJointType,             // an eBoneType or kJointPalm
+    kJointFields
+};
+
+/// the palm joint type, after the eBoneType ones
+enum { kJointPalm = kBoneTypes };
+
+typedef SnapshotTable<kJointChannels, kJointFields>     JointTable;
+
+/** Joints are grouped by hand, in hand order : the arm, the palm, then the four bones of each finger in finger order.
+    Only hands with bones get joints. */
+class JointSolver
+{
+public:
+    /// compute the joints of every hand of a snapshot
+    void solve(const FrameSnapshot &snapshot);
+
+    const JointTable &joints() const { return m_joints; }
+
+private:
+    SnapshotTable<kJointChannels, 0>    m_global;   // rotation of each bone row of the snapshot
+    SnapshotTable<kJointChannels, 0>    m_parent;   // rotation of the parent of each joint
+    JointTable                          m_joints;   // rotation of each joint, then relative to its parent
+};
+
+#endif // __JointSolver_h__
@@ -0,0 +1,25 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief LeapSimd : which SIMD instructions the core can use
+ *
+ * @details LEAP_SSE is defined where SSE2 is available (every Mac and Windows x86 target).
+ * Code using it keeps a scalar version for the other targets and for the tail of its loops.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __LeapSimd_h__
+#define __LeapSimd_h__
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LEAP_SSE
+#endif
+
+#endif // __LeapSimd_h__
@@ -0,0 +1,51 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief LiveSource : the frames of a Leap::Controller
+ *
+ * @details Each read extracts the latest frame of the controller if it has not been read yet.
+ * This is the only source depending on the Leap SDK.
+ * It serves the drivers that only want snapshots (leapbench --live). j.leapmotion does not read
+ * the controller through it : its live path works on Leap::Frame handles before extracting them
+ * (push mode queues handles from the listener thread, catch-up walks the controller history back
+ * by frame id) and extracts each frame once into a cache shared by every instance, where a
+ * FrameSource would extract, and copy, it once per instance.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __LiveSource_h__
+#define __LiveSource_h__
+
+#include "FrameSource.h"
+#include "FrameExtract.h"
+
+class LiveSource : public FrameSource
+{
+public:
+    LiveSource(const Leap::Controller &controller) : m_controller(controller), m_lastId(-1) {}
+
+    virtual bool read(FrameSnapshot &snapshot)
+    {
+        const Leap::Frame frame = m_controller.frame();
+
+        if (!frame.isValid() || frame.id() == m_lastId)
+            return false;
+
+        m_lastId = frame.id();
+        extractFrame(snapshot, frame, &m_circles);
+        return true;
+    }
+
+private:
+    const Leap::Controller  &m_controller;
+    int64_t                 m_lastId;
+    GestureProgressCache    m_circles;
+};
+
+#endif // __LiveSource_h__
@@ -0,0 +1,40 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief ReplaySource : the frames of a recorded file
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __ReplaySource_h__
+#define __ReplaySource_h__
+
+#include "FrameSource.h"
+#include "FrameReplay.h"
+
+class ReplaySource : public FrameSource
+{
+public:
+    virtual bool read(FrameSnapshot &snapshot) { return m_replay.read(snapshot); }
+
+    virtual bool nextTimestamp(int64_t &timestamp) const { return m_replay.nextTimestamp(timestamp); }
+
+    virtual void rewind() { m_replay.rewind(); }
+
+    /// to open the file and to seek
+    FrameReplay &replay() { return m_replay; }
+
+    const FrameReplay &replay() const { return m_replay; }
+
+private:
+    FrameReplay     m_replay;
+};
+
+#endif // __ReplaySource_h__
@@ -0,0 +1,186 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief SignalRamp : audio rate output of tracked values
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "SignalRamp.h"
+
+static const char *s_signalChannelNames[kSignalChannels] =
+{
+    "palm_x", "palm_y", "palm_z",
+    "pinch",
+    "grab",
+    "thumb_x", "thumb_y", "thumb_z",
+    "index_x", "index_y", "index_z",
+    "middle_x", "middle_y", "middle_z",
+    "ring_x", "ring_y", "ring_z",
+    "pinky_x", "pinky_y", "pinky_z"
+};
+
+long signalChannelFromName(const char *name)
+{
+    for (long c = 0; c < kSignalChannels; c++)
+        if (!strcmp(name, s_signalChannelNames[c]))
+            return c;
+    
+    return -1;
+}
+
+const char *signalChannelName(long channel)
+{
+    return (channel >= 0 && channel < kSignalChannels) ? s_signalChannelNames[channel] : "";
+}
+
+bool sampleSignals(const FrameSnapshot &snapshot, long hand, const long *channels, long count, double *values)
+{
+    const HandTable &hands = snapshot.hands;
+    const FingerTable &fingers = snapshot.fingers;
+    uint32_t row = hands.count();
+    
+    // find the selected hand
+    for (uint32_t i = 0; i < hands.count(); i++)
+    {
+        if (hand == kSignalHandFirst ||
+            (hand == kSignalHandLeft && hands.integer(kHandIsLeft, i)) ||
+            (hand == kSignalHandRight && !hands.integer(kHandIsLeft, i)))
+        {
+            row = i;
+            break;
+        }
+    }
+    
+    if (row == hands.count())
+        return false;
+    
+    const uint32_t first = hands.integer(kHandFirstFinger, row);
+    const uint32_t last = first + hands.integer(kHandFingerCount, row);
+    
+    for (long i = 0; i < count; i++)
+    {
+        const long channel = channels[i];
+        
+        if (channel <= kSignalPalmZ)
+            values[i] = hands.value(kHandPalmX + channel, row);
+        else if (channel == kSignalPinch)
+            values[i] = hands.value(kHandPinch, row);
+        else if (channel == kSignalGrab)
+            values[i] = hands.value(kHandGrab, row);
+        else
+        {
+            // finger tips : the finger type is the Leap::Finger::Type (thumb = 0 ... pinky = 4)
+            const int32_t type = (channel - kSignalThumbX) / 3;
+            const long axis = (channel - kSignalThumbX) % 3;
+            
+            for (uint32_t j = first; j < last; j++)
+            {
+                if (fingers.integer(kFingerType, j) == type)
+                {
+                    values[i] = fingers.value(kFingerTipX + axis, j);
+                    break;
+                }
+            }
+        }
+    }
+    
+    return true;
+}
+
+SignalRamp::SignalRamp() :
+m_flush(false),
+m_elapsed(0),
+m_length(1)
+{
+    for (long c = 0; c < LEAP_SIGNAL_MAX; c++)
+        m_from[c] = m_to[c] = 0;
+}
+
+void SignalRamp::pushTarget(const double *values, long count, double duration)
+{
+    Target target;
+    
+    memcpy(target.values, values, count * sizeof(double));
+    target.duration = duration;
+    
+    // when the audio is off the ring fills up and the latest targets are simply lost (flush drops the others)
+    m_targets.push(target);
+}
+
+void SignalRamp::flush()
+{
+    m_flush.store(true, std::memory_order_release);
+}
+
+void SignalRamp::process(double **outs, long count, long sampleframes, double samplerate)
+{
+    Target target;
+    bool arrived = false;
+    
+    // stop where the ramp is now, the next frame ramps from there
+    if (m_flush.exchange(false, std::memory_order_acquire))
+    {
+        m_targets.clear();
+        
+        const double t = m_elapsed < m_length ? m_elapsed / m_length : 1.;
+        
+        for (long c = 0; c < count; c++)
+            m_to[c] = m_from[c] += (m_to[c] - m_from[c]) * t;
+        
+        m_elapsed = 0;
+        m_length = 1;
+    }
+    
+    // only the latest target matters : ramp to it from where we are now
+    while (m_targets.pop(target))
+        arrived = true;
+    
+    if (arrived)
+    {
+        const double t = m_elapsed < m_length ? m_elapsed / m_length : 1.;
+        
+        for (long c = 0; c < count; c++)
+        {
+            m_from[c] += (m_to[c] - m_from[c]) * t;
+            m_to[c] = target.values[c];
+        }
+        
+        m_elapsed = 0;
+        m_length = target.duration * samplerate;
+        if (m_length < 1)
+            m_length = 1;
+    }
+    
+    // number of samples of this vector still inside the ramp
+    long ramping = 0;
+    if (m_elapsed < m_length)
+    {
+        const double remaining = m_length - m_elapsed;
+        ramping = remaining < sampleframes ? (long)remaining : sampleframes;
+    }
+    
+    for (long c = 0; c < count; c++)
+    {
+        double *out = outs[c];
+        const double from = m_from[c];
+        const double step = (m_to[c] - from) / m_length;
+        double value = from + step * m_elapsed;
+        long n = 0;
+        
+        for (; n < ramping; n++, value += step)
+            out[n] = value;
+        
+        for (; n < sampleframes; n++)
+            out[n] = m_to[c];
+    }
+    
+    m_elapsed += sampleframes;
+}
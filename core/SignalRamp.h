@@ -0,0 +1,93 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief SignalRamp : audio rate output of tracked values
+ *
+ * @details Selected snapshot values are sampled once per frame on the Max side,
+ * handed to the audio thread through a lock-free ring and linearly interpolated
+ * over the duration between the two most recent frames (taken from their timestamps).
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __SignalRamp_h__
+#define __SignalRamp_h__
+
+#include "FrameSnapshot.h"
+#include "SpscRing.h"
+
+#include <atomic>
+
+// maximum number of signal outlets
+#define LEAP_SIGNAL_MAX 32
+
+/// values that can be output as signals (they all belong to the selected hand)
+enum eSignalChannel
+{
+    kSignalPalmX, kSignalPalmY, kSignalPalmZ,
+    kSignalPinch,
+    kSignalGrab,
+    kSignalThumbX, kSignalThumbY, kSignalThumbZ,
+    kSignalIndexX, kSignalIndexY, kSignalIndexZ,
+    kSignalMiddleX, kSignalMiddleY, kSignalMiddleZ,
+    kSignalRingX, kSignalRingY, kSignalRingZ,
+    kSignalPinkyX, kSignalPinkyY, kSignalPinkyZ,
+    kSignalChannels
+};
+
+/// which hand the signals follow
+enum eSignalHand
+{
+    kSignalHandFirst,
+    kSignalHandLeft,
+    kSignalHandRight
+};
+
+/// the eSignalChannel named e.g. "palm_x", "pinch" or "index_z", -1 if there is none
+long signalChannelFromName(const char *name);
+
+/// the name of an eSignalChannel
+const char *signalChannelName(long channel);
+
+/** Read the selected channels of the selected hand.
+    Returns false (and leaves values untouched) when that hand is not tracked in this frame. */
+bool sampleSignals(const FrameSnapshot &snapshot, long hand, const long *channels, long count, double *values);
+
+/** Interpolates the values sampled at each frame at audio rate.
+    pushTarget is called on the Max side, process on the audio thread. */
+class SignalRamp
+{
+public:
+    SignalRamp();
+
+    /// Max side : ramp to these values over duration seconds (the time between the two latest frames)
+    void pushTarget(const double *values, long count, double duration);
+
+    /// Max side, when the dsp chain is built : the next process drops the queued targets and holds its values
+    void flush();
+
+    /// audio side : write sampleframes interpolated samples to each of the count outputs
+    void process(double **outs, long count, long sampleframes, double samplerate);
+
+private:
+    struct Target
+    {
+        double  values[LEAP_SIGNAL_MAX];
+        double  duration;
+    };
+
+    SpscRing<Target, 8> m_targets;
+    std::atomic<bool>   m_flush;    // only the audio side pops the ring, so it clears it too
+
+    double  m_from[LEAP_SIGNAL_MAX];
+    double  m_to[LEAP_SIGNAL_MAX];
+    double  m_elapsed;      // in samples since the latest target arrived
+    double  m_length;       // in samples
+};
+
+#endif // __SignalRamp_h__
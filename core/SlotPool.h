@@ -0,0 +1,109 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief SlotPool : slots of per object state found again by id from frame to frame
+ *
+ * @details The owner keeps its state in arrays of capacity() slots and asks the pool which slot holds
+ * the state of an id. An id that disappears from a frame gives its slot back, so that an id that appears
+ * (or comes back after tracking dropped it) never starts from the state of another object.
+ * The capacity doubles when every slot is taken : the owner grows its arrays to capacity() after acquire.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __SlotPool_h__
+#define __SlotPool_h__
+
+#include <stdint.h>
+#include <vector>
+
+class SlotPool
+{
+public:
+    enum { kFreeSlot = INT32_MIN };
+
+    uint32_t capacity() const { return m_ids.size(); }
+
+    /// number of slots taken
+    uint32_t active() const { return m_ids.size() - m_free.size(); }
+
+    /// id of a slot, kFreeSlot when it is free
+    int32_t id(uint32_t slot) const { return m_ids[slot]; }
+
+    /// slot of an id, capacity() when it has none : hint (e.g. the slot of the same row in the previous frame) is tried first
+    uint32_t find(int32_t id, uint32_t hint) const
+    {
+        if (hint < m_ids.size() && m_ids[hint] == id)
+            return hint;
+
+        uint32_t slot = 0;
+        while (slot < m_ids.size() && m_ids[slot] != id)
+            slot++;
+
+        return slot;
+    }
+
+    /// take a free slot for an id, doubling the capacity when there is none
+    uint32_t acquire(int32_t id)
+    {
+        if (m_free.empty())
+        {
+            const uint32_t size = m_ids.size();
+            const uint32_t capacity = size ? size * 2 : 8;
+
+            m_ids.resize(capacity, kFreeSlot);
+            m_seen.resize(capacity, 0);
+            m_free.reserve(capacity);
+
+            for (uint32_t slot = capacity; slot-- > size; )
+                m_free.push_back(slot);
+        }
+
+        const uint32_t slot = m_free.back();
+        m_free.pop_back();
+        m_ids[slot] = id;
+        return slot;
+    }
+
+    /// start a frame : the slots not marked until end are given back
+    void begin() { m_seen.assign(m_ids.size(), 0); }
+
+    void mark(uint32_t slot) { m_seen[slot] = 1; }
+
+    void end()
+    {
+        for (uint32_t slot = 0; slot < m_ids.size(); slot++)
+        {
+            if (!m_seen[slot] && m_ids[slot] != kFreeSlot)
+            {
+                m_ids[slot] = kFreeSlot;
+                m_free.push_back(slot);
+            }
+        }
+    }
+
+    /// give every slot back
+    void reset()
+    {
+        m_free.clear();
+
+        for (uint32_t slot = m_ids.size(); slot-- > 0; )
+        {
+            m_ids[slot] = kFreeSlot;
+            m_free.push_back(slot);
+        }
+    }
+
+private:
+    std::vector<int32_t>    m_ids;      // of each slot, kFreeSlot when it is free
+    std::vector<uint32_t>   m_free;
+    std::vector<uint8_t>    m_seen;     // slots marked since begin
+};
+
+#endif // __SlotPool_h__
@@ -0,0 +1,83 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief SpscRing : a preallocated single-producer / single-consumer ring
+ *
+ * @details The producer (e.g. the Leap service thread calling Listener::onFrame)
+ * and the consumer (e.g. a Max qelem) never take a lock and never allocate :
+ * all slots are constructed once with the ring.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __SpscRing_h__
+#define __SpscRing_h__
+
+#include <stdint.h>
+#include <atomic>
+
+template<class T, uint32_t kCapacity>
+class SpscRing
+{
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : m_head(0), m_tail(0) {}
+
+    /// producer side : copy a value into the ring, return false if it is full
+    bool push(const T& value)
+    {
+        const uint32_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head - m_tail.load(std::memory_order_acquire) == kCapacity)
+            return false;
+
+        m_items[head & (kCapacity - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// consumer side : copy the oldest value out of the ring, return false if it is empty
+    bool pop(T& value)
+    {
+        const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+
+        value = m_items[tail & (kCapacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// consumer side : drop everything currently queued
+    void clear()
+    {
+        m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    /// number of queued values (approximate when called from the producer side)
+    uint32_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    static uint32_t capacity() { return kCapacity; }
+
+private:
+    T                       m_items[kCapacity];
+
+    // keep producer and consumer indices on separate cache lines
+    // (padding rather than alignas so the ring can live in a plain new'ed object)
+    char                    m_padHead[64];
+    std::atomic<uint32_t>   m_head;
+    char                    m_padTail[64 - sizeof(std::atomic<uint32_t>)];
+    std::atomic<uint32_t>   m_tail;
+};
+
+#endif // __SpscRing_h__
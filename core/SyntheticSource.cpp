@@ -0,0 +1,317 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief SyntheticSource : generated frames for load and scaling tests
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "SyntheticSource.h"
+
+#define _USE_MATH_DEFINES // To get definition of M_PI
+#include <math.h>
+
+// a gesture lasts this number of frames (start, updates then end)
+#define SYNTHETIC_GESTURE_FRAMES 30
+
+// the first frame id and timestamp, as a service started a while ago would give
+#define SYNTHETIC_FIRST_ID 1000
+#define SYNTHETIC_FIRST_TIMESTAMP 1000000
+
+/// a bone from prev to next, its basis built around its direction
+static void setBone(BoneTable &bones, uint32_t row, const double *prev, const double *next, float width)
+{
+    double d[3] = {next[0] - prev[0], next[1] - prev[1], next[2] - prev[2]};
+    const double length = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+    for (int k = 0; k < 3; k++)
+        d[k] = length > 0. ? d[k] / length : k == 2 ? -1. : 0.;
+
+    // z axis opposite to the direction (as Leap bases), x axis horizontal, y axis completing them
+    const double z[3] = {-d[0], -d[1], -d[2]};
+    double x[3] = {z[2], 0., -z[0]};
+    const double norm = sqrt(x[0] * x[0] + x[2] * x[2]);
+
+    if (norm > 0.)
+    {
+        x[0] /= norm;
+        x[2] /= norm;
+    }
+    else
+        x[0] = 1.;
+
+    const double y[3] = {z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0]};
+
+    bones.setVector(kBonePrevX, row, prev[0], prev[1], prev[2]);
+    bones.setVector(kBoneNextX, row, next[0], next[1], next[2]);
+    bones.setVector(kBoneCenterX, row, (prev[0] + next[0]) * 0.5, (prev[1] + next[1]) * 0.5, (prev[2] + next[2]) * 0.5);
+    bones.setVector(kBoneDirectionX, row, d[0], d[1], d[2]);
+    bones.setVector(kBoneBasisXX, row, x[0], x[1], x[2]);
+    bones.setVector(kBoneBasisYX, row, y[0], y[1], y[2]);
+    bones.setVector(kBoneBasisZX, row, z[0], z[1], z[2]);
+    bones.value(kBoneLength, row) = length;
+    bones.value(kBoneWidth, row) = width;
+}
+
+SyntheticSource::SyntheticSource(const SyntheticSettings &settings)
+{
+    setup(settings);
+}
+
+void SyntheticSource::setup(const SyntheticSettings &settings)
+{
+    m_settings = settings;
+
+    if (m_settings.hands < 0) m_settings.hands = 0;
+    if (m_settings.fingers < 0) m_settings.fingers = 0;
+    if (m_settings.fingers > 5) m_settings.fingers = 5;
+    if (m_settings.tools < 0) m_settings.tools = 0;
+    if (m_settings.gestures < 0) m_settings.gestures = 0;
+    if (m_settings.rate <= 0.) m_settings.rate = 120.;
+    if (m_settings.orbitPeriod <= 0.) m_settings.orbitPeriod = 4.;
+
+    rewind();
+}
+
+void SyntheticSource::rewind()
+{
+    m_frame = 0;
+    m_random = m_settings.seed ? m_settings.seed : 1;
+    m_nextId = 1;
+
+    m_handIds.resize(m_settings.hands);
+    m_lostUntil.assign(m_settings.hands, 0);
+    m_gestureIds.resize(m_settings.gestures);
+
+    for (long h = 0; h < m_settings.hands; h++)
+        m_handIds[h] = m_nextId++;
+
+    for (long g = 0; g < m_settings.gestures; g++)
+        m_gestureIds[g] = m_nextId++;
+}
+
+double SyntheticSource::random()
+{
+    // xorshift32
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+
+    return m_random * (2. / 4294967295.) - 1.;
+}
+
+bool SyntheticSource::nextTimestamp(int64_t &timestamp) const
+{
+    if (m_settings.frames && m_frame >= m_settings.frames)
+        return false;
+
+    timestamp = SYNTHETIC_FIRST_TIMESTAMP + (int64_t)(m_frame * 1000000. / m_settings.rate);
+    return true;
+}
+
+bool SyntheticSource::read(FrameSnapshot &snapshot)
+{
+    int64_t timestamp;
+
+    if (!nextTimestamp(timestamp))
+        return false;
+
+    const double t = m_frame / m_settings.rate;
+    const double w = 2 * M_PI / m_settings.orbitPeriod;
+    const double r = m_settings.orbitRadius;
+    const double noise = m_settings.noise;
+
+    snapshot.clear();
+    snapshot.id = SYNTHETIC_FIRST_ID + m_frame;
+    snapshot.timestamp = timestamp;
+
+    /// hands and their fingers /////////////////////////////////////////////
+    HandTable &hands = snapshot.hands;
+    FingerTable &fingers = snapshot.fingers;
+    BoneTable &bones = snapshot.bones;
+
+    hands.reserve(m_settings.hands);
+    fingers.reserve(m_settings.hands * m_settings.fingers);
+
+    if (m_settings.bones)
+        bones.reserve(m_settings.hands * (m_settings.fingers * 4 + 1));
+
+    for (long h = 0; h < m_settings.hands; h++)
+    {
+        // a lost hand comes back with a new id, as with the Leap service
+        if (m_lostUntil[h] > m_frame)
+            continue;
+
+        if (m_lostUntil[h] == m_frame && m_frame)
+            m_handIds[h] = m_nextId++;
+
+        if (m_settings.dropout > 0. && (random() + 1.) * 0.5 < m_settings.dropout)
+        {
+            m_lostUntil[h] = m_frame + 1 + (uint64_t)(m_settings.dropoutLength * m_settings.rate);
+            continue;
+        }
+
+        const uint32_t row = hands.addRow();
+        const double phase = w * t + h * 2 * M_PI / m_settings.hands;
+        const double c = cos(phase);
+        const double s = sin(phase);
+
+        const float x = r * c + noise * random();
+        const float y = 200. + 0.5 * r * s + noise * random();
+        const float z = r * s + noise * random();
+
+        hands.setVector(kHandPalmX, row, x, y, z);
+        hands.setVector(kHandDirectionX, row, -s, 0., -c);
+        hands.setVector(kHandVelocityX, row, -r * w * s, 0.5 * r * w * c, r * w * c);
+        hands.setVector(kHandNormalX, row, 0., -1., 0.);
+        hands.setVector(kHandSphereX, row, x, y - 40., z);
+        hands.value(kHandSphereRadius, row) = 60.;
+        hands.value(kHandPinch, row) = 0.5 + 0.5 * sin(w * t * 3.);
+        hands.value(kHandGrab, row) = 0.5 + 0.5 * cos(w * t * 2.);
+
+        hands.integer(kHandId, row) = m_handIds[h];
+        hands.integer(kHandIsLeft, row) = h % 2 == 0;
+        hands.integer(kHandFirstFinger, row) = fingers.count();
+        hands.integer(kHandFingerCount, row) = m_settings.fingers;
+
+        // fingers spread along the hand direction, curling in turn
+        for (long f = 0; f < m_settings.fingers; f++)
+        {
+            const uint32_t finger = fingers.addRow();
+            const double spread = (f - 2) * 0.25;
+            const double curl = 0.5 + 0.5 * sin(w * t * 4. + f);
+            const double length = 50. + 10. * (f == 2) - 10. * (f == 4);
+            const double dx = -sin(phase + spread);
+            const double dz = -cos(phase + spread);
+
+            fingers.setVector(kFingerTipX, finger,
+                              x + dx * length * curl + noise * random(),
+                              y - 20. * (1. - curl) + noise * random(),
+                              z + dz * length * curl + noise * random());
+            fingers.setVector(kFingerDirectionX, finger, dx, 0., dz);
+            fingers.setVector(kFingerVelocityX, finger, -r * w * s, 0.5 * r * w * c, r * w * c);
+            fingers.value(kFingerWidth, finger) = 18.;
+            fingers.value(kFingerLength, finger) = length;
+
+            fingers.integer(kFingerId, finger) = m_handIds[h] * 10 + f;
+            fingers.integer(kFingerHandId, finger) = m_handIds[h];
+            fingers.integer(kFingerIsExtended, finger) = curl > 0.5;
+            fingers.integer(kFingerType, finger) = f;
+
+            if (!m_settings.bones)
+                continue;
+
+            // metacarpal from the wrist to the knuckle, then the phalanges share the knuckle to tip segment
+            const double wrist[3] = {x + s * 40., y, z + c * 40.};
+            const double knuckle[3] = {x + dx * 10., y, z + dz * 10.};
+            const double tip[3] = {fingers.value(kFingerTipX, finger), fingers.value(kFingerTipY, finger), fingers.value(kFingerTipZ, finger)};
+            const double split[5] = {0., 0., 0.45, 0.75, 1.};
+            double prev[3] = {wrist[0], wrist[1], wrist[2]};
+
+            for (int b = kBoneMetacarpal; b <= kBoneDistal; b++)
+            {
+                double next[3];
+
+                for (int k = 0; k < 3; k++)
+                    next[k] = b == kBoneMetacarpal ? knuckle[k] : knuckle[k] + (tip[k] - knuckle[k]) * split[b + 1];
+
+                const uint32_t bone = bones.addRow();
+                setBone(bones, bone, prev, next, 18.);
+
+                bones.integer(kBoneHandId, bone) = m_handIds[h];
+                bones.integer(kBoneFingerType, bone) = f;
+                bones.integer(kBoneType, bone) = b;
+
+                memcpy(prev, next, sizeof(prev));
+            }
+        }
+
+        if (m_settings.bones)
+        {
+            // the forearm trails behind the hand
+            const double elbow[3] = {x + s * 290., y - 60., z + c * 290.};
+            const double wrist[3] = {x + s * 40., y, z + c * 40.};
+            const uint32_t bone = bones.addRow();
+
+            setBone(bones, bone, elbow, wrist, 60.);
+
+            bones.integer(kBoneHandId, bone) = m_handIds[h];
+            bones.integer(kBoneFingerType, bone) = -1;
+            bones.integer(kBoneType, bone) = kBoneArm;
+        }
+    }
+
+    /// tools ///////////////////////////////////////////////////////////////
+    ToolTable &tools = snapshot.tools;
+    tools.resize(m_settings.tools);
+
+    for (long i = 0; i < m_settings.tools; i++)
+    {
+        // tools orbit the other way, lower
+        const double phase = -w * t + i * 2 * M_PI / m_settings.tools;
+        const double c = cos(phase);
+        const double s = sin(phase);
+
+        tools.setVector(kToolTipX, i, r * c + noise * random(), 120. + noise * random(), r * s + noise * random());
+        tools.setVector(kToolDirectionX, i, 0., -1., 0.);
+        tools.setVector(kToolVelocityX, i, r * w * s, 0., -r * w * c);
+        tools.value(kToolWidth, i) = 8.;
+        tools.value(kToolLength, i) = 120.;
+
+        tools.integer(kToolId, i) = 100000 + i;
+        tools.integer(kToolIsExtended, i) = 1;
+    }
+
+    /// gestures ////////////////////////////////////////////////////////////
+    GestureTable &gestures = snapshot.gestures;
+    gestures.resize(m_settings.gestures);
+
+    for (long g = 0; g < m_settings.gestures; g++)
+    {
+        // gestures are staggered and each one lasts SYNTHETIC_GESTURE_FRAMES frames
+        const uint64_t age = (m_frame + g * 7) % SYNTHETIC_GESTURE_FRAMES;
+        const long type = ((m_frame + g * 7) / SYNTHETIC_GESTURE_FRAMES + g) % kGestureTypes;
+
+        if (age == 0 && m_frame)
+            m_gestureIds[g] = m_nextId++;
+
+        const float progress = (float)age / (SYNTHETIC_GESTURE_FRAMES - 1);
+
+        for (int c = 0; c < kGestureChannels; c++)
+            gestures.value(c, g) = 0.;
+
+        gestures.integer(kGestureId, g) = m_gestureIds[g];
+        gestures.integer(kGestureType, g) = type;
+        gestures.integer(kGestureState, g) = age == 0 ? 1 : age == SYNTHETIC_GESTURE_FRAMES - 1 ? 3 : 2;
+        gestures.integer(kGestureClockwise, g) = g % 2;
+
+        switch (type)
+        {
+            case kGestureCircle:
+                gestures.value(kGestureProgress, g) = progress * 2.;
+                gestures.value(kGestureRadius, g) = 30.;
+                gestures.value(kGestureSweptAngle, g) = age ? 2 * 2 * M_PI / (SYNTHETIC_GESTURE_FRAMES - 1) : 0.;
+                break;
+
+            case kGestureSwipe:
+                gestures.setVector(kGestureDirectionX, g, 1., 0., 0.);
+                gestures.value(kGestureSpeed, g) = 1000.;
+                break;
+
+            default:
+                gestures.setVector(kGesturePositionX, g, 0., 150., 0.);
+                gestures.setVector(kGestureDirectionX, g, 0., -1., 0.);
+                break;
+        }
+    }
+
+    m_frame++;
+    return true;
+}
@@ -0,0 +1,79 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief SyntheticSource : generated frames for load and scaling tests
+ *
+ * @details Hands and tools orbit around the middle of the Leap field of view, fingers (and their bones) follow their hand,
+ * gestures cycle through every type and state. Positions can be perturbed by noise and hands can be
+ * lost for a while (tracking dropouts). Everything is computed from the frame number and a seeded
+ * random generator so the same settings always produce the same frames, at any frame rate.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __SyntheticSource_h__
+#define __SyntheticSource_h__
+
+#include "FrameSource.h"
+
+struct SyntheticSettings
+{
+    SyntheticSettings() :
+    hands(2), fingers(5), tools(0), gestures(1), bones(true),
+    rate(120.), frames(0),
+    orbitRadius(80.), orbitPeriod(4.),
+    noise(0.), dropout(0.), dropoutLength(0.25),
+    seed(1) {}
+
+    long        hands;          // tracked hands (when none is lost)
+    long        fingers;        // per hand, at most 5
+    long        tools;
+    long        gestures;       // per frame
+    bool        bones;          // the skeleton of each hand : four bones per finger and the arm
+    double      rate;           // frames per second
+    uint64_t    frames;         // number of frames before the end, 0 for endless
+
+    double      orbitRadius;    // in mm
+    double      orbitPeriod;    // in seconds
+    double      noise;          // amplitude of the position noise in mm
+    double      dropout;        // probability for a hand to be lost at each frame
+    double      dropoutLength;  // in seconds
+    uint32_t    seed;
+};
+
+class SyntheticSource : public FrameSource
+{
+public:
+    SyntheticSource(const SyntheticSettings &settings = SyntheticSettings());
+
+    /// change the settings and go back to the first frame
+    void setup(const SyntheticSettings &settings);
+
+    const SyntheticSettings &settings() const { return m_settings; }
+
+    virtual bool read(FrameSnapshot &snapshot);
+
+    virtual bool nextTimestamp(int64_t &timestamp) const;
+
+    virtual void rewind();
+
+private:
+    /// uniform in [-1, 1]
+    double random();
+
+    SyntheticSettings       m_settings;
+    uint64_t                m_frame;        // number of the next frame
+    uint32_t                m_random;       // xorshift state
+    int32_t                 m_nextId;       // for hands, tools and gestures appearing
+    std::vector<int32_t>    m_handIds;
+    std::vector<uint64_t>   m_lostUntil;    // frame at which a lost hand comes back
+    std::vector<int32_t>    m_gestureIds;
+};
+
+#endif // __SyntheticSource_h__
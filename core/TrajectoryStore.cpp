@@ -0,0 +1,197 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief TrajectoryStore : the latest positions and velocities of every hand and finger, queried over a time window
+ *
+ * @details
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#include "TrajectoryStore.h"
+
+#include <math.h>
+
+TrajectoryBank::TrajectoryBank() :
+m_samples(0),
+m_rows(0)
+{
+}
+
+void TrajectoryBank::setup(uint32_t samples)
+{
+    if (samples > LEAP_TRAJECTORY_MAX)
+        samples = LEAP_TRAJECTORY_MAX;
+
+    if (samples == m_samples)
+        return;
+
+    // the rings of the slots change their size : every trajectory starts again
+    reset();
+    m_samples = samples;
+    m_channels.assign(m_pool.capacity() * kTrajectoryChannels * samples, 0.f);
+    m_times.assign(m_pool.capacity() * samples, 0);
+}
+
+void TrajectoryBank::reset()
+{
+    m_pool.reset();
+    m_rows = 0;
+}
+
+uint32_t TrajectoryBank::acquire(int32_t id)
+{
+    const uint32_t slot = m_pool.acquire(id);
+    const uint32_t capacity = m_pool.capacity();
+
+    if (m_counts.size() < capacity)
+    {
+        m_channels.resize(capacity * kTrajectoryChannels * m_samples, 0.f);
+        m_times.resize(capacity * m_samples, 0);
+        m_counts.resize(capacity, 0);
+        m_heads.resize(capacity, 0);
+    }
+
+    m_counts[slot] = 0;
+    m_heads[slot] = 0;
+    return slot;
+}
+
+uint32_t TrajectoryBank::advance(uint32_t slot, int64_t timestamp)
+{
+    int64_t *times = &m_times[slot * m_samples];
+    uint32_t &count = m_counts[slot];
+    uint32_t &head = m_heads[slot];
+
+    if (!count || times[head] != timestamp)
+    {
+        head = (head + 1) % m_samples;
+
+        if (count < m_samples)
+            count++;
+    }
+
+    times[head] = timestamp;
+    return head;
+}
+
+bool TrajectoryBank::query(int32_t id, double window, TrajectoryStats &stats) const
+{
+    const uint32_t slot = m_pool.find(id, 0);
+
+    if (slot == m_pool.capacity())
+        return false;
+
+    queryStats(slot, window, stats);
+    return true;
+}
+
+void TrajectoryBank::queryStats(uint32_t slot, double window, TrajectoryStats &stats) const
+{
+    const float *x = &m_channels[slot * kTrajectoryChannels * m_samples];
+    const float *vx = x + kTrajectoryVelocityX * m_samples;
+    const float *y = x + kTrajectoryY * m_samples;
+    const float *vy = x + kTrajectoryVelocityY * m_samples;
+    const float *z = x + kTrajectoryZ * m_samples;
+    const float *vz = x + kTrajectoryVelocityZ * m_samples;
+    const int64_t *times = &m_times[slot * m_samples];
+    const uint32_t count = m_counts[slot];
+    const uint32_t head = m_heads[slot];
+
+    stats.samples = 0;
+    stats.duration = 0.;
+    stats.pathLength = 0.;
+    stats.meanSpeed = 0.;
+    stats.peakAcceleration = 0.;
+
+    if (!count)
+        return;
+
+    for (int c = 0; c < 3; c++)
+        stats.min[c] = stats.max[c] = x[head + c * m_samples];
+
+    // from the newest sample back to the oldest one in the window
+    const int64_t oldest = times[head] - (int64_t)(window * 1000.);
+    double speeds = 0.;
+    uint32_t next = head;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t s = (head + m_samples - i) % m_samples;
+
+        if (times[s] < oldest)
+            break;
+
+        speeds += sqrtf(vx[s] * vx[s] + vy[s] * vy[s] + vz[s] * vz[s]);
+
+        stats.min[0] = x[s] < stats.min[0] ? x[s] : stats.min[0];
+        stats.min[1] = y[s] < stats.min[1] ? y[s] : stats.min[1];
+        stats.min[2] = z[s] < stats.min[2] ? z[s] : stats.min[2];
+        stats.max[0] = x[s] > stats.max[0] ? x[s] : stats.max[0];
+        stats.max[1] = y[s] > stats.max[1] ? y[s] : stats.max[1];
+        stats.max[2] = z[s] > stats.max[2] ? z[s] : stats.max[2];
+
+        // with the sample after it
+        if (i)
+        {
+            const float dx = x[next] - x[s];
+            const float dy = y[next] - y[s];
+            const float dz = z[next] - z[s];
+            const float dvx = vx[next] - vx[s];
+            const float dvy = vy[next] - vy[s];
+            const float dvz = vz[next] - vz[s];
+            const double dt = (times[next] - times[s]) * 0.000001;
+            const double acceleration = dt > 0. ? sqrtf(dvx * dvx + dvy * dvy + dvz * dvz) / dt : 0.;
+
+            stats.pathLength += sqrtf(dx * dx + dy * dy + dz * dz);
+
+            if (acceleration > stats.peakAcceleration)
+                stats.peakAcceleration = acceleration;
+        }
+
+        stats.duration = (times[head] - times[s]) * 0.001;
+        stats.samples++;
+        next = s;
+    }
+
+    stats.meanSpeed = speeds / stats.samples;
+}
+
+TrajectoryStore::TrajectoryStore() :
+m_timestamp(0)
+{
+}
+
+void TrajectoryStore::setup(uint32_t samples)
+{
+    m_hands.setup(samples);
+    m_fingers.setup(samples);
+    m_timestamp = 0;
+}
+
+void TrajectoryStore::reset()
+{
+    m_hands.reset();
+    m_fingers.reset();
+    m_timestamp = 0;
+}
+
+void TrajectoryStore::push(const FrameSnapshot &snapshot)
+{
+    if (!samples())
+        return;
+
+    // going back in time (e.g. a replay looping) would mix two takes in a trajectory
+    if (snapshot.timestamp < m_timestamp)
+        reset();
+
+    m_timestamp = snapshot.timestamp;
+
+    m_hands.push(snapshot.hands, kHandId, kHandPalmX, kHandVelocityX, snapshot.timestamp);
+    m_fingers.push(snapshot.fingers, kFingerId, kFingerTipX, kFingerVelocityX, snapshot.timestamp);
+}
@@ -0,0 +1,160 @@
+/** @file
+ *
+ * @ingroup implementationMaxExternals
+ *
+ * @brief TrajectoryStore : the latest positions and velocities of every hand and finger, queried over a time window
+ *
+ * @details Each tracked hand (palm) and finger (tip) keeps a ring of its latest samples in a slot of a SlotPool,
+ * found again by id. A slot stores its samples channel by channel (x, y, z, then velocity x, y, z, each a run of
+ * samples floats) next to their timestamps. An id that disappears gives its slot back : a hand that comes back
+ * with a new id starts a new trajectory instead of continuing the one of another hand.
+ * Queries walk the ring back from the newest sample for as long as the samples are in the window.
+ * It depends neither on the Leap SDK nor on the Max SDK.
+ *
+ * @author Théo de la Hogue
+ *
+ * @copyright © 2014 by Théo de la Hogue @n
+ * This code is licensed under the terms of the "New BSD License" @n
+ * http://creativecommons.org/licenses/BSD/
+ */
+
+#ifndef __TrajectoryStore_h__
+#define __TrajectoryStore_h__
+
+#include "FrameSnapshot.h"
+#include "SlotPool.h"
+
+// most samples per object (about 9 s at 110 fps)
+#define LEAP_TRAJECTORY_MAX 1024
+
+enum eTrajectoryChannel
+{
+    kTrajectoryX, kTrajectoryY, kTrajectoryZ,
+    kTrajectoryVelocityX, kTrajectoryVelocityY, kTrajectoryVelocityZ,
+    kTrajectoryChannels
+};
+
+/// what a query reports about the samples of one object in a window
+struct TrajectoryStats
+{
+    uint32_t    samples;
+    double      duration;           // between the oldest and the newest sample (in ms)
+    double      pathLength;         // in mm
+    double      meanSpeed;          // mean of the velocity norms (in mm/s)
+    double      peakAcceleration;   // largest velocity change per second between two samples (in mm/s²)
+    float       min[3];             // bounding box of the positions
+    float       max[3];
+};
+
+/** The trajectories of the rows of one kind of SnapshotTable, pooled by id.
+    Memory only grows : once it has seen its largest number of objects, pushing a frame does not allocate. */
+class TrajectoryBank
+{
+public:
+    TrajectoryBank();
+
+    /// keep samples samples per object (it forgets every trajectory)
+    void setup(uint32_t samples);
+
+    uint32_t samples() const { return m_samples; }
+
+    void reset();
+
+    /// number of objects having a trajectory
+    uint32_t active() const { return m_pool.active(); }
+
+    /// id of the object of a slot (SlotPool::kFreeSlot when there is none), slots go from 0 to capacity()
+    uint32_t capacity() const { return m_pool.capacity(); }
+
+    int32_t id(uint32_t slot) const { return m_pool.id(slot); }
+
+    /// add a sample to each row of a table : 3 position channels from position and 3 velocity channels from velocity
+    template<class Table>
+    void push(const Table &table, int idField, int position, int velocity, int64_t timestamp)
+    {
+        if (!m_samples)
+            return;
+
+        const uint32_t rows = table.count();
+
+        if (m_rowSlots.size() < rows)
+            m_rowSlots.resize(rows);
+
+        m_pool.begin();
+
+        // the slot of each row : most of the time the one of the same row in the previous frame
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            const int32_t id = table.integer(idField, r);
+            uint32_t slot = m_pool.find(id, r < m_rows ? m_rowSlots[r] : 0);
+
+            if (slot == m_pool.capacity())
+                slot = acquire(id);
+
+            m_pool.mark(slot);
+            m_rowSlots[r] = slot;
+
+            const uint32_t sample = advance(slot, timestamp);
+            float *channels = &m_channels[slot * kTrajectoryChannels * m_samples] + sample;
+
+            for (int c = 0; c < 3; c++)
+            {
+                channels[(kTrajectoryX + c) * m_samples] = table.value(position + c, r);
+                channels[(kTrajectoryVelocityX + c) * m_samples] = table.value(velocity + c, r);
+            }
+        }
+
+        // the trajectories of the ids that disappeared are given back
+        m_pool.end();
+        m_rows = rows;
+    }
+
+    /// stats of the samples of an id not older than window ms before its newest one, false if the id has no trajectory
+    bool query(int32_t id, double window, TrajectoryStats &stats) const;
+
+    /// stats of the trajectory of a slot
+    void queryStats(uint32_t slot, double window, TrajectoryStats &stats) const;
+
+private:
+    uint32_t acquire(int32_t id);
+
+    /// the sample of a slot to write at timestamp (the same frame pushed twice rewrites its sample)
+    uint32_t advance(uint32_t slot, int64_t timestamp);
+
+    uint32_t                m_samples;      // per slot
+    SlotPool                m_pool;
+    std::vector<float>      m_channels;     // kTrajectoryChannels runs of m_samples floats per slot
+    std::vector<int64_t>    m_times;        // m_samples timestamps per slot
+    std::vector<uint32_t>   m_counts;       // samples in the ring of each slot
+    std::vector<uint32_t>   m_heads;        // newest sample of each slot
+    std::vector<uint32_t>   m_rowSlots;     // slot of each row of the latest frame
+    uint32_t                m_rows;         // rows of the latest frame
+};
+
+class TrajectoryStore
+{
+public:
+    TrajectoryStore();
+
+    /// keep samples samples per hand and per finger, 0 to stop keeping any
+    void setup(uint32_t samples);
+
+    uint32_t samples() const { return m_hands.samples(); }
+
+    /// add the palm of each hand and the tip of each finger of a snapshot
+    void push(const FrameSnapshot &snapshot);
+
+    /// forget every trajectory
+    void reset();
+
+    const TrajectoryBank &hands() const { return m_hands; }
+
+    const TrajectoryBank &fingers() const { return m_fingers; }
+
+private:
+    TrajectoryBank          m_hands;
+    TrajectoryBank          m_fingers;
+    int64_t                 m_timestamp;    // of the latest pushed frame, 0 after a reset
+};
+
+#endif // __TrajectoryStore_h__
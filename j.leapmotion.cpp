@@ -15,31 +15,172 @@
 
 #include "ext.h"							// standard Max include, always required
 #include "ext_obex.h"						// required for new style Max object
+#include "jit.common.h"                     // to output jit.matrix
+#include "z_dsp.h"                          // to output signals
 
 #include "Leap.h"
+#include "SpscRing.h"
+#include "FrameSnapshot.h"
+#include "FrameExtract.h"
+#include "FrameEncode.h"
+#include "FrameOutput.h"
+#include "SignalRamp.h"
+#include "BangStats.h"
+#include "FrameRecorder.h"
+#include "ReplaySource.h"
+#include "SyntheticSource.h"
+#include "JointSolver.h"
+#include "FrameFilter.h"
+#include "FramePredictor.h"
+#include "TrajectoryStore.h"
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
-#define _USE_MATH_DEFINES // To get definition of M_PI
-#include <math.h>
+// the Leap service keeps this many frames in the controller history
+#define LEAP_HISTORY_SIZE 60
+
+////////////////////////// shared controller
+// frames are extracted once into snapshots cached by frame id and shared by all instances.
+// direct mapped on frame id : big enough for catch-up and push mode to hit too
+#define LEAP_FRAME_CACHE_SIZE 64
+
+// how late a replayed frame can be before the replay gives up catching up (in ms)
+#define LEAP_REPLAY_LATE_MS 100
+
+// the period of a looping source whose frames all share one timestamp (in microseconds, about 110 fps)
+#define LEAP_REPLAY_PERIOD 9000
+
+/** One controller (so one service connection) for the whole process,
+    created by the first instance and deleted with the last one. */
+typedef struct _leapmotion_shared
+{
+    long                refcount;
+    Leap::Controller    *controller;
+    FrameSnapshot       frames[LEAP_FRAME_CACHE_SIZE];
+    long                bones;          // number of instances outputting bones or joints : frames are extracted with bones when not 0
+} t_leapmotion_shared;
+
+static t_leapmotion_shared *leapmotion_shared = NULL;
 
 ////////////////////////// object struct
+class LeapmotionListener;
+
 typedef struct _leapmotion
 {
-	t_object            ob;
+	t_pxobject          ob;             // an MSP object only when instantiated with @signals, then it has signal outlets
 	int64_t             frame_id_save;
-    t_symbol*           stateNames[4];
-	void                *outlets[7];
-	Leap::Controller    *leap;
+    t_symbol*           stateNames[kSymbols];   // gesture states then every other symbol output per frame (see eSymbol)
+	void                *outlets[10];
+	Leap::Controller    *leap;          // the live frames (not a LiveSource : see LiveSource.h)
+    
+    t_atom_long         push;           // push mode : frames are delivered by a Leap::Listener instead of polled on bang
+    LeapmotionListener  *listener;
+    t_clock             *push_clock;    // drains the listener ring on the scheduler thread (its only consumer)
+    
+    t_atom_long         catchup;        // catch-up mode : frames missed since the last output are emitted from history
+    t_atom_long         catchup_max;    // maximum number of missed frames emitted before a frame
+    t_atom_long         dropped;        // number of frames that were never output
+    Leap::Frame         *catchup_frames;// preallocated handles used to walk the history back
+    
+    t_symbol            *output;        // lists or packed
+    long                output_mode;
+    std::vector<t_atom> *packed;        // reused buffer of the packed list
+    
+    void                *matrix;        // jit_matrix output in matrix mode (created on demand)
+    t_symbol            *matrix_name;
+    
+    t_atom_long         bones;          // bones mode : the skeleton of every hand is output on the bone outlet
+    void                *bone_matrix;   // jit_matrix of the bones in matrix mode (created on demand)
+    t_symbol            *bone_matrix_name;
+    
+    t_atom_long         joints;         // joints mode : the local rotation of every joint is output on the bone outlet
+    JointSolver         *joint_solver;
+    
+    t_symbol            *smooth;        // off, euro or kalman : the tracked values are filtered before output
+    double              smooth_euro[3]; // min cutoff (Hz), beta and derivative cutoff (Hz)
+    double              smooth_kalman[2];   // acceleration (mm/s²) and measure noise (mm)
+    FrameFilter         *filter;
+    
+    t_atom_float        predict;        // the positions are predicted this far ahead (in ms), 0 for none
+    t_atom_float        predict_damping;// share of the acceleration left out of the prediction
+    FramePredictor      *predictor;
+    FrameSnapshot       *processed;     // the smoothed and predicted copy of the frame being output
+    GestureProgressCache *circles;      // to measure the angle swept by circles since the previous output frame
+    
+    t_atom_long         history;        // number of samples kept per hand and finger for trajectory queries, 0 for none
+    TrajectoryStore     *trajectories;
+    
+    long                signal_count;   // number of signal outlets
+    long                signal_channels[LEAP_SIGNAL_MAX];   // an eSignalChannel per signal outlet
+    double              signal_values[LEAP_SIGNAL_MAX];     // latest sampled values
+    t_symbol            *signal_hand;   // first, left or right
+    long                signal_hand_mode;
+    int64_t             signal_timestamp;                   // of the latest sampled frame
+    SignalRamp          *signal_ramp;
+    double              signal_samplerate;                  // of the dsp chain (a poly~ may up- or down-sample it)
+    
+    t_atom_long         stats;          // stats mode : timing of the output path is reported on the stats outlet
+    t_atom_long         stats_window;   // number of output frames per report
+    BangStats           *bang_stats;
+    double              stats_phases[kStatPhases];          // of the frame being output
+    int64_t             stats_fetched;  // local time the frame being output was fetched at
+    t_atom_long         stats_dropped;  // dropped count at the start of the window
+    t_symbol            *stats_names[kStatPhases + 2];      // phase names then duplicates and dropped
+    
+    FrameRecorder       *recorder;      // writes every output frame to a file (created on the first record message)
+    
+    ReplaySource        *replay;        // the frames of a recorded file
+    SyntheticSource     *synthetic;     // generated frames
+    FrameSource         *source;        // a source output on its own schedule instead of the Leap frames (NULL when none)
+    FrameSnapshot       *replay_snapshot;
+    t_clock             *replay_clock;
+    t_critical          lock;           // held to change the source, its schedule or the state of the frames being processed
+                                        // (frames are read and processed on the scheduler thread, messages come from the main thread)
+    double              replay_origin;  // scheduler time (in ms) at which the frame of replay_origin_ts is due
+    int64_t             replay_origin_ts;
+    int64_t             replay_last_ts; // timestamp of the latest replayed frame
+    int64_t             replay_period;  // between the two latest replayed frames (in microseconds)
+    t_atom_float        replay_speed;
+    t_atom_long         replay_loop;
 } t_leapmotion;
 
-#define end_frame_out 0
-#define gesture_out 1
-#define tool_out 2
-#define finger_out 3
-#define hand_out 4
-#define frame_out 5
-#define	start_frame_out 6
+/** Receives frames on the Leap service thread and queues them for the Max side.
+    onFrame never allocates : frames are copied into the preallocated ring then the drain clock is set. */
+class LeapmotionListener : public Leap::Listener
+{
+public:
+    LeapmotionListener(t_leapmotion *x) : x(x) {}
+    
+    virtual void onFrame(const Leap::Controller& controller)
+    {
+        // when the ring is full the frame is lost here but the Max side
+        // sees the gap in frame ids (and may recover it in catch-up mode)
+        frames.push(controller.frame());
+        
+        clock_delay(x->push_clock, 0);
+    }
+    
+    t_leapmotion                *x;
+    SpscRing<Leap::Frame, 64>   frames;
+};
+
+#define end_frame_out kOutletEndFrame
+#define gesture_out kOutletGesture
+#define tool_out kOutletTool
+#define finger_out kOutletFinger
+#define hand_out kOutletHand
+#define frame_out kOutletFrame
+#define	start_frame_out kOutletStartFrame
+#define bone_out kOutletBone
+#define matrix_out 8
+#define stats_out 9
+
+#define output_lists 0
+#define output_packed 1
+#define output_matrix 2
 
 ///////////////////////// function prototypes
 //// standard set
@@ -48,6 +189,55 @@ void leapmotion_free(t_leapmotion *x);
 void leapmotion_assist(t_leapmotion *x, void *b, long m, long a, char *s);
 
 void leapmotion_bang(t_leapmotion *x);
+void leapmotion_record(t_leapmotion *x, t_symbol *s, long argc, t_atom *argv);
+void leapmotion_replay(t_leapmotion *x, t_symbol *s, long argc, t_atom *argv);
+void leapmotion_seek(t_leapmotion *x, double ms);
+void leapmotion_seek_frame(t_leapmotion *x, t_atom_long id);
+void leapmotion_synthetic(t_leapmotion *x, t_symbol *s, long argc, t_atom *argv);
+void leapmotion_trajectory(t_leapmotion *x, t_symbol *s, long argc, t_atom *argv);
+void leapmotion_source_start(t_leapmotion *x, FrameSource *source);
+void leapmotion_source_stop(t_leapmotion *x);
+void leapmotion_replay_tick(t_leapmotion *x);
+bool leapmotion_replay_read(t_leapmotion *x, double now);
+void leapmotion_replay_rebase(t_leapmotion *x);
+void leapmotion_drain(t_leapmotion *x);
+void leapmotion_output_frame(t_leapmotion *x, const Leap::Frame &frame);
+void leapmotion_catchup(t_leapmotion *x, const Leap::Frame &frame);
+void leapmotion_emit(t_leapmotion *x, const Leap::Frame &frame);
+void leapmotion_emit_snapshot(t_leapmotion *x, const FrameSnapshot &snapshot);
+const FrameSnapshot *leapmotion_process_snapshot(t_leapmotion *x, const FrameSnapshot &snapshot);
+void leapmotion_output_snapshot(t_leapmotion *x, const FrameSnapshot &output, const FrameSnapshot &snapshot, int64_t start);
+void leapmotion_emit_lists(t_leapmotion *x, const FrameSnapshot &snapshot);
+void leapmotion_emit_packed(t_leapmotion *x, const FrameSnapshot &snapshot);
+void leapmotion_emit_matrix(t_leapmotion *x, const FrameSnapshot &snapshot);
+void leapmotion_output_matrix(t_leapmotion *x, void *matrix, t_symbol *name, long rows, const FrameSnapshot &snapshot,
+                              void (*encode)(const FrameSnapshot&, float*, long), void *outlet);
+void *leapmotion_matrix_new(t_leapmotion *x, long planes, t_symbol **name);
+void leapmotion_emit_signals(t_leapmotion *x, const FrameSnapshot &snapshot);
+void leapmotion_report_stats(t_leapmotion *x);
+
+void leapmotion_dsp64(t_leapmotion *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags);
+void leapmotion_perform64(t_leapmotion *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
+
+Leap::Controller *leapmotion_shared_retain();
+void leapmotion_shared_release();
+const FrameSnapshot *leapmotion_shared_frame(const Leap::Frame &frame, double *phases);
+
+t_max_err leapmotion_attr_set_push(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_output(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_bones(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_joints(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_smooth(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_smooth_euro(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_smooth_kalman(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+void leapmotion_smooth_setup(t_leapmotion *x);
+t_max_err leapmotion_attr_set_predict(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_predict_damping(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_history(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+void leapmotion_shared_bones(t_leapmotion *x, bool needed);
+t_max_err leapmotion_attr_set_signal_hand(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_stats_window(t_leapmotion *x, void *attr, long argc, t_atom *argv);
+t_max_err leapmotion_attr_set_replay_speed(t_leapmotion *x, void *attr, long argc, t_atom *argv);
 
 //////////////////////// global class pointer variable
 void *leapmotion_class;
@@ -61,10 +251,97 @@ int C74_EXPORT main(void)
 				  0L /* leave NULL!! */, A_GIMME, 0);
 	
     class_addmethod(c, (method)leapmotion_bang, "bang", 0);
+    class_addmethod(c, (method)leapmotion_record, "record", A_GIMME, 0);
+    class_addmethod(c, (method)leapmotion_replay, "replay", A_GIMME, 0);
+    class_addmethod(c, (method)leapmotion_seek, "seek", A_FLOAT, 0);
+    class_addmethod(c, (method)leapmotion_seek_frame, "seek_frame", A_LONG, 0);
+    class_addmethod(c, (method)leapmotion_synthetic, "synthetic", A_GIMME, 0);
+    class_addmethod(c, (method)leapmotion_trajectory, "trajectory", A_GIMME, 0);
+    class_addmethod(c, (method)leapmotion_dsp64, "dsp64", A_CANT, 0);
+    
+    CLASS_ATTR_LONG(c, "push", 0, t_leapmotion, push);
+    CLASS_ATTR_ACCESSORS(c, "push", NULL, leapmotion_attr_set_push);
+    CLASS_ATTR_STYLE_LABEL(c, "push", 0, "onoff", "Push Frames From The Leap Thread");
+    
+    CLASS_ATTR_LONG(c, "catchup", 0, t_leapmotion, catchup);
+    CLASS_ATTR_STYLE_LABEL(c, "catchup", 0, "onoff", "Output Missed Frames From History");
+    
+    CLASS_ATTR_LONG(c, "catchup_max", 0, t_leapmotion, catchup_max);
+    CLASS_ATTR_FILTER_CLIP(c, "catchup_max", 1, LEAP_HISTORY_SIZE - 1);
+    CLASS_ATTR_LABEL(c, "catchup_max", 0, "Maximum Missed Frames Output At Once");
+    
+    CLASS_ATTR_LONG(c, "dropped", ATTR_SET_OPAQUE_USER, t_leapmotion, dropped);
+    CLASS_ATTR_LABEL(c, "dropped", 0, "Number Of Frames Never Output");
+    
+    CLASS_ATTR_SYM(c, "output", 0, t_leapmotion, output);
+    CLASS_ATTR_ACCESSORS(c, "output", NULL, leapmotion_attr_set_output);
+    CLASS_ATTR_ENUM(c, "output", 0, "lists packed matrix");
+    CLASS_ATTR_LABEL(c, "output", 0, "Output Mode");
+    
+    CLASS_ATTR_LONG(c, "bones", 0, t_leapmotion, bones);
+    CLASS_ATTR_ACCESSORS(c, "bones", NULL, leapmotion_attr_set_bones);
+    CLASS_ATTR_STYLE_LABEL(c, "bones", 0, "onoff", "Output The Skeleton Of Each Hand");
+    
+    CLASS_ATTR_LONG(c, "joints", 0, t_leapmotion, joints);
+    CLASS_ATTR_ACCESSORS(c, "joints", NULL, leapmotion_attr_set_joints);
+    CLASS_ATTR_STYLE_LABEL(c, "joints", 0, "onoff", "Output The Joint Rotations Of Each Hand");
+    
+    CLASS_ATTR_SYM(c, "smooth", 0, t_leapmotion, smooth);
+    CLASS_ATTR_ACCESSORS(c, "smooth", NULL, leapmotion_attr_set_smooth);
+    CLASS_ATTR_ENUM(c, "smooth", 0, "off euro kalman");
+    CLASS_ATTR_LABEL(c, "smooth", 0, "Smoothing Filter");
+    
+    CLASS_ATTR_DOUBLE_ARRAY(c, "smooth_euro", 0, t_leapmotion, smooth_euro, 3);
+    CLASS_ATTR_ACCESSORS(c, "smooth_euro", NULL, leapmotion_attr_set_smooth_euro);
+    CLASS_ATTR_LABEL(c, "smooth_euro", 0, "One-Euro Min Cutoff, Beta And Derivative Cutoff");
+    
+    CLASS_ATTR_DOUBLE_ARRAY(c, "smooth_kalman", 0, t_leapmotion, smooth_kalman, 2);
+    CLASS_ATTR_ACCESSORS(c, "smooth_kalman", NULL, leapmotion_attr_set_smooth_kalman);
+    CLASS_ATTR_LABEL(c, "smooth_kalman", 0, "Kalman Acceleration And Measure Noise");
+    
+    CLASS_ATTR_DOUBLE(c, "predict", 0, t_leapmotion, predict);
+    CLASS_ATTR_ACCESSORS(c, "predict", NULL, leapmotion_attr_set_predict);
+    CLASS_ATTR_FILTER_CLIP(c, "predict", 0., 100.);
+    CLASS_ATTR_LABEL(c, "predict", 0, "Prediction Horizon (ms)");
+    
+    CLASS_ATTR_DOUBLE(c, "predict_damping", 0, t_leapmotion, predict_damping);
+    CLASS_ATTR_ACCESSORS(c, "predict_damping", NULL, leapmotion_attr_set_predict_damping);
+    CLASS_ATTR_FILTER_CLIP(c, "predict_damping", 0., 1.);
+    CLASS_ATTR_LABEL(c, "predict_damping", 0, "Prediction Damping Of The Acceleration");
+    
+    CLASS_ATTR_LONG(c, "history", 0, t_leapmotion, history);
+    CLASS_ATTR_ACCESSORS(c, "history", NULL, leapmotion_attr_set_history);
+    CLASS_ATTR_FILTER_CLIP(c, "history", 0, LEAP_TRAJECTORY_MAX);
+    CLASS_ATTR_LABEL(c, "history", 0, "Samples Kept Per Hand And Finger For Trajectory Queries");
+    
+    // the signal channels themselves are given once as box arguments (@signals palm_x pinch ...)
+    // because they define the signal outlets
+    CLASS_ATTR_SYM(c, "signal_hand", 0, t_leapmotion, signal_hand);
+    CLASS_ATTR_ACCESSORS(c, "signal_hand", NULL, leapmotion_attr_set_signal_hand);
+    CLASS_ATTR_ENUM(c, "signal_hand", 0, "first left right");
+    CLASS_ATTR_LABEL(c, "signal_hand", 0, "Hand Output As Signals");
+    
+    CLASS_ATTR_LONG(c, "stats", 0, t_leapmotion, stats);
+    CLASS_ATTR_STYLE_LABEL(c, "stats", 0, "onoff", "Report Output Timing");
+    
+    CLASS_ATTR_LONG(c, "stats_window", 0, t_leapmotion, stats_window);
+    CLASS_ATTR_ACCESSORS(c, "stats_window", NULL, leapmotion_attr_set_stats_window);
+    CLASS_ATTR_FILTER_CLIP(c, "stats_window", 1, 100000);
+    CLASS_ATTR_LABEL(c, "stats_window", 0, "Number Of Frames Per Timing Report");
+    
+    CLASS_ATTR_DOUBLE(c, "replay_speed", 0, t_leapmotion, replay_speed);
+    CLASS_ATTR_ACCESSORS(c, "replay_speed", NULL, leapmotion_attr_set_replay_speed);
+    CLASS_ATTR_LABEL(c, "replay_speed", 0, "Replay Speed");
+    
+    CLASS_ATTR_LONG(c, "replay_loop", 0, t_leapmotion, replay_loop);
+    CLASS_ATTR_STYLE_LABEL(c, "replay_loop", 0, "onoff", "Loop Replay");
     
 	/* you CAN'T call this from the patcher */
     class_addmethod(c, (method)leapmotion_assist, "assist", A_CANT, 0);
 	
+    // the class has to be an MSP one for any instance to have signal outlets,
+    // but only the instances given @signals set themselves up for the dsp chain
+    class_dspinit(c);
 	class_register(CLASS_BOX, c);
 	leapmotion_class = c;
     
@@ -81,13 +358,48 @@ void *leapmotion_new(t_symbol *s, long argc, t_atom *argv)
         
         x->frame_id_save = 0;
         
-        // prepare state symbols
-        x->stateNames[0] = gensym("invalid");
-        x->stateNames[1] = gensym("start");
-        x->stateNames[2] = gensym("update");
-        x->stateNames[3] = gensym("end");
+        // prepare state, gesture and list symbols : no symbol lookup happens while outputting a frame
+        encodeSymbols(x->stateNames);
+        
+        // look for the signal channels in the box arguments (they are not an attribute)
+        std::vector<t_atom> args;
+        x->signal_count = 0;
+        
+        for (long i = 0; i < argc; i++)
+        {
+            if (atom_getsym(argv+i) == gensym("@signals"))
+            {
+                for (i++; i < argc && atom_getsym(argv+i)->s_name[0] != '@'; i++)
+                {
+                    const long channel = signalChannelFromName(atom_getsym(argv+i)->s_name);
+                    
+                    if (channel < 0)
+                        object_error((t_object*)x, "@signals : unknown channel %s", atom_getsym(argv+i)->s_name);
+                    else if (x->signal_count == LEAP_SIGNAL_MAX)
+                        object_error((t_object*)x, "@signals : no more than %d channels", LEAP_SIGNAL_MAX);
+                    else
+                        x->signal_channels[x->signal_count++] = channel;
+                }
+                i--;
+            }
+            else
+                args.push_back(argv[i]);
+        }
+        
+        // no signal inlet, the signal outlets are the rightmost ones
+        if (x->signal_count)
+        {
+            dsp_setup((t_pxobject*)x, 0);
+            x->ob.z_misc |= Z_NO_INPLACE;
+            
+            for (long i = x->signal_count - 1; i >= 0; i--)
+                outlet_new(x, "signal");
+        }
         
         // make several outlets
+        x->outlets[bone_out] = outlet_new(x, 0);         // bone_out anything or jit_matrix outlet
+        x->outlets[stats_out] = outlet_new(x, 0);        // stats_out anything outlet
+        x->outlets[matrix_out] = outlet_new(x, 0);       // matrix_out jit_matrix outlet
         x->outlets[start_frame_out] = outlet_new(x, 0);  // start_frame bang outlet
         x->outlets[frame_out] = outlet_new(x, 0);        // frame_out anything outlet
         x->outlets[hand_out] = outlet_new(x, 0);         // hand_out anything outlet
@@ -96,25 +408,562 @@ void *leapmotion_new(t_symbol *s, long argc, t_atom *argv)
         x->outlets[gesture_out] = outlet_new(x, 0);      // gesture_out anything outlet
         x->outlets[end_frame_out] = outlet_new(x, 0);    // end_frame bang outlet
         
+        // get the controller shared by all instances
+        x->leap = leapmotion_shared_retain();
+        
+        // prepare push mode (the listener is only added to the controller when push is on)
+        x->push = 0;
+        x->listener = new LeapmotionListener(x);
+        x->push_clock = clock_new(x, (method)leapmotion_drain);
+        
+        // prepare catch-up mode
+        x->catchup = 0;
+        x->catchup_max = LEAP_HISTORY_SIZE - 1;
+        x->dropped = 0;
+        x->catchup_frames = new Leap::Frame[LEAP_HISTORY_SIZE - 1];
+        
+        // prepare output mode
+        x->output = gensym("lists");
+        x->output_mode = output_lists;
+        x->packed = new std::vector<t_atom>;
+        x->matrix = NULL;
+        x->matrix_name = NULL;
+        
+        // prepare bones mode
+        x->bones = 0;
+        x->bone_matrix = NULL;
+        x->bone_matrix_name = NULL;
+        
+        // prepare joints mode
+        x->joints = 0;
+        x->joint_solver = new JointSolver;
+        
+        // prepare smoothing
+        FilterSettings filterSettings;
+        x->smooth = gensym("off");
+        x->smooth_euro[0] = filterSettings.minCutoff;
+        x->smooth_euro[1] = filterSettings.beta;
+        x->smooth_euro[2] = filterSettings.derivativeCutoff;
+        x->smooth_kalman[0] = filterSettings.acceleration;
+        x->smooth_kalman[1] = filterSettings.noise;
+        x->filter = new FrameFilter;
+        
+        // prepare prediction
+        PredictSettings predictSettings;
+        x->predict = predictSettings.horizon;
+        x->predict_damping = predictSettings.damping;
+        x->predictor = new FramePredictor;
+        x->processed = new FrameSnapshot;
+        x->circles = new GestureProgressCache;
+        
+        // prepare trajectories
+        x->history = 0;
+        x->trajectories = new TrajectoryStore;
+        
+        // prepare signal output
+        x->signal_hand = gensym("first");
+        x->signal_hand_mode = kSignalHandFirst;
+        x->signal_timestamp = 0;
+        x->signal_ramp = new SignalRamp;
+        x->signal_samplerate = sys_getsr();
+        
+        for (long i = 0; i < LEAP_SIGNAL_MAX; i++)
+            x->signal_values[i] = 0;
+        
+        // prepare stats mode
+        x->stats = 0;
+        x->stats_window = 100;
+        x->bang_stats = new BangStats;
+        x->stats_fetched = 0;
+        x->stats_dropped = 0;
+        
+        for (long i = 0; i < kStatPhases; i++)
+            x->stats_phases[i] = 0;
+        
+        x->stats_names[kPhaseFetch] = gensym("fetch");
+        x->stats_names[kPhaseHands] = gensym("hands");
+        x->stats_names[kPhaseFingers] = gensym("fingers");
+        x->stats_names[kPhaseTools] = gensym("tools");
+        x->stats_names[kPhaseGestures] = gensym("gestures");
+        x->stats_names[kPhaseOutput] = gensym("output");
+        x->stats_names[kPhaseAge] = gensym("age");
+        x->stats_names[kStatPhases] = gensym("duplicates");
+        x->stats_names[kStatPhases + 1] = gensym("dropped");
+        
+        // prepare recording
+        x->recorder = NULL;
+        
+        // prepare replay
+        x->replay = new ReplaySource;
+        x->synthetic = new SyntheticSource;
+        x->source = NULL;
+        x->replay_snapshot = new FrameSnapshot;
+        x->replay_clock = clock_new(x, (method)leapmotion_replay_tick);
+        critical_new(&x->lock);
+        x->replay_origin = 0;
+        x->replay_origin_ts = 0;
+        x->replay_last_ts = 0;
+        x->replay_period = 0;
+        x->replay_speed = 1.;
+        x->replay_loop = 0;
+        
+        attr_args_process(x, args.size(), args.empty() ? NULL : &args[0]);
+    }
+    
+    return x;
+}
+
+void leapmotion_free(t_leapmotion *x)
+{
+    // stop the audio and the Leap thread from calling us before anything is released
+    if (x->signal_count)
+        z_dsp_free((t_pxobject*)x);
+    
+    if (x->push)
+        x->leap->removeListener(*x->listener);
+    
+    clock_unset(x->push_clock);
+    object_free(x->push_clock);
+    delete x->listener;
+    delete [] x->catchup_frames;
+    delete x->packed;
+    
+    if (x->matrix)
+        jit_object_free(x->matrix);
+    
+    if (x->bone_matrix)
+        jit_object_free(x->bone_matrix);
+    
+    if (x->bones || x->joints)
+        leapmotion_shared_bones(x, false);
+    
+    delete x->joint_solver;
+    delete x->filter;
+    delete x->predictor;
+    delete x->processed;
+    delete x->circles;
+    delete x->trajectories;
+    
+    delete x->signal_ramp;
+    delete x->bang_stats;
+    delete x->recorder;
+    
+    clock_unset(x->replay_clock);
+    object_free(x->replay_clock);
+    critical_free(x->lock);
+    delete x->replay;
+    delete x->synthetic;
+    delete x->replay_snapshot;
+    
+    leapmotion_shared_release();
+}
+
+Leap::Controller *leapmotion_shared_retain()
+{
+    critical_enter(0);
+    
+    if (!leapmotion_shared)
+    {
+        leapmotion_shared = new t_leapmotion_shared;
+        leapmotion_shared->refcount = 0;
+        leapmotion_shared->bones = 0;
+        
         // create a controller
-        x->leap = new Leap::Controller;
+        Leap::Controller *leap = new Leap::Controller;
         
         // allow the external to receive data even if it is not the foreground application
-        x->leap->setPolicy(Leap::Controller::PolicyFlag::POLICY_BACKGROUND_FRAMES);
+        leap->setPolicy(Leap::Controller::PolicyFlag::POLICY_BACKGROUND_FRAMES);
         
         // Allow gesture recognition
-        x->leap->enableGesture(Leap::Gesture::TYPE_CIRCLE);
-        x->leap->enableGesture(Leap::Gesture::TYPE_SWIPE);
-        x->leap->enableGesture(Leap::Gesture::TYPE_KEY_TAP);
-        x->leap->enableGesture(Leap::Gesture::TYPE_SCREEN_TAP);
+        leap->enableGesture(Leap::Gesture::TYPE_CIRCLE);
+        leap->enableGesture(Leap::Gesture::TYPE_SWIPE);
+        leap->enableGesture(Leap::Gesture::TYPE_KEY_TAP);
+        leap->enableGesture(Leap::Gesture::TYPE_SCREEN_TAP);
+        
+        leapmotion_shared->controller = leap;
     }
     
-    return x;
+    leapmotion_shared->refcount++;
+    Leap::Controller *leap = leapmotion_shared->controller;
+    
+    critical_exit(0);
+    return leap;
 }
 
-void leapmotion_free(t_leapmotion *x)
+void leapmotion_shared_release()
+{
+    critical_enter(0);
+    
+    if (leapmotion_shared && --leapmotion_shared->refcount == 0)
+    {
+        delete leapmotion_shared->controller;
+        delete leapmotion_shared;
+        leapmotion_shared = NULL;
+    }
+    
+    critical_exit(0);
+}
+
+const FrameSnapshot *leapmotion_shared_frame(const Leap::Frame &frame, double *phases)
+{
+    // the first instance asking for a frame extracts it, the others reuse it.
+    // the returned entry stays valid until LEAP_FRAME_CACHE_SIZE newer frames have been extracted.
+    critical_enter(0);
+    
+    const int64_t frame_id = frame.id();
+    FrameSnapshot *snapshot = &leapmotion_shared->frames[frame_id & (LEAP_FRAME_CACHE_SIZE - 1)];
+    
+    // an instance turning bones on may get a few frames already extracted without them
+    if (snapshot->id != frame_id)
+        extractFrame(*snapshot, frame, NULL, phases, leapmotion_shared->bones > 0);
+    else if (phases)
+        phases[kPhaseHands] = phases[kPhaseFingers] = phases[kPhaseTools] = phases[kPhaseGestures] = 0;
+    
+    critical_exit(0);
+    return snapshot;
+}
+
+t_max_err leapmotion_attr_set_push(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        t_atom_long push = atom_getlong(argv) != 0;
+        
+        if (push == x->push)
+            return MAX_ERR_NONE;
+        
+        if (push)
+        {
+            // forget frames queued during a previous push session
+            x->listener->frames.clear();
+            x->leap->addListener(*x->listener);
+        }
+        else
+        {
+            x->leap->removeListener(*x->listener);
+            clock_unset(x->push_clock);
+        }
+        
+        x->push = push;
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_output(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        t_symbol *output = atom_getsym(argv);
+        
+        if (output == gensym("lists"))
+            x->output_mode = output_lists;
+        else if (output == gensym("packed"))
+            x->output_mode = output_packed;
+        else if (output == gensym("matrix"))
+        {
+            if (!x->matrix)
+                x->matrix = leapmotion_matrix_new(x, LEAP_MATRIX_PLANES, &x->matrix_name);
+            
+            // the bone matrix is needed as soon as bones and matrix output are both on
+            if (x->bones && !x->bone_matrix)
+                x->bone_matrix = leapmotion_matrix_new(x, LEAP_BONE_PLANES, &x->bone_matrix_name);
+            
+            if (!x->matrix || (x->bones && !x->bone_matrix))
+            {
+                object_error((t_object*)x, "output : can't create the matrix");
+                return MAX_ERR_GENERIC;
+            }
+            
+            x->output_mode = output_matrix;
+        }
+        else
+        {
+            object_error((t_object*)x, "output : %s is not lists, packed or matrix", output->s_name);
+            return MAX_ERR_GENERIC;
+        }
+        
+        x->output = output;
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_bones(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        t_atom_long bones = atom_getlong(argv) != 0;
+        
+        if (bones == x->bones)
+            return MAX_ERR_NONE;
+        
+        if (bones && x->output_mode == output_matrix && !x->bone_matrix)
+        {
+            x->bone_matrix = leapmotion_matrix_new(x, LEAP_BONE_PLANES, &x->bone_matrix_name);
+            
+            if (!x->bone_matrix)
+            {
+                object_error((t_object*)x, "bones : can't create the matrix");
+                return MAX_ERR_GENERIC;
+            }
+        }
+        
+        if (!x->joints)
+            leapmotion_shared_bones(x, bones);
+        
+        x->bones = bones;
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_joints(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        t_atom_long joints = atom_getlong(argv) != 0;
+        
+        if (joints == x->joints)
+            return MAX_ERR_NONE;
+        
+        // joints are solved from the bones
+        if (!x->bones)
+            leapmotion_shared_bones(x, joints);
+        
+        x->joints = joints;
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_smooth(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        t_symbol *smooth = atom_getsym(argv);
+        
+        if (smooth != gensym("off") && smooth != gensym("euro") && smooth != gensym("kalman"))
+        {
+            object_error((t_object*)x, "smooth : %s is not off, euro or kalman", smooth->s_name);
+            return MAX_ERR_GENERIC;
+        }
+        
+        x->smooth = smooth;
+        leapmotion_smooth_setup(x);
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_smooth_euro(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        for (long i = 0; i < argc && i < 3; i++)
+            x->smooth_euro[i] = atom_getfloat(argv + i) > 0. ? atom_getfloat(argv + i) : 0.;
+        
+        leapmotion_smooth_setup(x);
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_smooth_kalman(t_leapmotion *x, void *attr, long argc, t_atom *argv)
 {
-	delete (Leap::Controller *)(x->leap);
+    if (argc && argv)
+    {
+        for (long i = 0; i < argc && i < 2; i++)
+            x->smooth_kalman[i] = atom_getfloat(argv + i) > 0. ? atom_getfloat(argv + i) : 0.;
+        
+        leapmotion_smooth_setup(x);
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+void leapmotion_smooth_setup(t_leapmotion *x)
+{
+    FilterSettings settings;
+    
+    if (x->smooth == gensym("euro"))
+        settings.mode = kFilterOneEuro;
+    else if (x->smooth == gensym("kalman"))
+        settings.mode = kFilterKalman;
+    
+    settings.minCutoff = x->smooth_euro[0];
+    settings.beta = x->smooth_euro[1];
+    settings.derivativeCutoff = x->smooth_euro[2];
+    settings.acceleration = x->smooth_kalman[0];
+    settings.noise = x->smooth_kalman[1];
+    
+    critical_enter(x->lock);
+    x->filter->setup(settings);
+    critical_exit(x->lock);
+}
+
+t_max_err leapmotion_attr_set_predict(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        critical_enter(x->lock);
+        PredictSettings settings = x->predictor->settings();
+        
+        x->predict = atom_getfloat(argv);
+        settings.horizon = x->predict;
+        x->predictor->setup(settings);
+        critical_exit(x->lock);
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_predict_damping(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        critical_enter(x->lock);
+        PredictSettings settings = x->predictor->settings();
+        
+        x->predict_damping = atom_getfloat(argv);
+        settings.damping = x->predict_damping;
+        x->predictor->setup(settings);
+        critical_exit(x->lock);
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_history(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        // the rings are allocated here rather than while outputting frames,
+        // outside the lock : the new store is swapped in under it
+        const t_atom_long history = atom_getlong(argv);
+        
+        if (history == x->history)
+            return MAX_ERR_NONE;
+        
+        TrajectoryStore *trajectories = new TrajectoryStore;
+        trajectories->setup(history);
+        
+        critical_enter(x->lock);
+        std::swap(x->trajectories, trajectories);
+        x->history = history;
+        critical_exit(x->lock);
+        
+        delete trajectories;
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+void leapmotion_shared_bones(t_leapmotion *x, bool needed)
+{
+    // frames are extracted with bones while at least one instance needs them
+    critical_enter(0);
+    leapmotion_shared->bones += needed ? 1 : -1;
+    critical_exit(0);
+}
+
+void *leapmotion_matrix_new(t_leapmotion *x, long planes, t_symbol **name)
+{
+    // a matrix is allocated once and only resized when the number of rows changes
+    t_jit_matrix_info info;
+    
+    jit_matrix_info_default(&info);
+    info.type = _jit_sym_float32;
+    info.planecount = planes;
+    info.dimcount = 1;
+    info.dim[0] = 1;
+    
+    void *matrix = jit_object_new(_jit_sym_jit_matrix, &info);
+    
+    if (!matrix)
+        return NULL;
+    
+    *name = jit_symbol_unique();
+    return jit_object_register(matrix, *name);
+}
+
+t_max_err leapmotion_attr_set_signal_hand(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        t_symbol *hand = atom_getsym(argv);
+        
+        if (hand == gensym("first"))
+            x->signal_hand_mode = kSignalHandFirst;
+        else if (hand == gensym("left"))
+            x->signal_hand_mode = kSignalHandLeft;
+        else if (hand == gensym("right"))
+            x->signal_hand_mode = kSignalHandRight;
+        else
+        {
+            object_error((t_object*)x, "signal_hand : %s is not first, left or right", hand->s_name);
+            return MAX_ERR_GENERIC;
+        }
+        
+        x->signal_hand = hand;
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_replay_speed(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        const double speed = atom_getfloat(argv);
+        
+        if (speed <= 0.)
+        {
+            object_error((t_object*)x, "replay_speed : %f is not a positive speed", speed);
+            return MAX_ERR_GENERIC;
+        }
+        
+        critical_enter(x->lock);
+        
+        // keep the replay position : the frames still to come are scheduled at the new speed
+        if (x->source)
+        {
+            double now;
+            clock_getftime(&now);
+            
+            x->replay_origin_ts += (now - x->replay_origin) * 1000. * x->replay_speed;
+            x->replay_origin = now;
+        }
+        
+        x->replay_speed = speed;
+        
+        if (x->source)
+            clock_fdelay(x->replay_clock, 0.);
+        
+        critical_exit(x->lock);
+    }
+    
+    return MAX_ERR_NONE;
+}
+
+t_max_err leapmotion_attr_set_stats_window(t_leapmotion *x, void *attr, long argc, t_atom *argv)
+{
+    if (argc && argv)
+    {
+        // the new window is allocated outside the lock and swapped in under it
+        BangStats *stats = new BangStats;
+        stats->setWindow(atom_getlong(argv));
+        
+        critical_enter(x->lock);
+        std::swap(x->bang_stats, stats);
+        x->stats_window = x->bang_stats->window();
+        x->stats_dropped = x->dropped;
+        critical_exit(x->lock);
+        
+        delete stats;
+    }
+    
+    return MAX_ERR_NONE;
 }
 
 void leapmotion_assist(t_leapmotion *x, void *b, long msg, long arg, char *dst)
@@ -133,16 +982,29 @@ void leapmotion_assist(t_leapmotion *x, void *b, long msg, long arg, char *dst)
             strcpy(dst, "tools info");
             break;
 			case 3:
-            strcpy(dst, "fingers info");
+            strcpy(dst, "fingers info, trajectory id duration path speed acceleration min xyz max xyz");
             break;
             case 4:
-            strcpy(dst, "hands info");
+            strcpy(dst, "hands info, trajectory id duration path speed acceleration min xyz max xyz");
             break;
             case 5:
             strcpy(dst, "frames info");
             break;
             case 6:
             strcpy(dst, "start frame");
+            break;
+            case 7:
+            strcpy(dst, "frame matrix (output matrix mode, frame bangs, frame info and gestures stay lists)");
+            break;
+            case 8:
+            strcpy(dst, "stats : phase min mean p99 in ms, duplicates ratio, dropped count (stats mode)");
+            break;
+            case 9:
+            strcpy(dst, "bones : one skeleton list per hand or bone matrix (bones mode), joints hand id count w x y z ... (joints mode)");
+            break;
+            default:
+            if (arg - 10 < x->signal_count)
+                sprintf(dst, "(signal) %s", signalChannelName(x->signal_channels[arg - 10]));
             break;
 		}
  	}
@@ -150,369 +1012,669 @@ void leapmotion_assist(t_leapmotion *x, void *b, long msg, long arg, char *dst)
 
 void leapmotion_bang(t_leapmotion *x)
 {
-    // theo : create a j_sym_list symbol here because the _sym_list crashes
-    t_symbol *j_sym_list = gensym("list");
+    // a running source stands in for the device : it outputs on its own schedule
+    if (x->source)
+        return;
     
-	const Leap::Frame frame = x->leap->frame();
-	const int64_t frame_id = frame.id();
-	
-	// ignore the same frame
-	if (frame_id == x->frame_id_save) return;
-	x->frame_id_save = frame_id;
-	
-    /// output start frame bang /////////////////////////////////////////////
-    outlet_bang(x->outlets[start_frame_out]);
+    // in push mode a bang only flushes what the listener already queued
+    // (by the drain clock : the ring is never popped from two threads)
+    if (x->push)
+    {
+        clock_delay(x->push_clock, 0);
+        return;
+    }
     
+    if (x->stats)
+    {
+        const int64_t start = statClock();
+        const Leap::Frame frame = x->leap->frame();
+        
+        x->stats_fetched = statClock();
+        x->stats_phases[kPhaseFetch] = (x->stats_fetched - start) * 0.001;
+        leapmotion_output_frame(x, frame);
+        return;
+    }
     
-    /// output frame info ///////////////////////////////////////////////////
-	const Leap::HandList hands = frame.hands();
-	const size_t numHands = hands.count();
-	const Leap::ToolList tools = frame.tools();
-	const size_t numTools = tools.count();
-    const Leap::GestureList gestures = frame.gestures();
-	const size_t numGestures = gestures.count();
-	
-	t_atom frame_data[5];
-	atom_setlong(frame_data, frame_id);
-	atom_setlong(frame_data+1, frame.timestamp());
-	atom_setlong(frame_data+2, numHands);
-	atom_setlong(frame_data+3, numTools);
-    atom_setlong(frame_data+4, numGestures);
-	outlet_anything(x->outlets[frame_out], j_sym_list, 5, frame_data);
+    leapmotion_output_frame(x, x->leap->frame());
+}
+
+void leapmotion_record(t_leapmotion *x, t_symbol *s, long argc, t_atom *argv)
+{
+    // record <file> starts a new recording, record alone stops it
+    // (the recorder itself waits for a frame being pushed by the output thread before closing or opening)
+    if (x->recorder && x->recorder->isOpen())
+    {
+        if (!x->recorder->close())
+            object_error((t_object*)x, "record : the file could not be written entirely (disk full ?), it has no index");
+        
+        object_post((t_object*)x, "record : %llu frames recorded, %llu dropped",
+                    (unsigned long long)x->recorder->recorded(), (unsigned long long)x->recorder->dropped());
+    }
     
-	
-    /// output hand info ////////////////////////////////////////////////////
-	for (size_t i = 0; i < numHands; i++)
-	{
-        const Leap::Hand &hand = hands[i];
-        t_atom hand_data[20];
-		
-        // id
-		const int32_t hand_id = hand.id();
-        
-        atom_setlong(hand_data+0, hand_id);
-        
-        // palm position
-        const Leap::Vector position = hand.palmPosition();
-        const Leap::Vector direction = hand.direction();
-        
-        atom_setfloat(hand_data+1, position.x);
-        atom_setfloat(hand_data+2, position.y);
-        atom_setfloat(hand_data+3, position.z);
-        atom_setfloat(hand_data+4, direction.x);
-        atom_setfloat(hand_data+5, direction.y);
-        atom_setfloat(hand_data+6, direction.z);
-        
-        // palm velocity
-        const Leap::Vector velocity = hand.palmVelocity();
-        
-        atom_setfloat(hand_data+7, velocity.x);
-        atom_setfloat(hand_data+8, velocity.y);
-        atom_setfloat(hand_data+9, velocity.z);
-        
-        // palm normal
-        const Leap::Vector normal = hand.palmNormal();
-        
-        atom_setfloat(hand_data+10, normal.x);
-        atom_setfloat(hand_data+11, normal.y);
-        atom_setfloat(hand_data+12, normal.z);
-        
-        // ball
-        const Leap::Vector sphereCenter = hand.sphereCenter();
-        const double sphereRadius = hand.sphereRadius();
-        
-        atom_setfloat(hand_data+13, sphereCenter.x);
-        atom_setfloat(hand_data+14, sphereCenter.y);
-        atom_setfloat(hand_data+15, sphereCenter.z);
-        atom_setfloat(hand_data+16, sphereRadius);
-        
-        // misc
-        const double pinch = hand.pinchStrength();
-		const double grab = hand.grabStrength();
-		const bool isLeft = hand.isLeft();
-        
-		atom_setfloat(hand_data+17, pinch);
-		atom_setfloat(hand_data+18, grab);
-		atom_setlong(hand_data+19, isLeft);
-		
-        outlet_anything(x->outlets[hand_out], j_sym_list, 20, hand_data);
-        
-        
-        /// output finger info //////////////////////////////////////////////
-		const Leap::FingerList &fingers = hand.fingers();
-		const size_t numFingers = fingers.count();
-		
-		for (size_t j = 0; j < numFingers; j++)
-		{
-            const Leap::Finger &finger = fingers[j];
-            t_atom finger_data[15];
-            
-			// ids
-			const int32_t finger_id = finger.id();
-            
-            atom_setlong(finger_data+0, finger_id);
-			atom_setlong(finger_data+1, hand_id);
-            
-            // position
-			const Leap::Vector position = finger.tipPosition();
-			
-			atom_setfloat(finger_data+2, position.x);
-			atom_setfloat(finger_data+3, position.y);
-			atom_setfloat(finger_data+4, position.z);
-            
-            // direction
-            const Leap::Vector direction = finger.direction();
-            
-			atom_setfloat(finger_data+5, direction.x);
-			atom_setfloat(finger_data+6, direction.y);
-			atom_setfloat(finger_data+7, direction.z);
-            
-            // velocity
-            const Leap::Vector velocity = finger.tipVelocity();
-            
-			atom_setfloat(finger_data+8, velocity.x);
-			atom_setfloat(finger_data+9, velocity.y);
-			atom_setfloat(finger_data+10, velocity.z);
-            
-            // width and length
-            const double width = finger.width();
-			const double lenght = finger.length();
-            
-			atom_setfloat(finger_data+11, width);
-			atom_setfloat(finger_data+12, lenght);
-            
-            // misc
-			const bool isExtended = finger.isExtended();
-			const int32_t type = finger.type();
-            
-			atom_setlong(finger_data+13, isExtended);
-			atom_setlong(finger_data+14, type);
-			
-			outlet_anything(x->outlets[finger_out], j_sym_list, 15, finger_data);
-		}
-	}
+    if (!argc || atom_gettype(argv) != A_SYM)
+        return;
     
-    /// output tool info ///////////////////////////////////////////////////
-    for (size_t i = 0; i < numTools; i++)
-	{
-        const Leap::Tool &tool = tools[i];
-        t_atom tool_data[13];
+    char path[MAX_PATH_CHARS];
+    path_nameconform(atom_getsym(argv)->s_name, path, PATH_STYLE_NATIVE, PATH_TYPE_ABSOLUTE);
+    
+    // the output thread only sees the recorder with the lock held
+    if (!x->recorder)
+    {
+        FrameRecorder *recorder = new FrameRecorder;
         
-        // id
-        const int32_t tool_id = tool.id();
+        critical_enter(x->lock);
+        x->recorder = recorder;
+        critical_exit(x->lock);
+    }
+    
+    if (!x->recorder->open(path))
+        object_error((t_object*)x, "record : can't open %s", path);
+}
+
+void leapmotion_replay(t_leapmotion *x, t_symbol *s, long argc, t_atom *argv)
+{
+    // replay <file> outputs the frames of a recorded file, replay alone stops it
+    const bool play = argc && atom_gettype(argv) == A_SYM;
+    char path[MAX_PATH_CHARS];
+    
+    if (play)
+        path_nameconform(atom_getsym(argv)->s_name, path, PATH_STYLE_NATIVE, PATH_TYPE_ABSOLUTE);
+    
+    // the file is only closed once the clock can't be reading it
+    critical_enter(x->lock);
+    
+    leapmotion_source_stop(x);
+    x->replay->replay().close();
+    
+    const bool opened = play && x->replay->replay().open(path);
+    
+    if (opened)
+        leapmotion_source_start(x, x->replay);
+    
+    critical_exit(x->lock);
+    
+    if (play && !opened)
+        object_error((t_object*)x, "replay : can't read %s", path);
+}
+
+void leapmotion_synthetic(t_leapmotion *x, t_symbol *s, long argc, t_atom *argv)
+{
+    // synthetic <hands> <fingers> <tools> <gestures> <rate> <noise> <dropout> outputs generated frames
+    // (missing arguments keep their default), synthetic alone stops it
+    SyntheticSettings settings;
+    
+    if (argc > 0) settings.hands = atom_getlong(argv+0);
+    if (argc > 1) settings.fingers = atom_getlong(argv+1);
+    if (argc > 2) settings.tools = atom_getlong(argv+2);
+    if (argc > 3) settings.gestures = atom_getlong(argv+3);
+    if (argc > 4) settings.rate = atom_getfloat(argv+4);
+    if (argc > 5) settings.noise = atom_getfloat(argv+5);
+    if (argc > 6) settings.dropout = atom_getfloat(argv+6);
+    
+    critical_enter(x->lock);
+    
+    leapmotion_source_stop(x);
+    
+    if (argc)
+    {
+        x->synthetic->setup(settings);
+        leapmotion_source_start(x, x->synthetic);
+    }
+    
+    critical_exit(x->lock);
+}
+
+void leapmotion_trajectory(t_leapmotion *x, t_symbol *s, long argc, t_atom *argv)
+{
+    // trajectory hand|finger <ms> reports every tracked one, trajectory hand|finger <id> <ms> only one
+    if (argc < 2 || atom_gettype(argv) != A_SYM)
+    {
+        object_error((t_object*)x, "trajectory : expects hand or finger, an optional id and a window in ms");
+        return;
+    }
+    
+    if (!x->history)
+    {
+        object_error((t_object*)x, "trajectory : no history is kept (see the history attribute)");
+        return;
+    }
+    
+    t_symbol *kind = atom_getsym(argv);
+    bool hands;
+    void *outlet;
+    
+    if (kind == gensym("hand"))
+    {
+        hands = true;
+        outlet = x->outlets[hand_out];
+    }
+    else if (kind == gensym("finger"))
+    {
+        hands = false;
+        outlet = x->outlets[finger_out];
+    }
+    else
+    {
+        object_error((t_object*)x, "trajectory : %s is not hand or finger", kind->s_name);
+        return;
+    }
+    
+    const double window = atom_getfloat(argv + argc - 1);
+    TrajectoryStats stats;
+    t_atom atoms[LEAP_TRAJECTORY_ATOMS];
+    
+    // the rings are pushed by the thread outputting frames (and replaced by the history attribute) :
+    // they are only read with the lock held and the stats are output once it is released.
+    // an id that is not tracked (any more) reports nothing
+    if (argc > 2)
+    {
+        const int32_t id = (int32_t)atom_getlong(argv + 1);
         
-        atom_setlong(tool_data+0, tool_id);
+        critical_enter(x->lock);
+        const TrajectoryBank &bank = hands ? x->trajectories->hands() : x->trajectories->fingers();
+        const bool tracked = bank.query(id, window, stats);
+        critical_exit(x->lock);
         
-        // position
-        const Leap::Vector position = tool.tipPosition();
+        if (tracked)
+            outlet_anything(outlet, x->stateNames[kSymbolTrajectory], encodeTrajectory(id, stats, atoms), atoms);
         
-        atom_setfloat(tool_data+1, position.x);
-        atom_setfloat(tool_data+2, position.y);
-        atom_setfloat(tool_data+3, position.z);
+        return;
+    }
+    
+    for (uint32_t slot = 0; ; slot++)
+    {
+        critical_enter(x->lock);
+        const TrajectoryBank &bank = hands ? x->trajectories->hands() : x->trajectories->fingers();
         
-        // direction
-        const Leap::Vector direction = tool.direction();
+        if (slot >= bank.capacity())
+        {
+            critical_exit(x->lock);
+            break;
+        }
         
-        atom_setfloat(tool_data+4, direction.x);
-        atom_setfloat(tool_data+5, direction.y);
-        atom_setfloat(tool_data+6, direction.z);
+        const int32_t id = bank.id(slot);
         
-        // velocity
-        const Leap::Vector velocity = tool.tipVelocity();
+        if (id != SlotPool::kFreeSlot)
+            bank.queryStats(slot, window, stats);
         
-        atom_setfloat(tool_data+7, velocity.x);
-        atom_setfloat(tool_data+8, velocity.y);
-        atom_setfloat(tool_data+9, velocity.z);
+        critical_exit(x->lock);
         
-        // width and length
-        const double width = tool.width();
-        const double lenght = tool.length();
+        if (id != SlotPool::kFreeSlot)
+            outlet_anything(outlet, x->stateNames[kSymbolTrajectory], encodeTrajectory(id, stats, atoms), atoms);
+    }
+}
+
+// source_start and source_stop are called with the lock held
+void leapmotion_source_start(t_leapmotion *x, FrameSource *source)
+{
+    x->source = source;
+    x->replay_last_ts = 0;
+    x->replay_period = 0;
+    leapmotion_replay_rebase(x);
+    clock_fdelay(x->replay_clock, 0.);
+    
+    // the objects of the source have nothing to do with the ones being filtered or predicted
+    x->filter->reset();
+    x->predictor->reset();
+    x->circles->reset();
+    x->trajectories->reset();
+}
+
+void leapmotion_source_stop(t_leapmotion *x)
+{
+    clock_unset(x->replay_clock);
+    
+    if (!x->source)
+        return;
+    
+    x->source = NULL;
+    
+    // the live frame ids and objects have nothing to do with the scheduled source ones
+    x->frame_id_save = 0;
+    x->filter->reset();
+    x->predictor->reset();
+    x->circles->reset();
+    x->trajectories->reset();
+}
+
+void leapmotion_seek(t_leapmotion *x, double ms)
+{
+    // ms from the first frame of the file
+    critical_enter(x->lock);
+    
+    if (x->source == x->replay)
+    {
+        x->replay->replay().seekTime(x->replay->replay().firstTimestamp() + (int64_t)(ms * 1000.));
+        leapmotion_replay_rebase(x);
+        clock_fdelay(x->replay_clock, 0.);
+    }
+    
+    critical_exit(x->lock);
+}
+
+void leapmotion_seek_frame(t_leapmotion *x, t_atom_long id)
+{
+    critical_enter(x->lock);
+    
+    if (x->source == x->replay)
+    {
+        x->replay->replay().seekFrame(id);
+        leapmotion_replay_rebase(x);
+        clock_fdelay(x->replay_clock, 0.);
+    }
+    
+    critical_exit(x->lock);
+}
+
+void leapmotion_replay_rebase(t_leapmotion *x)
+{
+    // the next frame of the source is due now
+    int64_t timestamp;
+    
+    if (!x->source->nextTimestamp(timestamp))
+        timestamp = x->replay_last_ts;
+    
+    clock_getftime(&x->replay_origin);
+    x->replay_origin_ts = timestamp;
+}
+
+void leapmotion_replay_tick(t_leapmotion *x)
+{
+    double now;
+    clock_getftime(&now);
+    
+    // the source is read and its frame processed with the lock held (a source stopped meanwhile
+    // resets the filters after this frame, not before it) but the frames are output without it
+    while (true)
+    {
+        const int64_t start = x->stats ? statClock() : 0;
         
-        atom_setfloat(tool_data+10, width);
-        atom_setfloat(tool_data+11, lenght);
+        critical_enter(x->lock);
+        const FrameSnapshot *output = leapmotion_replay_read(x, now) ? leapmotion_process_snapshot(x, *x->replay_snapshot) : NULL;
+        critical_exit(x->lock);
         
-        // misc
-        const bool isExtended = tool.isExtended();
+        if (!output)
+            return;
         
-        atom_setlong(tool_data+12, isExtended);
+        leapmotion_output_snapshot(x, *output, *x->replay_snapshot, start);
+    }
+}
+
+bool leapmotion_replay_read(t_leapmotion *x, double now)
+{
+    // read the next frame of the source into replay_snapshot if it is due, else schedule the clock for it
+    int64_t timestamp;
+    
+    if (!x->source)
+        return false;
+    
+    if (!x->source->nextTimestamp(timestamp))
+    {
+        if (!x->replay_loop)
+            return false;
+        
+        // the first frame comes one frame period after the last one
+        // (it is output by the next tick : a source wraps at most once per tick)
+        x->source->rewind();
         
-        outlet_anything(x->outlets[tool_out], j_sym_list, 13, tool_data);
+        if (!x->source->nextTimestamp(timestamp))
+            return false;
+        
+        const double delay = (x->replay_period ? x->replay_period : LEAP_REPLAY_PERIOD) * 0.001 / x->replay_speed;
+        
+        x->replay_origin = now + delay;
+        x->replay_origin_ts = timestamp;
+        clock_fdelay(x->replay_clock, delay);
+        return false;
     }
     
-    /// output gesture info ////////////////////////////////////////////////
-    for (size_t i = 0; i < numGestures; i++)
-	{
-        const Leap::Gesture &gesture = gestures[i];
-       
-        // depending on the type of the gesture
-        switch (gesture.type()) {
-            
-            /// output circle info ////////////////////////////////////////////////
-            case Leap::Gesture::TYPE_CIRCLE:
-            {
-                Leap::CircleGesture circle = gesture;
-                
-                t_atom circle_data[8];
-                
-                // type (as first data for routing)
-                atom_setsym(circle_data+0, gensym("circle"));
-                
-                // id
-                const int32_t circle_id = gesture.id();
-                
-                atom_setlong(circle_data+1, circle_id);
-                
-                // state
-                const int32_t circle_state = gesture.state();
-                
-                atom_setsym(circle_data+2, x->stateNames[circle_state]);
-                
-                // progress
-                const double progress = circle.progress();
-                
-                atom_setfloat(circle_data+3, progress);
-                
-                // radius
-                const double radius = circle.radius();
-                
-                atom_setfloat(circle_data+4, radius);
-                
-                // angle swept since last frame
-                float sweptAngle = 0;
-                if (circle.state() != Leap::Gesture::STATE_START)
-                {
-                    Leap::CircleGesture previousUpdate = Leap::CircleGesture(x->leap->frame(1).gesture(circle.id()));
-                    sweptAngle = (circle.progress() - previousUpdate.progress()) * 2 * M_PI;
-                }
-                atom_setfloat(circle_data+5, sweptAngle);
-                
-                // clockwiseness
-                const bool clockwiseness = circle.pointable().direction().angleTo(circle.normal()) <= M_PI/2;
-                
-                atom_setlong(circle_data+6, clockwiseness ? 1 : 0);
-                
-                outlet_anything(x->outlets[gesture_out], j_sym_list, 7, circle_data);
-                break;
-            }
-                
-            /// output swipe info ////////////////////////////////////////////////
-            case Leap::Gesture::TYPE_SWIPE:
-            {
-                Leap::SwipeGesture swipe = gesture;
-                
-                t_atom swipe_data[7];
-                
-                // type (as first data for routing)
-                atom_setsym(swipe_data+0, gensym("swipe"));
-                
-                // id
-                const int32_t swipe_id = gesture.id();
-                
-                atom_setlong(swipe_data+1, swipe_id);
-                
-                // state
-                const int32_t swipe_state = gesture.state();
-                
-                atom_setsym(swipe_data+2, x->stateNames[swipe_state]);
-                
-                // direction
-                const Leap::Vector direction = swipe.direction();
-                
-                atom_setfloat(swipe_data+3, direction.x);
-                atom_setfloat(swipe_data+4, direction.y);
-                atom_setfloat(swipe_data+5, direction.z);
-                
-                // speed
-                const double speed = swipe.speed();
-                
-                atom_setfloat(swipe_data+6, speed);
-                
-                outlet_anything(x->outlets[gesture_out], j_sym_list, 7, swipe_data);
-                break;
-            }
-                
-            /// output key tap info ////////////////////////////////////////////////
-            case Leap::Gesture::TYPE_KEY_TAP:
-            {
-                Leap::KeyTapGesture key_tap = gesture;
-                
-                t_atom key_tap_data[9];
-                
-                // type (as first data for routing)
-                atom_setsym(key_tap_data+0, gensym("key_tap"));
-                
-                // id
-                const int32_t key_tap_id = gesture.id();
-                
-                atom_setlong(key_tap_data+1, key_tap_id);
-                
-                // state
-                const int32_t key_tap_state = gesture.state();
-                
-                atom_setsym(key_tap_data+2, x->stateNames[key_tap_state]);
-                
-                // position
-                const Leap::Vector position = key_tap.position();
-                
-                atom_setfloat(key_tap_data+3, position.x);
-                atom_setfloat(key_tap_data+4, position.y);
-                atom_setfloat(key_tap_data+5, position.z);
-                
-                // direction
-                const Leap::Vector direction = key_tap.direction();
-                
-                atom_setfloat(key_tap_data+6, direction.x);
-                atom_setfloat(key_tap_data+7, direction.y);
-                atom_setfloat(key_tap_data+8, direction.z);
-                
-                outlet_anything(x->outlets[gesture_out], j_sym_list, 9, key_tap_data);
-                break;
-            }
-                
-            /// output screen tap info ////////////////////////////////////////////////
-            case Leap::Gesture::TYPE_SCREEN_TAP:
-            {
-                Leap::ScreenTapGesture screen_tap = gesture;
-                
-                t_atom screen_tap_data[9];
-                
-                // type (as first data for routing)
-                atom_setsym(screen_tap_data+0, gensym("screen_tap"));
-                
-                // id
-                const int32_t screen_tap_id = gesture.id();
-                
-                atom_setlong(screen_tap_data+1, screen_tap_id);
-                
-                // state
-                const int32_t screen_tap_state = gesture.state();
-                
-                atom_setsym(screen_tap_data+2, x->stateNames[screen_tap_state]);
-                
-                // position
-                const Leap::Vector position = screen_tap.position();
-                
-                atom_setfloat(screen_tap_data+3, position.x);
-                atom_setfloat(screen_tap_data+4, position.y);
-                atom_setfloat(screen_tap_data+5, position.z);
-                
-                // direction
-                const Leap::Vector direction = screen_tap.direction();
-                
-                atom_setfloat(screen_tap_data+6, direction.x);
-                atom_setfloat(screen_tap_data+7, direction.y);
-                atom_setfloat(screen_tap_data+8, direction.z);
-                
-                outlet_anything(x->outlets[gesture_out], j_sym_list, 9, screen_tap_data);
-                
-                break;
-            }
-            default:
-                object_error((t_object*)x, "unknown gesture type");
-                break;
+    const double due = x->replay_origin + (timestamp - x->replay_origin_ts) * 0.001 / x->replay_speed;
+    
+    if (due > now)
+    {
+        clock_fdelay(x->replay_clock, due - now);
+        return false;
+    }
+    
+    // after a long scheduler stall the replay resumes from here instead of rushing the late frames out
+    if (now - due > LEAP_REPLAY_LATE_MS)
+    {
+        x->replay_origin = now;
+        x->replay_origin_ts = timestamp;
+    }
+    
+    const int64_t start = x->stats ? statClock() : 0;
+    
+    x->source->read(*x->replay_snapshot);
+    
+    if (x->stats)
+    {
+        x->stats_fetched = statClock();
+        x->stats_phases[kPhaseFetch] = (x->stats_fetched - start) * 0.001;
+        x->stats_phases[kPhaseHands] = x->stats_phases[kPhaseFingers] = 0;
+        x->stats_phases[kPhaseTools] = x->stats_phases[kPhaseGestures] = 0;
+    }
+    
+    if (x->replay_last_ts && timestamp > x->replay_last_ts)
+        x->replay_period = timestamp - x->replay_last_ts;
+    
+    x->replay_last_ts = timestamp;
+    return true;
+}
+
+void leapmotion_drain(t_leapmotion *x)
+{
+    // the frames the listener queued while a source runs are not output
+    if (x->source)
+    {
+        x->listener->frames.clear();
+        return;
+    }
+    
+    Leap::Frame frame;
+    int64_t start = x->stats ? statClock() : 0;
+    
+    while (x->listener->frames.pop(frame))
+    {
+        if (x->stats)
+        {
+            x->stats_fetched = statClock();
+            x->stats_phases[kPhaseFetch] = (x->stats_fetched - start) * 0.001;
         }
+        
+        leapmotion_output_frame(x, frame);
+        
+        if (x->stats)
+            start = statClock();
+    }
+}
+
+void leapmotion_output_frame(t_leapmotion *x, const Leap::Frame &frame)
+{
+	const int64_t frame_id = frame.id();
+    
+	if (x->stats)
+    {
+        critical_enter(x->lock);
+		x->bang_stats->addBang(frame_id == x->frame_id_save);
+        critical_exit(x->lock);
     }
 	
-     /// output end frame bang /////////////////////////////////////////////
-	outlet_bang(x->outlets[end_frame_out]);
-}
\ No newline at end of file
+	// ignore the same frame
+	if (frame_id == x->frame_id_save) return;
+    
+    // emit or count the frames skipped since the last output
+    // (ids restart when the service restarts so only forward gaps are considered)
+    if (x->frame_id_save && frame_id > x->frame_id_save + 1)
+    {
+        if (x->catchup)
+            leapmotion_catchup(x, frame);
+        
+        if (frame_id > x->frame_id_save + 1)
+            x->dropped += frame_id - x->frame_id_save - 1;
+    }
+    
+    leapmotion_emit(x, frame);
+}
+
+void leapmotion_catchup(t_leapmotion *x, const Leap::Frame &frame)
+{
+    const int64_t frame_id = frame.id();
+    const int64_t start = x->stats ? statClock() : 0;
+    int64_t oldest_id = frame_id;
+    long count = 0;
+    
+    // walk the history back (newest first) collecting frames between the last output and this frame.
+    // frames are kept as handles because the history may shift while we walk it.
+    for (long history = 1; history < LEAP_HISTORY_SIZE && count < x->catchup_max; history++)
+    {
+        const Leap::Frame past = x->leap->frame(history);
+        const int64_t past_id = past.id();
+        
+        if (!past.isValid() || past_id <= x->frame_id_save)
+            break;
+        
+        // newer than the frame to output (push mode) or seen twice because the history shifted
+        if (past_id >= oldest_id)
+            continue;
+        
+        x->catchup_frames[count++] = past;
+        oldest_id = past_id;
+    }
+    
+    // the frames older than the ones we collected are lost
+    if (count && oldest_id > x->frame_id_save + 1)
+        x->dropped += oldest_id - x->frame_id_save - 1;
+    
+    // walking the history is part of fetching the oldest frame
+    if (x->stats)
+        x->stats_phases[kPhaseFetch] += (statClock() - start) * 0.001;
+    
+    // output oldest first
+    while (count--)
+        leapmotion_emit(x, x->catchup_frames[count]);
+}
+
+void leapmotion_emit(t_leapmotion *x, const Leap::Frame &frame)
+{
+    leapmotion_emit_snapshot(x, *leapmotion_shared_frame(frame, x->stats ? x->stats_phases : NULL));
+}
+
+void leapmotion_emit_snapshot(t_leapmotion *x, const FrameSnapshot &snapshot)
+{
+    const int64_t start = x->stats ? statClock() : 0;
+    
+    critical_enter(x->lock);
+    const FrameSnapshot *output = leapmotion_process_snapshot(x, snapshot);
+    critical_exit(x->lock);
+    
+    leapmotion_output_snapshot(x, *output, snapshot, start);
+}
+
+const FrameSnapshot *leapmotion_process_snapshot(t_leapmotion *x, const FrameSnapshot &snapshot)
+{
+    // called with the lock held : the messages changing the filter, the predictor or the trajectories wait for it
+	x->frame_id_save = snapshot.id;
+    
+    // the shared snapshot is left as it is : smoothing, prediction and the angles swept by circles
+    // (since the frame this instance output before) work on a copy
+    const FrameSnapshot *output = &snapshot;
+    
+    if (x->filter->settings().mode != kFilterOff || x->predict > 0. || GestureProgressCache::hasCircles(snapshot.gestures))
+    {
+        x->processed->copy(snapshot);
+        x->filter->apply(*x->processed);
+        output = x->processed;
+    }
+    
+    if (output == x->processed)
+        x->circles->measure(x->processed->gestures);
+    else
+        x->circles->nextFrame();
+    
+    // the trajectories are the smoothed motion, not the predicted one
+    if (x->history)
+        x->trajectories->push(*output);
+    
+    if (output == x->processed)
+        x->predictor->apply(*x->processed);
+    
+    if (x->joints)
+        x->joint_solver->solve(*output);
+    
+    // the raw frames are recorded, so that a replay can be smoothed differently
+    if (x->recorder)
+        x->recorder->push(snapshot);
+    
+    return output;
+}
+
+void leapmotion_output_snapshot(t_leapmotion *x, const FrameSnapshot &output, const FrameSnapshot &snapshot, int64_t start)
+{
+    // output (the processed copy or the snapshot itself) is only written by the thread outputting frames
+    if (x->output_mode == output_packed)
+        leapmotion_emit_packed(x, output);
+    else if (x->output_mode == output_matrix)
+        leapmotion_emit_matrix(x, output);
+    else
+        leapmotion_emit_lists(x, output);
+    
+    if (x->signal_count)
+        leapmotion_emit_signals(x, output);
+    
+    if (x->stats)
+    {
+        x->stats_phases[kPhaseOutput] = (statClock() - start) * 0.001;
+        
+        critical_enter(x->lock);
+        x->stats_phases[kPhaseAge] = x->bang_stats->frameAge(snapshot.timestamp, x->stats_fetched);
+        const bool full = x->bang_stats->addFrame(x->stats_phases);
+        critical_exit(x->lock);
+        
+        if (full)
+            leapmotion_report_stats(x);
+        
+        // the next frames of a drain or a catch-up are not fetched again
+        x->stats_phases[kPhaseFetch] = 0;
+    }
+}
+
+void leapmotion_emit_lists(t_leapmotion *x, const FrameSnapshot &snapshot)
+{
+    outputLists(snapshot, x->stateNames, x->outlets, x->bones, x->joints ? &x->joint_solver->joints() : NULL);
+}
+
+void leapmotion_emit_packed(t_leapmotion *x, const FrameSnapshot &snapshot)
+{
+    outputPacked(snapshot, x->stateNames, *x->packed, x->outlets[frame_out]);
+    
+    if (x->bones)
+        outputBones(snapshot, x->stateNames, x->outlets[bone_out]);
+    
+    if (x->joints)
+        outputJoints(x->joint_solver->joints(), x->stateNames, x->outlets[bone_out]);
+}
+
+void leapmotion_emit_matrix(t_leapmotion *x, const FrameSnapshot &snapshot)
+{
+    // the matrices only have hand, finger, tool (and bone) rows : the frame bangs, the frame info
+    // and the gestures are still output as lists around them, as in lists mode
+    outputFrameStart(snapshot, x->stateNames, x->outlets);
+    
+    if (x->bones)
+        leapmotion_output_matrix(x, x->bone_matrix, x->bone_matrix_name, snapshot.bones.count(), snapshot,
+                                 encodeBoneMatrix, x->outlets[bone_out]);
+    
+    if (x->joints)
+        outputJoints(x->joint_solver->joints(), x->stateNames, x->outlets[bone_out]);
+    
+    leapmotion_output_matrix(x, x->matrix, x->matrix_name, matrixRows(snapshot), snapshot,
+                             encodeMatrix, x->outlets[matrix_out]);
+    
+    outputFrameEnd(snapshot, x->stateNames, x->outlets);
+}
+
+void leapmotion_output_matrix(t_leapmotion *x, void *matrix, t_symbol *name, long rows, const FrameSnapshot &snapshot,
+                              void (*encode)(const FrameSnapshot&, float*, long), void *outlet)
+{
+    t_jit_matrix_info info;
+    char *data = NULL;
+    t_atom atom;
+    
+    // a jit.matrix can't be empty : without any row, one cell whose first plane is -1 is output
+    void *savelock = jit_object_method(matrix, _jit_sym_lock, 1);
+    
+    jit_object_method(matrix, _jit_sym_getinfo, &info);
+    
+    if (info.dim[0] != (rows ? rows : 1))
+    {
+        info.dim[0] = rows ? rows : 1;
+        jit_object_method(matrix, _jit_sym_setinfo, &info);
+        jit_object_method(matrix, _jit_sym_getinfo, &info);
+    }
+    
+    jit_object_method(matrix, _jit_sym_getdata, &data);
+    
+    if (data)
+    {
+        if (rows)
+            encode(snapshot, (float*)data, info.dimstride[0] / sizeof(float));
+        else
+        {
+            memset(data, 0, info.dimstride[0]);
+            ((float*)data)[0] = -1;
+        }
+    }
+    
+    jit_object_method(matrix, _jit_sym_lock, savelock);
+    
+    atom_setsym(&atom, name);
+    outlet_anything(outlet, _jit_sym_jit_matrix, 1, &atom);
+}
+
+void leapmotion_report_stats(t_leapmotion *x)
+{
+    t_atom data[kStatPhases][3];
+    t_atom ratio, dropped;
+    double min, mean, p99;
+    
+    // the window is summarized with the lock held (the stats_window attribute may replace it) and output without it
+    critical_enter(x->lock);
+    
+    for (long p = 0; p < kStatPhases; p++)
+    {
+        x->bang_stats->summary(p, min, mean, p99);
+        atom_setfloat(data[p]+0, min);
+        atom_setfloat(data[p]+1, mean);
+        atom_setfloat(data[p]+2, p99);
+    }
+    
+    atom_setfloat(&ratio, x->bang_stats->duplicateRatio());
+    atom_setlong(&dropped, x->dropped - x->stats_dropped);
+    
+    x->bang_stats->reset();
+    x->stats_dropped = x->dropped;
+    
+    critical_exit(x->lock);
+    
+    for (long p = 0; p < kStatPhases; p++)
+        outlet_anything(x->outlets[stats_out], x->stats_names[p], 3, data[p]);
+    
+    outlet_anything(x->outlets[stats_out], x->stats_names[kStatPhases], 1, &ratio);
+    outlet_anything(x->outlets[stats_out], x->stats_names[kStatPhases + 1], 1, &dropped);
+}
+
+void leapmotion_emit_signals(t_leapmotion *x, const FrameSnapshot &snapshot)
+{
+    // when the hand is not tracked the signals hold their latest values
+    if (!sampleSignals(snapshot, x->signal_hand_mode, x->signal_channels, x->signal_count, x->signal_values))
+        return;
+    
+    // ramp over the time between this frame and the previous one (from 1 to 100 ms)
+    double duration = (snapshot.timestamp - x->signal_timestamp) * 0.000001;
+    
+    if (duration < 0.001)
+        duration = 0.001;
+    else if (duration > 0.1)
+        duration = 0.1;
+    
+    x->signal_timestamp = snapshot.timestamp;
+    x->signal_ramp->pushTarget(x->signal_values, x->signal_count, duration);
+}
+
+void leapmotion_dsp64(t_leapmotion *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
+{
+    x->signal_samplerate = samplerate;
+    
+    if (!x->signal_count)
+        return;
+    
+    // the targets queued while the audio was off would replay as stale ramps
+    x->signal_ramp->flush();
+    object_method(dsp64, gensym("dsp_add64"), x, leapmotion_perform64, 0, NULL);
+}
+
+void leapmotion_perform64(t_leapmotion *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+{
+    x->signal_ramp->process(outs, numouts, sampleframes, x->signal_samplerate);
+}
@@ -6,9 +6,17 @@
 * Leap Motion and you, your company or other organization.                     *
 \******************************************************************************/
 #include "LeapScene.h"
+#include <algorithm>
 #include <cfloat>
 #include <cstring>
 
+// the built in shapes are hit tested 4 at a time where SSE2 is available.
+// on other targets, or when LEAP_SCENE_NO_SSE is defined, every object is tested through its virtual methods.
+#if !defined(LEAP_SCENE_NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #include <emmintrin.h>
+  #define LEAP_SCENE_SSE
+#endif
+
 namespace Leap {
 
 using namespace LeapUtil;
@@ -17,6 +25,484 @@ using namespace LeapUtil;
   using namespace LeapUtilGL;
 #endif
 
+//***********************
+//
+// bounds helpers
+//
+//***********************
+
+/// the bounds of an object, padded so that rounding errors never put a hit reported
+/// by the object outside of them.
+static bool getPaddedBounds( const SceneObject& object, SceneBounds& boundsOut )
+{
+  if ( !object.GetBounds( boundsOut ) )
+  {
+    return false;
+  }
+
+  const float   fPad  = kfEpsilon * (1.0f + MaxComponent(ComponentWiseMax(-boundsOut.m_vMin, boundsOut.m_vMax)));
+  const Vector  vPad( fPad, fPad, fPad );
+
+  boundsOut.m_vMin -= vPad;
+  boundsOut.m_vMax += vPad;
+
+  return true;
+}
+
+/// slab test of a ray against bounds, up to fMaxDist along the ray.
+/// fEnterDistOut is the distance at which the ray enters the bounds (0 if it starts inside),
+/// *pfExitDistOut the distance at which it leaves them (at most fMaxDist).
+static bool rayHitsBounds( const SceneRay& ray, const Vector& vInvDirection, const SceneBounds& bounds,
+                           float fMaxDist, float& fEnterDistOut, float* pfExitDistOut = NULL )
+{
+  float fEnter  = 0.0f;
+  float fExit   = fMaxDist;
+
+  for ( unsigned int i = 0; i < 3; i++ )
+  {
+    const float fOrigin = ray.m_vOrigin[i];
+
+    // parallel to the slab - in or out for good.
+    if ( ray.m_vDirection[i] == 0.0f )
+    {
+      if ( fOrigin < bounds.m_vMin[i] || fOrigin > bounds.m_vMax[i] )
+      {
+        return false;
+      }
+
+      continue;
+    }
+
+    float fNear = (bounds.m_vMin[i] - fOrigin) * vInvDirection[i];
+    float fFar  = (bounds.m_vMax[i] - fOrigin) * vInvDirection[i];
+
+    if ( fNear > fFar )
+    {
+      std::swap( fNear, fFar );
+    }
+
+    fEnter  = std::max( fEnter, fNear );
+    fExit   = std::min( fExit, fFar );
+
+    if ( fEnter > fExit )
+    {
+      return false;
+    }
+  }
+
+  fEnterDistOut = fEnter;
+
+  if ( pfExitDistOut )
+  {
+    *pfExitDistOut = fExit;
+  }
+
+  return true;
+}
+
+/// extent along a scene axis of a disk whose normal has the component fNormal along that axis
+static float diskExtent( float fRadius, float fNormal )
+{
+  return fRadius * sqrtf( std::max(0.0f, 1.0f - fNormal*fNormal) );
+}
+
+/// cell of a coordinate in the spatial hash.
+/// clamped so that objects far away do not overflow the cell coordinates - they only share cells.
+static inline int32_t gridCoord( float fCoord, float fInvCellSize )
+{
+  static const float kfGridMaxCoord = static_cast<float>(1 << 24);
+
+  const float   fCell = LeapUtil::Clamp( fCoord * fInvCellSize, -kfGridMaxCoord, kfGridMaxCoord );
+  const int32_t iCell = static_cast<int32_t>( fCell );
+
+  // rounds down like floorf() without the call
+  return (fCell < static_cast<float>(iCell)) ? iCell - 1 : iCell;
+}
+
+/// orders object indices by the center of their bounds along an axis
+struct BoundsCenterLess
+{
+  BoundsCenterLess( const SceneBounds* pBounds, unsigned int uiAxis ) : m_pBounds( pBounds ), m_uiAxis( uiAxis ) {}
+
+  bool operator()( uint32_t a, uint32_t b ) const
+  {
+    return  m_pBounds[a].m_vMin[m_uiAxis] + m_pBounds[a].m_vMax[m_uiAxis] <
+            m_pBounds[b].m_vMin[m_uiAxis] + m_pBounds[b].m_vMax[m_uiAxis];
+  }
+
+  const SceneBounds*  m_pBounds;
+  unsigned int        m_uiAxis;
+};
+
+//***********************
+//
+// batched shape kernels
+//
+//***********************
+
+/// how the objects of a leaf are hit tested.
+/// the built in shapes are kept in scene space in blocks of 4 lanes and tested together,
+/// any other object (e.g. a user defined subclass) through its virtual methods.
+enum eShapeKernel
+{
+  kSK_Virtual,
+  kSK_Box,
+  kSK_Sphere,
+  kSK_Cylinder,
+  kSK_Disk,
+  kSK_Plane
+};
+
+/// channels of a block of lanes, each a run of 4 floats
+enum eShapeChannel
+{
+  kSC_CenterX, kSC_CenterY, kSC_CenterZ,
+  kSC_XBasisX, kSC_XBasisY, kSC_XBasisZ,
+  kSC_YBasisX, kSC_YBasisY, kSC_YBasisZ,      // axis of a cylinder
+  kSC_ZBasisX, kSC_ZBasisY, kSC_ZBasisZ,      // normal of a disk or a plane
+  kSC_HalfSizeX, kSC_HalfSizeY, kSC_HalfSizeZ,  // scaled half size of a box
+  kSC_Radius,                                 // scaled radius of a sphere, a cylinder or a disk
+  kSC_HalfHeight,                             // scaled half height of a cylinder
+  kShapeChannels
+};
+
+static uint32_t shapeKernel( const SceneObject& object )
+{
+#if defined(LEAP_SCENE_SSE)
+  // exact types only - a subclass may override the hit tests
+  const eSceneObjectType type = object.GetType();
+
+  if ( type == SceneBox::ObjectType() )       { return kSK_Box; }
+  if ( type == SceneSphere::ObjectType() )    { return kSK_Sphere; }
+  if ( type == SceneCylinder::ObjectType() )  { return kSK_Cylinder; }
+  if ( type == SceneDisk::ObjectType() )      { return kSK_Disk; }
+  if ( type == ScenePlane::ObjectType() )     { return kSK_Plane; }
+#else
+  (void)object;
+#endif
+
+  return kSK_Virtual;
+}
+
+/// orders object indices by shape kernel
+struct KernelLess
+{
+  explicit KernelLess( const uint8_t* puiKernels ) : m_puiKernels( puiKernels ) {}
+
+  bool operator()( uint32_t a, uint32_t b ) const { return m_puiKernels[a] < m_puiKernels[b]; }
+
+  const uint8_t* m_puiKernels;
+};
+
+#if defined(LEAP_SCENE_SSE)
+
+// the kernels below follow the virtual hit tests of each shape, done in scene space instead of object space.
+// each returns a mask with one bit per lane hit.
+
+static inline __m128 loadChannel( const float* pfBlock, int iChannel ) { return _mm_loadu_ps( pfBlock + iChannel*4 ); }
+
+static inline __m128 dot3( __m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz )
+{
+  return _mm_add_ps( _mm_add_ps( _mm_mul_ps(ax, bx), _mm_mul_ps(ay, by) ), _mm_mul_ps(az, bz) );
+}
+
+static inline __m128 absLanes( __m128 v ) { return _mm_andnot_ps( _mm_set1_ps(-0.0f), v ); }
+
+static inline __m128 selectLanes( __m128 mask, __m128 a, __m128 b )
+{
+  return _mm_or_ps( _mm_and_ps(mask, a), _mm_andnot_ps(mask, b) );
+}
+
+/// a point relative to the centers of a block
+struct LanePoint
+{
+  LanePoint( const float* pfBlock, const Vector& vPoint )
+    : x( _mm_sub_ps( _mm_set1_ps(vPoint.x), loadChannel(pfBlock, kSC_CenterX) ) ),
+      y( _mm_sub_ps( _mm_set1_ps(vPoint.y), loadChannel(pfBlock, kSC_CenterY) ) ),
+      z( _mm_sub_ps( _mm_set1_ps(vPoint.z), loadChannel(pfBlock, kSC_CenterZ) ) )
+  {}
+
+  /// dot product with 3 channels of the block
+  __m128 Dot( const float* pfBlock, int iChannelX ) const
+  {
+    return dot3( x, y, z, loadChannel(pfBlock, iChannelX), loadChannel(pfBlock, iChannelX + 1), loadChannel(pfBlock, iChannelX + 2) );
+  }
+
+  __m128 x, y, z;
+};
+
+/// a direction broadcast to every lane
+struct LaneDirection
+{
+  explicit LaneDirection( const Vector& vDirection )
+    : x( _mm_set1_ps(vDirection.x) ), y( _mm_set1_ps(vDirection.y) ), z( _mm_set1_ps(vDirection.z) )
+  {}
+
+  __m128 Dot( const float* pfBlock, int iChannelX ) const
+  {
+    return dot3( x, y, z, loadChannel(pfBlock, iChannelX), loadChannel(pfBlock, iChannelX + 1), loadChannel(pfBlock, iChannelX + 2) );
+  }
+
+  __m128 x, y, z;
+};
+
+static int rayHitBoxes( const float* pfBlock, const SceneRay& ray, __m128& hitDistOut )
+{
+  const LanePoint     O( pfBlock, ray.m_vOrigin );
+  const LaneDirection d( ray.m_vDirection );
+  const __m128        zero  = _mm_setzero_ps();
+
+  // the ray in the space of each box
+  const __m128  ox  = O.Dot( pfBlock, kSC_XBasisX );
+  const __m128  oy  = O.Dot( pfBlock, kSC_YBasisX );
+  const __m128  oz  = O.Dot( pfBlock, kSC_ZBasisX );
+  const __m128  ix  = _mm_div_ps( _mm_set1_ps(1.0f), d.Dot( pfBlock, kSC_XBasisX ) );
+  const __m128  iy  = _mm_div_ps( _mm_set1_ps(1.0f), d.Dot( pfBlock, kSC_YBasisX ) );
+  const __m128  iz  = _mm_div_ps( _mm_set1_ps(1.0f), d.Dot( pfBlock, kSC_ZBasisX ) );
+  const __m128  hx  = loadChannel( pfBlock, kSC_HalfSizeX );
+  const __m128  hy  = loadChannel( pfBlock, kSC_HalfSizeY );
+  const __m128  hz  = loadChannel( pfBlock, kSC_HalfSizeZ );
+
+  const __m128  lx  = _mm_mul_ps( _mm_sub_ps( _mm_sub_ps(zero, hx), ox ), ix );
+  const __m128  ly  = _mm_mul_ps( _mm_sub_ps( _mm_sub_ps(zero, hy), oy ), iy );
+  const __m128  lz  = _mm_mul_ps( _mm_sub_ps( _mm_sub_ps(zero, hz), oz ), iz );
+  const __m128  ux  = _mm_mul_ps( _mm_sub_ps(hx, ox), ix );
+  const __m128  uy  = _mm_mul_ps( _mm_sub_ps(hy, oy), iy );
+  const __m128  uz  = _mm_mul_ps( _mm_sub_ps(hz, oz), iz );
+
+  const __m128  tMin  = _mm_max_ps( _mm_max_ps( _mm_min_ps(lx, ux), _mm_min_ps(ly, uy) ), _mm_min_ps(lz, uz) );
+  const __m128  tMax  = _mm_min_ps( _mm_min_ps( _mm_max_ps(lx, ux), _mm_max_ps(ly, uy) ), _mm_max_ps(lz, uz) );
+
+  hitDistOut = selectLanes( _mm_cmpgt_ps(tMin, zero), tMin, tMax );
+
+  return _mm_movemask_ps( _mm_and_ps( _mm_cmplt_ps(tMin, tMax), _mm_cmpgt_ps(tMax, zero) ) );
+}
+
+static int rayHitSpheres( const float* pfBlock, const SceneRay& ray, __m128& hitDistOut )
+{
+  const LanePoint     O( pfBlock, ray.m_vOrigin );
+  const LaneDirection d( ray.m_vDirection );
+  const __m128        zero    = _mm_setzero_ps();
+  const __m128        radius  = loadChannel( pfBlock, kSC_Radius );
+
+  const __m128  b     = dot3( O.x, O.y, O.z, d.x, d.y, d.z );
+  const __m128  c     = _mm_sub_ps( dot3( O.x, O.y, O.z, O.x, O.y, O.z ), _mm_mul_ps(radius, radius) );
+  const __m128  disc  = _mm_sub_ps( _mm_mul_ps(b, b), c );
+  const __m128  sdisc = _mm_sqrt_ps( _mm_max_ps(disc, zero) );
+  const __m128  near  = _mm_sub_ps( _mm_sub_ps(zero, b), sdisc );
+  const __m128  far   = _mm_sub_ps( sdisc, b );
+
+  hitDistOut = selectLanes( _mm_cmpgt_ps(near, zero), near, far );
+
+  return _mm_movemask_ps( _mm_and_ps( _mm_cmpgt_ps(disc, zero), _mm_cmpgt_ps(hitDistOut, zero) ) );
+}
+
+static int rayHitCylinders( const float* pfBlock, const SceneRay& ray, __m128& hitDistOut )
+{
+  const LanePoint     O( pfBlock, ray.m_vOrigin );
+  const LaneDirection d( ray.m_vDirection );
+  const __m128        zero        = _mm_setzero_ps();
+  const __m128        ax          = loadChannel( pfBlock, kSC_YBasisX );
+  const __m128        ay          = loadChannel( pfBlock, kSC_YBasisY );
+  const __m128        az          = loadChannel( pfBlock, kSC_YBasisZ );
+  const __m128        radius      = loadChannel( pfBlock, kSC_Radius );
+  const __m128        halfHeight  = loadChannel( pfBlock, kSC_HalfHeight );
+
+  // D is the unit normal to the ray direction and the axis
+  const __m128  rxaX    = _mm_sub_ps( _mm_mul_ps(d.y, az), _mm_mul_ps(d.z, ay) );
+  const __m128  rxaY    = _mm_sub_ps( _mm_mul_ps(d.z, ax), _mm_mul_ps(d.x, az) );
+  const __m128  rxaZ    = _mm_sub_ps( _mm_mul_ps(d.x, ay), _mm_mul_ps(d.y, ax) );
+  const __m128  norm    = _mm_sqrt_ps( dot3( rxaX, rxaY, rxaZ, rxaX, rxaY, rxaZ ) );
+  const __m128  invNorm = _mm_div_ps( _mm_set1_ps(1.0f), norm );
+  const __m128  Dx      = _mm_mul_ps( rxaX, invNorm );
+  const __m128  Dy      = _mm_mul_ps( rxaY, invNorm );
+  const __m128  Dz      = _mm_mul_ps( rxaZ, invNorm );
+
+  // distance between the ray and the axis
+  const __m128  dist    = absLanes( dot3( O.x, O.y, O.z, Dx, Dy, Dz ) );
+
+  // Oc is D x axis normalized
+  const __m128  ocX     = _mm_sub_ps( _mm_mul_ps(Dy, az), _mm_mul_ps(Dz, ay) );
+  const __m128  ocY     = _mm_sub_ps( _mm_mul_ps(Dz, ax), _mm_mul_ps(Dx, az) );
+  const __m128  ocZ     = _mm_sub_ps( _mm_mul_ps(Dx, ay), _mm_mul_ps(Dy, ax) );
+  const __m128  ocNorm  = _mm_sqrt_ps( dot3( ocX, ocY, ocZ, ocX, ocY, ocZ ) );
+  const __m128  dDotOc  = _mm_div_ps( dot3( d.x, d.y, d.z, ocX, ocY, ocZ ), ocNorm );
+
+  const __m128  s       = absLanes( _mm_div_ps( _mm_sqrt_ps( _mm_max_ps( _mm_sub_ps( _mm_mul_ps(radius, radius), _mm_mul_ps(dist, dist) ), zero ) ), dDotOc ) );
+
+  // -(O x axis).D / norm
+  const __m128  oxaX    = _mm_sub_ps( _mm_mul_ps(O.y, az), _mm_mul_ps(O.z, ay) );
+  const __m128  oxaY    = _mm_sub_ps( _mm_mul_ps(O.z, ax), _mm_mul_ps(O.x, az) );
+  const __m128  oxaZ    = _mm_sub_ps( _mm_mul_ps(O.x, ay), _mm_mul_ps(O.y, ax) );
+  const __m128  temp    = _mm_sub_ps( zero, _mm_mul_ps( dot3( oxaX, oxaY, oxaZ, Dx, Dy, Dz ), invNorm ) );
+  const __m128  tIn     = _mm_sub_ps( temp, s );
+  const __m128  tOut    = _mm_add_ps( temp, s );
+
+  // heights of the hits along the axis
+  const __m128  oAxis   = dot3( O.x, O.y, O.z, ax, ay, az );
+  const __m128  dAxis   = dot3( d.x, d.y, d.z, ax, ay, az );
+  const __m128  yIn     = absLanes( _mm_add_ps( oAxis, _mm_mul_ps(dAxis, tIn) ) );
+  const __m128  yOut    = absLanes( _mm_add_ps( oAxis, _mm_mul_ps(dAxis, tOut) ) );
+  const __m128  hitIn   = _mm_and_ps( _mm_cmpgt_ps(tIn, zero), _mm_cmple_ps(yIn, halfHeight) );
+  const __m128  hitOut  = _mm_and_ps( _mm_cmpgt_ps(tOut, zero), _mm_cmple_ps(yOut, halfHeight) );
+
+  hitDistOut = selectLanes( hitIn, tIn, tOut );
+
+  return _mm_movemask_ps( _mm_and_ps( _mm_and_ps( _mm_cmpgt_ps(norm, zero), _mm_cmplt_ps(dist, radius) ),
+                                      _mm_or_ps(hitIn, hitOut) ) );
+}
+
+static int rayHitDisks( const float* pfBlock, const SceneRay& ray, __m128& hitDistOut )
+{
+  const LanePoint     O( pfBlock, ray.m_vOrigin );
+  const LaneDirection d( ray.m_vDirection );
+  const __m128        zero    = _mm_setzero_ps();
+  const __m128        radius  = loadChannel( pfBlock, kSC_Radius );
+
+  // distance to the plane of each disk along the ray
+  const __m128  dNormal = d.Dot( pfBlock, kSC_ZBasisX );
+  const __m128  t       = _mm_div_ps( _mm_sub_ps( zero, O.Dot( pfBlock, kSC_ZBasisX ) ), dNormal );
+
+  // distance from the center to the intersection with the plane
+  const __m128  px      = _mm_add_ps( O.x, _mm_mul_ps(d.x, t) );
+  const __m128  py      = _mm_add_ps( O.y, _mm_mul_ps(d.y, t) );
+  const __m128  pz      = _mm_add_ps( O.z, _mm_mul_ps(d.z, t) );
+  const __m128  distSq  = dot3( px, py, pz, px, py, pz );
+
+  hitDistOut = t;
+
+  return _mm_movemask_ps( _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( absLanes(dNormal), _mm_set1_ps(kfEpsilon) ), _mm_cmpgt_ps(t, zero) ),
+                                      _mm_cmplt_ps( distSq, _mm_mul_ps(radius, radius) ) ) );
+}
+
+static int rayHitPlanes( const float* pfBlock, const SceneRay& ray, __m128& hitDistOut )
+{
+  const LanePoint     O( pfBlock, ray.m_vOrigin );
+  const LaneDirection d( ray.m_vDirection );
+  const __m128        zero    = _mm_setzero_ps();
+  const __m128        cosine  = d.Dot( pfBlock, kSC_ZBasisX );
+
+  hitDistOut = _mm_div_ps( _mm_sub_ps( zero, O.Dot( pfBlock, kSC_ZBasisX ) ), cosine );
+
+  return _mm_movemask_ps( _mm_and_ps( _mm_cmpge_ps( absLanes(cosine), _mm_set1_ps(kfEpsilon) ), _mm_cmpgt_ps(hitDistOut, zero) ) );
+}
+
+static int sphereHitBoxes( const float* pfBlock, const Vector& vTestPoint, float fTestRadius )
+{
+  const LanePoint O( pfBlock, vTestPoint );
+  const __m128    zero  = _mm_setzero_ps();
+
+  // the test point in the space of each box and its distance outside of the faces
+  const __m128  px    = O.Dot( pfBlock, kSC_XBasisX );
+  const __m128  py    = O.Dot( pfBlock, kSC_YBasisX );
+  const __m128  pz    = O.Dot( pfBlock, kSC_ZBasisX );
+  const __m128  hx    = loadChannel( pfBlock, kSC_HalfSizeX );
+  const __m128  hy    = loadChannel( pfBlock, kSC_HalfSizeY );
+  const __m128  hz    = loadChannel( pfBlock, kSC_HalfSizeZ );
+  const __m128  lx    = _mm_min_ps( _mm_add_ps(px, hx), zero );
+  const __m128  ly    = _mm_min_ps( _mm_add_ps(py, hy), zero );
+  const __m128  lz    = _mm_min_ps( _mm_add_ps(pz, hz), zero );
+  const __m128  ux    = _mm_max_ps( _mm_sub_ps(px, hx), zero );
+  const __m128  uy    = _mm_max_ps( _mm_sub_ps(py, hy), zero );
+  const __m128  uz    = _mm_max_ps( _mm_sub_ps(pz, hz), zero );
+  const __m128  distSq  = _mm_add_ps( dot3( lx, ly, lz, lx, ly, lz ), dot3( ux, uy, uz, ux, uy, uz ) );
+
+  return _mm_movemask_ps( _mm_cmple_ps( distSq, _mm_set1_ps(fTestRadius*fTestRadius) ) );
+}
+
+static int sphereHitSpheres( const float* pfBlock, const Vector& vTestPoint, float fTestRadius )
+{
+  const LanePoint O( pfBlock, vTestPoint );
+  const __m128    maxDist = _mm_add_ps( loadChannel( pfBlock, kSC_Radius ), _mm_set1_ps(fTestRadius) );
+
+  return _mm_movemask_ps( _mm_cmplt_ps( dot3( O.x, O.y, O.z, O.x, O.y, O.z ), _mm_mul_ps(maxDist, maxDist) ) );
+}
+
+static int sphereHitCylinders( const float* pfBlock, const Vector& vTestPoint, float fTestRadius )
+{
+  const LanePoint O( pfBlock, vTestPoint );
+  const __m128    zero        = _mm_setzero_ps();
+  const __m128    testRadius  = _mm_set1_ps( fTestRadius );
+  const __m128    radius      = loadChannel( pfBlock, kSC_Radius );
+  const __m128    halfHeight  = loadChannel( pfBlock, kSC_HalfHeight );
+
+  // height along the axis and squared distance to the axis of the test point
+  const __m128  y         = O.Dot( pfBlock, kSC_YBasisX );
+  const __m128  absY      = absLanes( y );
+  const __m128  axisDistSq  = _mm_max_ps( _mm_sub_ps( dot3( O.x, O.y, O.z, O.x, O.y, O.z ), _mm_mul_ps(y, y) ), zero );
+  const __m128  reach     = _mm_add_ps( testRadius, radius );
+  const __m128  inReach   = _mm_cmplt_ps( axisDistSq, _mm_mul_ps(reach, reach) );
+
+  // wall, end caps, then edges of the end caps
+  const __m128  wall      = _mm_cmplt_ps( absY, halfHeight );
+  const __m128  cap       = _mm_and_ps( _mm_cmplt_ps( axisDistSq, _mm_mul_ps(radius, radius) ),
+                                        _mm_cmplt_ps( absY, _mm_add_ps(halfHeight, testRadius) ) );
+
+  // as Vector::normalized() a test point on the axis has its closest edge point on the axis
+  const __m128  axisDist  = _mm_sqrt_ps( axisDistSq );
+  const __m128  edgeDx    = selectLanes( _mm_cmpgt_ps( axisDistSq, _mm_set1_ps(FLT_EPSILON) ), _mm_sub_ps(axisDist, radius), axisDist );
+  const __m128  edgeDy    = _mm_sub_ps( absY, halfHeight );
+  const __m128  edge      = _mm_cmplt_ps( _mm_add_ps( _mm_mul_ps(edgeDx, edgeDx), _mm_mul_ps(edgeDy, edgeDy) ), _mm_mul_ps(testRadius, testRadius) );
+
+  return _mm_movemask_ps( _mm_and_ps( inReach, _mm_or_ps( _mm_or_ps(wall, cap), edge ) ) );
+}
+
+static int sphereHitDisks( const float* pfBlock, const Vector& vTestPoint, float fTestRadius )
+{
+  const LanePoint O( pfBlock, vTestPoint );
+  const __m128    zero        = _mm_setzero_ps();
+  const __m128    one         = _mm_set1_ps( 1.0f );
+  const __m128    testRadius  = _mm_set1_ps( fTestRadius );
+
+  // height above the plane of each disk and squared distance to the center of its projection on the plane
+  const __m128  z         = O.Dot( pfBlock, kSC_ZBasisX );
+  const __m128  onPlaneSq = _mm_max_ps( _mm_sub_ps( dot3( O.x, O.y, O.z, O.x, O.y, O.z ), _mm_mul_ps(z, z) ), zero );
+
+  // radius of the intersection of the test sphere with the plane plus the disk radius
+  const __m128  sine      = _mm_div_ps( z, testRadius );
+  const __m128  cosine    = _mm_sqrt_ps( _mm_max_ps( _mm_sub_ps( one, _mm_mul_ps(sine, sine) ), zero ) );
+  const __m128  reach     = _mm_add_ps( _mm_mul_ps(cosine, testRadius), loadChannel( pfBlock, kSC_Radius ) );
+
+  return _mm_movemask_ps( _mm_and_ps( _mm_cmplt_ps( absLanes(z), testRadius ), _mm_cmplt_ps( onPlaneSq, _mm_mul_ps(reach, reach) ) ) );
+}
+
+static int sphereHitPlanes( const float* pfBlock, const Vector& vTestPoint, float fTestRadius )
+{
+  const LanePoint O( pfBlock, vTestPoint );
+
+  return _mm_movemask_ps( _mm_cmplt_ps( absLanes( O.Dot( pfBlock, kSC_ZBasisX ) ), _mm_set1_ps(fTestRadius) ) );
+}
+
+static int rayHitShapes( uint32_t uiKernel, const float* pfBlock, const SceneRay& ray, __m128& hitDistOut )
+{
+  switch ( uiKernel )
+  {
+    case kSK_Box:       return rayHitBoxes( pfBlock, ray, hitDistOut );
+    case kSK_Sphere:    return rayHitSpheres( pfBlock, ray, hitDistOut );
+    case kSK_Cylinder:  return rayHitCylinders( pfBlock, ray, hitDistOut );
+    case kSK_Disk:      return rayHitDisks( pfBlock, ray, hitDistOut );
+    case kSK_Plane:     return rayHitPlanes( pfBlock, ray, hitDistOut );
+  }
+
+  return 0;
+}
+
+static int sphereHitShapes( uint32_t uiKernel, const float* pfBlock, const Vector& vTestPoint, float fTestRadius )
+{
+  switch ( uiKernel )
+  {
+    case kSK_Box:       return sphereHitBoxes( pfBlock, vTestPoint, fTestRadius );
+    case kSK_Sphere:    return sphereHitSpheres( pfBlock, vTestPoint, fTestRadius );
+    case kSK_Cylinder:  return sphereHitCylinders( pfBlock, vTestPoint, fTestRadius );
+    case kSK_Disk:      return sphereHitDisks( pfBlock, vTestPoint, fTestRadius );
+    case kSK_Plane:     return sphereHitPlanes( pfBlock, vTestPoint, fTestRadius );
+  }
+
+  return 0;
+}
+
+#endif // LEAP_SCENE_SSE
+
 //***********************
 //
 // Scene public methods
@@ -33,9 +519,26 @@ Scene::Scene()
     m_uiNumQueuedInteractions( 0 ),
     m_uiNumPendingRemovals( 0 ),
     m_uiNextSerial( 0 ),
-    m_uiFlags( kF_UpdateRayCast | kF_UpdateContact )
+    m_uiFlags( kF_UpdateRayCast | kF_UpdateContact ),
+    m_uiNumBVHNodes( 0 ),
+    m_uiNumLanes( 0 ),
+    m_uiNumRefitsSinceBuild( 0 ),
+    m_bRebuildBVH( false ),
+    m_contactBroadPhase( kCBP_BoundingVolumes ),
+    m_fContactCellSize( 0.0f ),
+    m_fGridInvCellSize( 1.0f ),
+    m_uiGridStamp( 0 )
+{
+}
+
+Scene::~Scene()
 {
-  memset( m_apObjects, 0, sizeof(m_apObjects) );
+  Reset();
+
+  for ( size_t i = 0; i < m_apObjectChunks.size(); i++ )
+  {
+    delete [] m_apObjectChunks[i];
+  }
 }
 
 void Scene::RemoveObject( SceneObject* pObject )
@@ -51,17 +554,23 @@ void Scene::Reset()
 {
   for ( uint32_t i = 0; i < m_uiNumObjects; i++ )
   {
-    if ( SceneObject* pObj = m_apObjects[i] )
+    if ( SceneObject* pObj = objectAt(i) )
     {
+      freeHandle( pObj->m_handle );
       pObj->m_pScene = NULL;
-      pObj->m_index = kMaxObjects;
+      pObj->m_index = kInvalidIndex;
+      pObj->m_handle = SceneObjectHandle();
+      pObj->m_bMoved = false;
     }
 
-    m_apObjects[i].Release();
+    objectAt(i).Release();
   }
 
   m_uiNumObjects          = 0;
   m_uiNumPendingRemovals  = 0;
+  m_bRebuildBVH           = true;
+
+  m_auiMovedObjects.clear();
 
   clearInteractionQueue();
   clearRayHits();
@@ -89,33 +598,40 @@ void Scene::DeselectAll()
 
   for (size_t i=0; i < m_uiNumObjects; i++)
   {
-    m_apObjects[i]->SetSelected( false );
+    objectAt(i)->SetSelected( false );
   }
 }
 
 const SceneObjectPtr& Scene::TestRayHit( const SceneRay& ray ) const
 {
-  float fClosestHitDist = FLT_MAX;
-  int closestHitIndex   = -1;
+  // the hierarchy only caches the bounds of the objects - bringing it up to date does not change the scene.
+  const_cast<Scene*>(this)->updateBVH();
 
-  for (uint32_t i = 0; i < m_uiNumObjects; i++)
-  {
-    float fHitDist = FLT_MAX;
-    if (m_apObjects[i]->TestRayHit(ray, fHitDist) && (fHitDist < fClosestHitDist) )
-    {
-      closestHitIndex = static_cast<int>(i);
-      fClosestHitDist = fHitDist;
-    }
-  }
+  float fClosestHitDist = FLT_MAX;
+  int closestHitIndex   = findRayHitClosest( ray, fClosestHitDist );
 
   if (closestHitIndex >= 0)
   {
-    return m_apObjects[closestHitIndex];
+    return objectAt(closestHitIndex);
   }
 
   return SceneObjectPtr::Null();
 }
 
+void Scene::TestContact( const SceneContactPoint& testPoint, const Vector* pvFrom )
+{
+  updateBVH();
+
+  if ( pvFrom )
+  {
+    updateSweptContact( *pvFrom, testPoint );
+  }
+  else
+  {
+    updateContact( testPoint );
+  }
+}
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
 void Scene::RayHitsDebugDrawGL() const
 {
@@ -140,64 +656,111 @@ void Scene::RayHitsDebugDrawGL() const
 //
 //***********************
 
+void Scene::addObject( SceneObject* pObject )
+{
+  if ( m_uiNumObjects == m_apObjectChunks.size() * kObjectChunkSize )
+  {
+    m_apObjectChunks.push_back( new SceneObjectPtr[kObjectChunkSize] );
+  }
+
+  pObject->m_pScene           = this;
+  pObject->m_serial           = m_uiNextSerial++;
+  pObject->m_index            = m_uiNumObjects;
+  pObject->m_handle           = allocateHandle( m_uiNumObjects );
+  objectAt(m_uiNumObjects++)  = SceneObjectPtr(pObject);
+  m_bRebuildBVH               = true;
+}
+
 void Scene::deallocateObject( uint32_t idxToRemove )
 {
-  if ( SceneObject* pObjToRemove = (idxToRemove < m_uiNumObjects) ? m_apObjects[idxToRemove].GetPointer() : NULL )
+  if ( SceneObject* pObjToRemove = (idxToRemove < m_uiNumObjects) ? objectAt(idxToRemove).GetPointer() : NULL )
   {
     m_uiNumObjects--;
 
     // orphan the object
     pObjToRemove->m_pScene  = NULL;
+    pObjToRemove->m_bMoved  = false;
+
+    // indices change - the hierarchy is rebuilt before the next hit test.
+    m_bRebuildBVH           = true;
 
-    // assign an invalid index.
-    pObjToRemove->m_index   = static_cast<uint32_t>(kMaxObjects);
+    // invalidate its handles and assign an invalid index.
+    freeHandle( pObjToRemove->m_handle );
+    pObjToRemove->m_handle  = SceneObjectHandle();
+    pObjToRemove->m_index   = kInvalidIndex;
 
     // if removing any object but the last one
     if ( idxToRemove != m_uiNumObjects )
     {
       // move the last object to the vacated slot - releases the reference to the outbound object.
       // increases the reference count on the the last object.
-      m_apObjects[idxToRemove] = m_apObjects[m_uiNumObjects];
+      objectAt(idxToRemove) = objectAt(m_uiNumObjects);
 
-      // update its index to match
-      m_apObjects[idxToRemove]->m_index = static_cast<uint16_t>(idxToRemove);
+      // update its index and the slot of its handle to match
+      objectAt(idxToRemove)->m_index = idxToRemove;
+      m_aSlots[objectAt(idxToRemove)->m_handle.m_uiSlot].m_uiIndex = idxToRemove;
 
       // release the extra reference to the last object
-      m_apObjects[m_uiNumObjects].Release();
+      objectAt(m_uiNumObjects).Release();
     }
     else
     {
       // it was the last object - just release the reference to it.
-      m_apObjects[idxToRemove].Release();
+      objectAt(idxToRemove).Release();
     }
 
   }
 }
 
-bool Scene::testRayHitClosest( SceneRayHit& hitResult )
+SceneObjectHandle Scene::allocateHandle( uint32_t idx )
 {
-  float fClosestHitDist = FLT_MAX;
-  int closestHitIndex   = -1;
+  uint32_t uiSlot;
 
-  for (uint32_t i = 0; i < m_uiNumObjects; i++)
+  if ( m_auiFreeSlots.empty() )
   {
-    float fHitDist = FLT_MAX;
-    if (m_apObjects[i]->TestRayHit(hitResult.m_ray, fHitDist) && (fHitDist < fClosestHitDist) )
-    {
-      closestHitIndex = static_cast<int>(i);
-      fClosestHitDist = fHitDist;
-    }
+    // generation 0 is left to invalid handles
+    Slot slot = { idx, 1 };
+
+    uiSlot = static_cast<uint32_t>( m_aSlots.size() );
+    m_aSlots.push_back( slot );
+  }
+  else
+  {
+    uiSlot = m_auiFreeSlots.back();
+    m_auiFreeSlots.pop_back();
+    m_aSlots[uiSlot].m_uiIndex = idx;
+  }
+
+  return SceneObjectHandle( uiSlot, m_aSlots[uiSlot].m_uiGeneration );
+}
+
+void Scene::freeHandle( const SceneObjectHandle& handle )
+{
+  Slot& slot = m_aSlots[handle.m_uiSlot];
+
+  slot.m_uiIndex = kInvalidIndex;
+
+  // a slot whose generation wraps around is retired rather than handing out generation 0
+  if ( ++slot.m_uiGeneration )
+  {
+    m_auiFreeSlots.push_back( handle.m_uiSlot );
   }
+}
+
+bool Scene::testRayHitClosest( SceneRayHit& hitResult )
+{
+  float fClosestHitDist = FLT_MAX;
+  int closestHitIndex   = findRayHitClosest( hitResult.m_ray, fClosestHitDist );
 
   if (closestHitIndex >= 0)
   {
     hitResult.m_fHitDistance  = fClosestHitDist;
-    hitResult.m_pHitObject    = m_apObjects[closestHitIndex];
+    hitResult.m_pHitObject    = objectAt(closestHitIndex);
     hitResult.m_hitPoint      = hitResult.m_ray.CalcPointOn( hitResult.m_fHitDistance );
 
-    m_apObjects[closestHitIndex]->IncNumPointing();
+    objectAt(closestHitIndex)->IncNumPointing();
 
-    m_apObjects[closestHitIndex]->m_fTotalHitTime += m_fDeltaTimeSeconds;
+    objectAt(closestHitIndex)->m_fTotalHitTime += m_fDeltaTimeSeconds;
 
     return true;
   }
@@ -207,216 +770,1098 @@ bool Scene::testRayHitClosest( SceneRayHit& hitResult )
 
 void Scene::updateContact( const SceneContactPoint& testPoint )
 {
-  for (size_t i=0; i < m_uiNumObjects; i++)
+  for ( size_t i = 0; i < m_aUnboundedLeaves.size(); i++ )
+  {
+    testContactLeaf( m_aUnboundedLeaves[i], testPoint );
+  }
+
+  if ( m_contactBroadPhase == kCBP_SpatialHash && updateGridContact( testPoint, NULL ) )
+  {
+    return;
+  }
+
+  uint32_t auiStack[kBVHStackSize];
+  uint32_t uiStackSize = 0;
+
+  if ( m_uiNumBVHNodes )
+  {
+    auiStack[uiStackSize++] = 0;
+  }
+
+  while ( uiStackSize )
   {
-    if ( m_apObjects[i]->TestSphereHit( testPoint.m_vPoint, m_fPointableRadius ) )
+    const BVHNode& node = m_aBVHNodes[auiStack[--uiStackSize]];
+
+    if ( !node.m_bounds.TestSphereHit( testPoint.m_vPoint, m_fPointableRadius ) )
+    {
+      continue;
+    }
+
+    if ( node.m_uiCount )
+    {
+      testContactLeaf( node, testPoint );
+    }
+    else
     {
-      m_apObjects[i]->IncNumContacts( testPoint );
-      m_apObjects[i]->m_fTotalHitTime += m_fDeltaTimeSeconds;
+      auiStack[uiStackSize++] = node.m_uiFirst;
+      auiStack[uiStackSize++] = node.m_uiFirst + 1;
     }
   }
 }
 
-void Scene::updateSelectionAndContact( const Frame& frame )
+void Scene::updateSweptContact( const Vector& vFrom, const SceneContactPoint& testPoint )
 {
-  const PointableList& pointables = frame.pointables();
+  for ( size_t i = 0; i < m_aUnboundedLeaves.size(); i++ )
+  {
+    const BVHNode& leaf = m_aUnboundedLeaves[i];
 
-  if ( pointables.isEmpty() && frame.hands().isEmpty() )
+    for ( uint32_t j = 0; j < leaf.m_uiCount; j++ )
+    {
+      testSweptContactObject( m_auiLaneObjects[leaf.m_uiFirst + j], vFrom, testPoint );
+    }
+  }
+
+  if ( m_contactBroadPhase == kCBP_SpatialHash && updateGridContact( testPoint, &vFrom ) )
   {
-    queueDeselectAll();
+    return;
   }
 
-  for ( uint32_t j = 0, numPointables = pointables.count(); j < numPointables; j++ )
+  // the nodes whose bounds grown by the radius are crossed by the motion, as a ray over [0, 1]
+  const Vector    vRadius( m_fPointableRadius, m_fPointableRadius, m_fPointableRadius );
+  const SceneRay  sweep( vFrom, testPoint.m_vPoint - vFrom );
+  const Vector    vInvSweep = ComponentWiseReciprocal( sweep.m_vDirection );
+  uint32_t        auiStack[kBVHStackSize];
+  uint32_t        uiStackSize = 0;
+
+  if ( m_uiNumBVHNodes )
   {
-    const Pointable& pointable    = pointables[j];
-    const Vector  vPos            = TransformFramePoint( pointable.tipPosition() );
-    const int     iPointableID    = pointable.id();
+    auiStack[uiStackSize++] = 0;
+  }
+
+  while ( uiStackSize )
+  {
+    const BVHNode&    node    = m_aBVHNodes[auiStack[--uiStackSize]];
+    const SceneBounds bounds( node.m_bounds.m_vMin - vRadius, node.m_bounds.m_vMax + vRadius );
+    float             fEnter;
+
+    if ( !rayHitsBounds( sweep, vInvSweep, bounds, 1.0f, fEnter ) )
+    {
+      continue;
+    }
+
+    if ( node.m_uiCount )
+    {
+      for ( uint32_t i = 0; i < node.m_uiCount; i++ )
+      {
+        testSweptContactObject( m_auiLaneObjects[node.m_uiFirst + i], vFrom, testPoint );
+      }
+    }
+    else
+    {
+      auiStack[uiStackSize++] = node.m_uiFirst;
+      auiStack[uiStackSize++] = node.m_uiFirst + 1;
+    }
+  }
+}
+
+void Scene::testSweptContactObject( uint32_t idx, const Vector& vFrom, const SceneContactPoint& testPoint )
+{
+  SceneObject*  pObj  = objectAt(idx);
+  float         fTime = 1.0f;
+
+  if ( pObj->TestSweptSphereHit( vFrom, testPoint.m_vPoint, m_fPointableRadius, fTime ) )
+  {
+    SceneContactPoint contactPoint( testPoint );
+
+    contactPoint.m_fTimeOfImpact  = fTime;
+    contactPoint.m_vImpactPoint   = vFrom + (testPoint.m_vPoint - vFrom) * fTime;
+
+    addContact( pObj, contactPoint );
+  }
+}
+
+void Scene::addContact( SceneObject* pObj, const SceneContactPoint& testPoint )
+{
+  pObj->IncNumContacts( testPoint );
+  pObj->m_fTotalHitTime += m_fDeltaTimeSeconds;
+}
+
+void Scene::testContactLeaf( const BVHNode& leaf, const SceneContactPoint& testPoint )
+{
+  const uint32_t* puiObjects = &m_auiLaneObjects[leaf.m_uiFirst];
+
+#if defined(LEAP_SCENE_SSE)
+  if ( leaf.m_uiKernel != kSK_Virtual )
+  {
+    const float*  pfBlock = &m_afShapeLanes[leaf.m_uiFirst * kShapeChannels];
+    int           hits    = sphereHitShapes( leaf.m_uiKernel, pfBlock, testPoint.m_vPoint, m_fPointableRadius );
+
+    for ( uint32_t i = 0; i < leaf.m_uiCount; i++, hits >>= 1 )
+    {
+      if ( hits & 1 )
+      {
+        addContact( objectAt(puiObjects[i]), testPoint );
+      }
+    }
+
+    return;
+  }
+#endif // LEAP_SCENE_SSE
+
+  for ( uint32_t i = 0; i < leaf.m_uiCount; i++ )
+  {
+    SceneObject* pObj = objectAt(puiObjects[i]);
+
+    if ( pObj->TestSphereHit( testPoint.m_vPoint, m_fPointableRadius ) )
+    {
+      addContact( pObj, testPoint );
+    }
+  }
+}
+
+/// keeps a hit if it is closer than the closest hit so far.
+/// ties go to the lowest index - the object a test of every object in order would have kept.
+static inline void keepClosestHit( uint32_t idx, float fHitDist, float& fClosestHitDist, int& closestHitIndex )
+{
+  if ( fHitDist < fClosestHitDist || (fHitDist == fClosestHitDist && static_cast<int>(idx) < closestHitIndex) )
+  {
+    closestHitIndex = static_cast<int>(idx);
+    fClosestHitDist = fHitDist;
+  }
+}
+
+void Scene::testRayHitLeaf( const BVHNode& leaf, const SceneRay& ray, float& fClosestHitDist, int& closestHitIndex ) const
+{
+  const uint32_t* puiObjects = &m_auiLaneObjects[leaf.m_uiFirst];
+
+#if defined(LEAP_SCENE_SSE)
+  if ( leaf.m_uiKernel != kSK_Virtual )
+  {
+    const float*  pfBlock = &m_afShapeLanes[leaf.m_uiFirst * kShapeChannels];
+    __m128        hitDist = _mm_setzero_ps();
+    float         afHitDist[4];
+    int           hits    = rayHitShapes( leaf.m_uiKernel, pfBlock, ray, hitDist );
+
+    _mm_storeu_ps( afHitDist, hitDist );
+
+    for ( uint32_t i = 0; i < leaf.m_uiCount; i++, hits >>= 1 )
+    {
+      if ( hits & 1 )
+      {
+        keepClosestHit( puiObjects[i], afHitDist[i], fClosestHitDist, closestHitIndex );
+      }
+    }
+
+    return;
+  }
+#endif // LEAP_SCENE_SSE
+
+  for ( uint32_t i = 0; i < leaf.m_uiCount; i++ )
+  {
+    float fHitDist = FLT_MAX;
+
+    if ( objectAt(puiObjects[i])->TestRayHit( ray, fHitDist ) )
+    {
+      keepClosestHit( puiObjects[i], fHitDist, fClosestHitDist, closestHitIndex );
+    }
+  }
+}
+
+int Scene::findRayHitClosest( const SceneRay& ray, float& fHitDistOut ) const
+{
+  float fClosestHitDist = FLT_MAX;
+  int closestHitIndex   = -1;
+
+  for ( size_t i = 0; i < m_aUnboundedLeaves.size(); i++ )
+  {
+    testRayHitLeaf( m_aUnboundedLeaves[i], ray, fClosestHitDist, closestHitIndex );
+  }
+
+  // nodes are visited closest first and skipped once they start beyond the closest hit.
+  const Vector  vInvDirection = ComponentWiseReciprocal( ray.m_vDirection );
+  uint32_t      auiStack[kBVHStackSize];
+  float         afStackEnter[kBVHStackSize];
+  uint32_t      uiStackSize = 0;
+  float         fEnter      = 0.0f;
+
+  if ( m_uiNumBVHNodes && rayHitsBounds( ray, vInvDirection, m_aBVHNodes[0].m_bounds, fClosestHitDist, fEnter ) )
+  {
+    afStackEnter[uiStackSize]   = fEnter;
+    auiStack[uiStackSize++]     = 0;
+  }
+
+  while ( uiStackSize )
+  {
+    uiStackSize--;
+
+    if ( afStackEnter[uiStackSize] > fClosestHitDist )
+    {
+      continue;
+    }
+
+    const BVHNode& node = m_aBVHNodes[auiStack[uiStackSize]];
+
+    if ( node.m_uiCount )
+    {
+      testRayHitLeaf( node, ray, fClosestHitDist, closestHitIndex );
+      continue;
+    }
+
+    float fEnter0 = 0.0f;
+    float fEnter1 = 0.0f;
+    const bool bHit0 = rayHitsBounds( ray, vInvDirection, m_aBVHNodes[node.m_uiFirst].m_bounds, fClosestHitDist, fEnter0 );
+    const bool bHit1 = rayHitsBounds( ray, vInvDirection, m_aBVHNodes[node.m_uiFirst + 1].m_bounds, fClosestHitDist, fEnter1 );
+
+    // the closer child goes on top of the stack
+    const bool bFirstCloser = !bHit1 || (bHit0 && fEnter0 <= fEnter1);
+
+    if ( bFirstCloser ? bHit1 : bHit0 )
+    {
+      afStackEnter[uiStackSize]   = bFirstCloser ? fEnter1 : fEnter0;
+      auiStack[uiStackSize++]     = node.m_uiFirst + (bFirstCloser ? 1 : 0);
+    }
+
+    if ( bFirstCloser ? bHit0 : bHit1 )
+    {
+      afStackEnter[uiStackSize]   = bFirstCloser ? fEnter0 : fEnter1;
+      auiStack[uiStackSize++]     = node.m_uiFirst + (bFirstCloser ? 0 : 1);
+    }
+  }
+
+  fHitDistOut = fClosestHitDist;
+  return closestHitIndex;
+}
+
+void Scene::updateSelectionAndContact( const Frame& frame )
+{
+  const PointableList& pointables = frame.pointables();
+
+  updateBVH();
+
+  if ( pointables.isEmpty() && frame.hands().isEmpty() )
+  {
+    queueDeselectAll();
+  }
+
+  for ( uint32_t j = 0, numPointables = pointables.count(); j < numPointables; j++ )
+  {
+    const Pointable& pointable    = pointables[j];
+    const Vector  vPos            = TransformFramePoint( pointable.tipPosition() );
+    const int     iPointableID    = pointable.id();
+
+    if ( GetUpdateRayCast() && (m_uiNumRayHits < static_cast<uint32_t>(kMaxRayHits)) )
+    {
+      SceneRayHit&  rayHit    = m_aRayHits[m_uiNumRayHits];
+
+      rayHit.m_ray            = SceneRay( vPos, TransformFrameDirection( pointable.direction() ) );
+      rayHit.m_iPointableID   = iPointableID;
+
+      if ( testRayHitClosest( rayHit ) )
+      {
+        m_uiNumRayHits++;
+      }
+    }
+
+    if ( GetUpdateContact() )
+    {
+      const SceneContactPoint*  pLastTipPoint = NULL;
+
+      if ( GetSweptContact() )
+      {
+        for ( size_t i = 0; i < m_aLastTipPoints.size() && !pLastTipPoint; i++ )
+        {
+          pLastTipPoint = (m_aLastTipPoints[i].m_iPointableID == iPointableID) ? &m_aLastTipPoints[i] : NULL;
+        }
+
+        m_aTipPoints.push_back( SceneContactPoint( vPos, iPointableID ) );
+      }
+
+      // a pointable that just appeared has no motion to sweep
+      if ( pLastTipPoint )
+      {
+        updateSweptContact( pLastTipPoint->m_vPoint, SceneContactPoint( vPos, iPointableID ) );
+      }
+      else
+      {
+        updateContact( SceneContactPoint( vPos, iPointableID ) );
+      }
+    }
+  }
+
+  m_aLastTipPoints.swap( m_aTipPoints );
+  m_aTipPoints.clear();
+}
+
+void Scene::updateInteraction( const Frame& frame )
+{
+  static const uint8_t kMaxContactMissedFrames = 64;
+
+  (void)frame;
+
+  for (size_t i=0; i < m_uiNumObjects; i++)
+  {
+    const SceneObjectPtr& pObj = objectAt(i);
+
+    if (!pObj->HasInitialContact() && pObj->GetNumContacts() == 0 && pObj->GetNumPointing() == 0)
+    {
+      pObj->m_fTotalHitTime = 0.0f;
+    }
+    /// selection state change from not selected to selected
+    else if ( !pObj->IsSelected() && pObj->m_fTotalHitTime >= m_fSelectHitTime )
+    {
+      SceneInteraction selection;
+      selection.m_uiFlags = kIT_SelectionChange | kIT_IsSelected;
+      selection.m_pObject = pObj;
+      queueInteraction( selection );
+    }
+    /// possible manipulation
+    else if ( pObj->IsSelected() )
+    {
+
+      if ( pObj->HasInitialContact() )
+      {
+        const SceneContactPoint& initContact  = pObj->m_initialContactPoint;
+        Leap::Pointable contactPointable      = frame.pointable(initContact.m_iPointableID);
+
+        if ( contactPointable.isValid() )
+        {
+            const Vector      vPointablePos  = TransformFramePoint(contactPointable.tipPosition());
+            const Vector      vTrans         = (vPointablePos - pObj->GetCenter());
+            SceneInteraction  translation;
+
+            translation.m_mtxTransform.origin = vTrans;
+            translation.m_uiFlags |= kIT_Translation;
+            translation.m_pObject = pObj;
+
+            queueInteraction( translation );
+
+            pObj->m_uiHasInitialContact = kMaxContactMissedFrames;
+        }
+        else
+        {
+          pObj->m_uiHasInitialContact--;
+
+          if ( !pObj->m_uiLastNumContacts )
+          {
+            pObj->ClearHits();
+          }
+        }
+      }
+      else
+      {
+        if ( pObj->GetNumContacts()  )
+        {
+          pObj->m_initialContactPoint = *(pObj->GetContactPoint(0));
+          pObj->m_initialContactPoint.m_vPoint -= pObj->GetCenter();
+          pObj->m_uiHasInitialContact = kMaxContactMissedFrames;
+        }
+        else if ( pObj->GetLastNumContacts() )
+        {
+          pObj->m_initialContactPoint = *(pObj->GetLastContactPoint(0));
+          pObj->m_initialContactPoint.m_vPoint -= pObj->GetCenter();
+          pObj->m_uiHasInitialContact = kMaxContactMissedFrames;
+        }
+      }
+
+      /// multi touch
+      if (pObj->GetLastNumContacts() >= 2 && pObj->GetNumContacts() >= 2)
+      {
+        const SceneContactPoint&  lastContact0  = *(pObj->GetLastContactPoint(0));
+        const SceneContactPoint&  lastContact1  = *(pObj->GetLastContactPoint(1));
+        const SceneContactPoint*  pCurContact0  = pObj->GetContactPointByPointableID( lastContact0.m_iPointableID );
+        const SceneContactPoint*  pCurContact1  = pObj->GetContactPointByPointableID( lastContact1.m_iPointableID );
+
+        if ( pCurContact0 && pCurContact1 )
+        {
+          const Vector lastVec = (lastContact1.m_vPoint - lastContact0.m_vPoint);
+          const Vector newVec = (pCurContact1->m_vPoint - pCurContact0->m_vPoint);
+
+          if ( !IsNearEqual(lastVec, newVec) && !IsNearZero(lastVec) )
+          {
+            const float   fLastDist = lastVec.magnitude();
+            const float   fNewDist  = newVec.magnitude();
+            /// scale by change in pinch distance
+            const float   fScale    = fNewDist/fLastDist;
+
+            /// rotate by tilt of fingers
+            const Vector  vLastDir  = lastVec * 1.0f/fLastDist;
+            const Vector  vNewDir   = newVec  * 1.0f/fNewDist;
+
+            const Vector  vAxis     = vNewDir.cross(vLastDir);
+            const float   fAngle    = acosf( vNewDir.dot(vLastDir) );
+
+            /// translate by average movement
+            const Vector  vTrans    = ( (pCurContact0->m_vPoint - lastContact0.m_vPoint) +
+                                        (pCurContact1->m_vPoint - lastContact1.m_vPoint) ) * 0.5f;
+
+            SceneInteraction interaction;
+
+            if ( !IsNearZero(fAngle) )
+            {
+              interaction.m_mtxTransform.setRotation( vAxis, fAngle );
+              interaction.m_uiFlags |= kIT_Rotation;
+            }
+
+            if ( !IsNearEqual(fScale, 1.0f) )
+            {
+              interaction.m_fScale = fScale;
+              interaction.m_uiFlags |= kIT_Scale;
+            }
+
+            if ( !IsNearZero( vTrans ) )
+            {
+              interaction.m_mtxTransform.origin = vTrans;
+              interaction.m_uiFlags |= kIT_Translation;
+            }
+
+            if ( interaction.m_uiFlags )
+            {
+              interaction.m_pObject = pObj;
+              queueInteraction( interaction );
+            }
+          }
+        }
+      }
+    }
+
+    pObj->rotateContactPoints();
+    pObj->m_uiNumPointing = 0;
+  }
+}
+
+void Scene::processPendingRemovals()
+{
+  for ( uint32_t i = 0; (i < m_uiNumObjects) && m_uiNumPendingRemovals; m_uiNumPendingRemovals-- )
+  {
+    if ( objectAt(i)->m_bPendingRemoval )
+    {
+      deallocateObject( i );
+    }
+    else
+    {
+      i++;
+    }
+  }
+}
+
+void Scene::queueDeselectAll()
+{
+  SceneInteraction deselection;
+  deselection.m_uiFlags = kIT_SelectionChange;
+
+  for (size_t i=0; i < m_uiNumObjects; i++)
+  {
+    if ( objectAt(i)->IsSelected() )
+    {
+      deselection.m_pObject = objectAt(i);
+      queueInteraction( deselection );
+    }
+  }
+}
+
+void Scene::updateBVH()
+{
+  // after as many refits as there are objects the tree may have grown loose.
+  // rebuilding it then costs about as much as the refits did.
+  const uint32_t uiNumMovedObjects = static_cast<uint32_t>( m_auiMovedObjects.size() );
+
+  if ( m_bRebuildBVH || (m_uiNumRefitsSinceBuild + uiNumMovedObjects > m_uiNumObjects) )
+  {
+    buildBVH();
+    return;
+  }
+
+  for ( uint32_t i = 0; i < uiNumMovedObjects; i++ )
+  {
+    const uint32_t  idx     = m_auiMovedObjects[i];
+    SceneObject*    pObj    = objectAt(idx);
+    SceneBounds     bounds;
+
+    pObj->m_bMoved = false;
+
+    const bool bBounded = getPaddedBounds( *pObj, bounds );
+
+    // an object gaining or losing its bounds changes the structure of the tree
+    if ( bBounded != (m_auiObjectLeaves[idx] != kBVHInvalidNode) )
+    {
+      buildBVH();
+      return;
+    }
+
+    writeShapeLane( idx );
+
+    if ( bBounded && bounds != m_aObjectBounds[idx] )
+    {
+      m_aObjectBounds[idx] = bounds;
+
+      if ( m_contactBroadPhase == kCBP_SpatialHash )
+      {
+        moveGridObject( idx );
+      }
+
+      // up to the first ancestor that still contains the new bounds
+      for ( uint32_t uiNode = m_auiObjectLeaves[idx];
+            uiNode != kBVHInvalidNode && refitBVHNode( uiNode );
+            uiNode = m_aBVHNodes[uiNode].m_uiParent );
+    }
+  }
+
+  m_uiNumRefitsSinceBuild += uiNumMovedObjects;
+  m_auiMovedObjects.clear();
+}
+
+void Scene::buildBVH()
+{
+  // the bounded objects from the front of m_auiBVHObjects, the others from the back
+  uint32_t uiNumBounded   = 0;
+  uint32_t uiFirstUnbounded = m_uiNumObjects;
+
+  // a binary tree with a leaf per object at most has twice as many nodes.
+  // sized up front - building keeps references to the nodes.
+  m_aBVHNodes.resize( m_uiNumObjects * 2 );
+  m_aObjectBounds.resize( m_uiNumObjects );
+  m_auiBVHObjects.resize( m_uiNumObjects );
+  m_auiObjectLeaves.resize( m_uiNumObjects );
+  m_auiObjectLanes.resize( m_uiNumObjects );
+  m_auiObjectKernels.resize( m_uiNumObjects );
+  m_auiMovedObjects.reserve( m_uiNumObjects );
+
+  for ( uint32_t i = 0; i < m_uiNumObjects; i++ )
+  {
+    SceneObject* pObj = objectAt(i);
+
+    pObj->m_bMoved          = false;
+    m_auiObjectKernels[i]   = static_cast<uint8_t>( shapeKernel( *pObj ) );
+    m_auiObjectLeaves[i]    = kBVHInvalidNode;
+
+    if ( getPaddedBounds( *pObj, m_aObjectBounds[i] ) )
+    {
+      m_auiBVHObjects[uiNumBounded++] = i;
+    }
+    else
+    {
+      m_auiBVHObjects[--uiFirstUnbounded] = i;
+    }
+  }
+
+  // each leaf takes a block of 4 lanes and holds at least 1 object
+  m_uiNumLanes = 0;
+  m_auiLaneObjects.resize( (m_uiNumObjects + 2) * 4 );
+#if defined(LEAP_SCENE_SSE)
+  m_afShapeLanes.resize( m_auiLaneObjects.size() * kShapeChannels );
+#endif
+
+  m_uiNumBVHNodes = 0;
+
+  if ( uiNumBounded )
+  {
+    m_uiNumBVHNodes = 1;
+    m_aBVHNodes[0].m_uiParent = kBVHInvalidNode;
+    buildBVHNode( 0, 0, uiNumBounded );
+  }
+
+  // the objects without bounds in leaves of up to 4 objects of the same kernel
+  uint32_t* puiUnbounded = m_uiNumObjects ? &m_auiBVHObjects[uiFirstUnbounded] : NULL;
+  uint32_t  uiNumUnbounded = m_uiNumObjects - uiFirstUnbounded;
+
+  if ( uiNumUnbounded )
+  {
+    std::sort( puiUnbounded, puiUnbounded + uiNumUnbounded, KernelLess( &m_auiObjectKernels[0] ) );
+  }
+
+  m_aUnboundedLeaves.clear();
+
+  for ( uint32_t i = 0; i < uiNumUnbounded; )
+  {
+    uint32_t uiCount = 1;
+
+    while ( uiCount < 4 && i + uiCount < uiNumUnbounded &&
+            m_auiObjectKernels[puiUnbounded[i + uiCount]] == m_auiObjectKernels[puiUnbounded[i]] )
+    {
+      uiCount++;
+    }
+
+    BVHNode leaf;
+    leaf.m_uiParent = kBVHInvalidNode;
+    assignLeafLanes( leaf, kBVHInvalidNode, puiUnbounded + i, uiCount );
+    m_aUnboundedLeaves.push_back( leaf );
+
+    i += uiCount;
+  }
+
+  m_auiMovedObjects.clear();
+  m_uiNumRefitsSinceBuild = 0;
+  m_bRebuildBVH           = false;
+
+  if ( m_contactBroadPhase == kCBP_SpatialHash )
+  {
+    buildGrid();
+  }
+}
+
+void Scene::buildBVHNode( uint32_t uiNode, uint32_t uiFirst, uint32_t uiCount )
+{
+  BVHNode&    node        = m_aBVHNodes[uiNode];
+  uint32_t*   puiObjects  = &m_auiBVHObjects[uiFirst];
+  const Vector vFirstCenter = m_aObjectBounds[puiObjects[0]].GetCenter();
+  SceneBounds centers( vFirstCenter, vFirstCenter );
+  bool        bMixedKernels = false;
+
+  node.m_bounds = m_aObjectBounds[puiObjects[0]];
+
+  for ( uint32_t i = 1; i < uiCount; i++ )
+  {
+    const Vector vCenter = m_aObjectBounds[puiObjects[i]].GetCenter();
+
+    node.m_bounds.Merge( m_aObjectBounds[puiObjects[i]] );
+    centers.Merge( SceneBounds( vCenter, vCenter ) );
+    bMixedKernels = bMixedKernels || (m_auiObjectKernels[puiObjects[i]] != m_auiObjectKernels[puiObjects[0]]);
+  }
+
+  uint32_t uiSplit = uiCount / 2;
+
+  if ( bMixedKernels )
+  {
+    // different shapes go to different subtrees so that a leaf is tested by a single kernel.
+    // split at the change of kernel closest to the middle.
+    std::sort( puiObjects, puiObjects + uiCount, KernelLess( &m_auiObjectKernels[0] ) );
+
+    uint32_t uiBest = uiCount;
+
+    for ( uint32_t i = 1; i < uiCount; i++ )
+    {
+      if ( m_auiObjectKernels[puiObjects[i]] != m_auiObjectKernels[puiObjects[i - 1]] &&
+           (uiBest == uiCount || (i > uiSplit ? i - uiSplit : uiSplit - i) < (uiBest > uiSplit ? uiBest - uiSplit : uiSplit - uiBest)) )
+      {
+        uiBest = i;
+      }
+    }
+
+    uiSplit = uiBest;
+  }
+  else if ( uiCount <= static_cast<uint32_t>(kBVHLeafSize) )
+  {
+    assignLeafLanes( node, uiNode, puiObjects, uiCount );
+    return;
+  }
+  else
+  {
+    // split at the median of the centers along their longest extent
+    const Vector  vExtent = centers.m_vMax - centers.m_vMin;
+    unsigned int  uiAxis  = (vExtent.y > vExtent.x) ? 1 : 0;
+
+    uiAxis = (vExtent.z > vExtent[uiAxis]) ? 2 : uiAxis;
+
+    std::nth_element( puiObjects, puiObjects + uiSplit, puiObjects + uiCount, BoundsCenterLess( &m_aObjectBounds[0], uiAxis ) );
+  }
+
+  const uint32_t uiChild  = m_uiNumBVHNodes;
+
+  m_uiNumBVHNodes += 2;
+
+  node.m_uiFirst  = uiChild;
+  node.m_uiCount  = 0;
+
+  m_aBVHNodes[uiChild].m_uiParent     = uiNode;
+  m_aBVHNodes[uiChild + 1].m_uiParent = uiNode;
+
+  buildBVHNode( uiChild, uiFirst, uiSplit );
+  buildBVHNode( uiChild + 1, uiFirst + uiSplit, uiCount - uiSplit );
+}
+
+void Scene::assignLeafLanes( BVHNode& leaf, uint32_t uiNode, const uint32_t* puiObjects, uint32_t uiCount )
+{
+  leaf.m_uiFirst  = m_uiNumLanes;
+  leaf.m_uiCount  = static_cast<uint16_t>( uiCount );
+  leaf.m_uiKernel = m_auiObjectKernels[puiObjects[0]];
+
+  m_uiNumLanes += 4;
+
+  for ( uint32_t i = 0; i < uiCount; i++ )
+  {
+    const uint32_t idx = puiObjects[i];
+
+    m_auiLaneObjects[leaf.m_uiFirst + i] = idx;
+    m_auiObjectLanes[idx]   = leaf.m_uiFirst + i;
+    m_auiObjectLeaves[idx]  = uiNode;
+
+    writeShapeLane( idx );
+  }
+}
+
+void Scene::writeShapeLane( uint32_t idx )
+{
+#if defined(LEAP_SCENE_SSE)
+  const uint32_t    uiKernel  = m_auiObjectKernels[idx];
+
+  if ( uiKernel == kSK_Virtual )
+  {
+    return;
+  }
+
+  // channel c of lane l of a block is at c*4 + l
+  const uint32_t    uiLane    = m_auiObjectLanes[idx];
+  float*            pfLane    = &m_afShapeLanes[(uiLane & ~3u) * kShapeChannels + (uiLane & 3u)];
+  const SceneObject& object   = *objectAt(idx);
+  const Matrix&     mtx       = object.GetTransform();
+  const float       fScale    = object.GetScale();
+  const Vector*     apvBasis[4] = { &mtx.origin, &mtx.xBasis, &mtx.yBasis, &mtx.zBasis };
+
+  for ( int i = 0; i < 4; i++ )
+  {
+    pfLane[(kSC_CenterX + i*3) * 4] = apvBasis[i]->x;
+    pfLane[(kSC_CenterY + i*3) * 4] = apvBasis[i]->y;
+    pfLane[(kSC_CenterZ + i*3) * 4] = apvBasis[i]->z;
+  }
+
+  // the same scaled sizes as the virtual hit tests
+  switch ( uiKernel )
+  {
+    case kSK_Box:
+    {
+      const Vector vHalfSize = static_cast<const SceneBox&>(object).GetSize() * fScale * 0.5f;
+
+      pfLane[kSC_HalfSizeX * 4] = vHalfSize.x;
+      pfLane[kSC_HalfSizeY * 4] = vHalfSize.y;
+      pfLane[kSC_HalfSizeZ * 4] = vHalfSize.z;
+      break;
+    }
+
+    case kSK_Sphere:
+      pfLane[kSC_Radius * 4] = static_cast<const SceneSphere&>(object).GetRadius() * fScale;
+      break;
+
+    case kSK_Cylinder:
+      pfLane[kSC_Radius * 4]      = static_cast<const SceneCylinder&>(object).GetRadius() * fScale;
+      pfLane[kSC_HalfHeight * 4]  = static_cast<const SceneCylinder&>(object).GetHeight() * fScale * 0.5f;
+      break;
+
+    case kSK_Disk:
+      pfLane[kSC_Radius * 4] = static_cast<const SceneDisk&>(object).GetRadius() * fScale;
+      break;
+  }
+#else
+  (void)idx;
+#endif // LEAP_SCENE_SSE
+}
+
+bool Scene::refitBVHNode( uint32_t uiNode )
+{
+  BVHNode&    node = m_aBVHNodes[uiNode];
+  SceneBounds bounds;
+
+  if ( node.m_uiCount )
+  {
+    bounds = m_aObjectBounds[m_auiLaneObjects[node.m_uiFirst]];
+
+    for ( uint32_t i = node.m_uiFirst + 1, e = node.m_uiFirst + node.m_uiCount; i < e; i++ )
+    {
+      bounds.Merge( m_aObjectBounds[m_auiLaneObjects[i]] );
+    }
+  }
+  else
+  {
+    bounds = m_aBVHNodes[node.m_uiFirst].m_bounds;
+    bounds.Merge( m_aBVHNodes[node.m_uiFirst + 1].m_bounds );
+  }
+
+  if ( bounds == node.m_bounds )
+  {
+    return false;
+  }
+
+  node.m_bounds = bounds;
+  return true;
+}
+
+void Scene::testContactObject( uint32_t idx, const SceneContactPoint& testPoint )
+{
+#if defined(LEAP_SCENE_SSE)
+  // the lane of the object in the block of its leaf
+  const uint32_t uiKernel = m_auiObjectKernels[idx];
+
+  if ( uiKernel != kSK_Virtual )
+  {
+    const uint32_t  uiLane  = m_auiObjectLanes[idx];
+    const float*    pfBlock = &m_afShapeLanes[(uiLane & ~3u) * kShapeChannels];
+
+    if ( sphereHitShapes( uiKernel, pfBlock, testPoint.m_vPoint, m_fPointableRadius ) & (1 << (uiLane & 3u)) )
+    {
+      addContact( objectAt(idx), testPoint );
+    }
+
+    return;
+  }
+#endif // LEAP_SCENE_SSE
+
+  SceneObject* pObj = objectAt(idx);
+
+  if ( pObj->TestSphereHit( testPoint.m_vPoint, m_fPointableRadius ) )
+  {
+    addContact( pObj, testPoint );
+  }
+}
+
+bool Scene::updateGridContact( const SceneContactPoint& testPoint, const Vector* pvFrom )
+{
+  const Vector  vRadius( m_fPointableRadius, m_fPointableRadius, m_fPointableRadius );
+  SceneBounds   queryBounds( testPoint.m_vPoint - vRadius, testPoint.m_vPoint + vRadius );
+  GridRange     range;
+
+  if ( pvFrom )
+  {
+    queryBounds.Merge( SceneBounds( *pvFrom - vRadius, *pvFrom + vRadius ) );
+  }
+
+  getGridRange( queryBounds, range );
+
+  if ( range.GetNumCells() > static_cast<uint64_t>(kGridMaxQueryCells) )
+  {
+    return false;
+  }
+
+  for ( size_t i = 0; i < m_auiGridLargeObjects.size(); i++ )
+  {
+    if ( pvFrom )
+    {
+      testSweptContactObject( m_auiGridLargeObjects[i], *pvFrom, testPoint );
+    }
+    else
+    {
+      testContactObject( m_auiGridLargeObjects[i], testPoint );
+    }
+  }
+
+  // an object in several of the buckets of the query is tested once
+  if ( ++m_uiGridStamp == 0 )
+  {
+    m_auiGridStamps.assign( m_auiGridStamps.size(), 0 );
+    m_uiGridStamp = 1;
+  }
+
+  for ( int32_t z = range.m_aiMin[2]; z <= range.m_aiMax[2]; z++ )
+  {
+    for ( int32_t y = range.m_aiMin[1]; y <= range.m_aiMax[1]; y++ )
+    {
+      for ( int32_t x = range.m_aiMin[0]; x <= range.m_aiMax[0]; x++ )
+      {
+        uint32_t                      uiCell;
+        const std::vector<GridEntry>& bucket = getGridBucket( x, y, z, uiCell );
+
+        for ( size_t i = 0; i < bucket.size(); i++ )
+        {
+          const GridEntry&  entry = bucket[i];
+          const uint32_t    idx   = entry.m_uiObject;
+
+          if ( entry.m_uiCell != uiCell ||
+               !(pvFrom ? entry.m_bounds.TestBoundsHit( queryBounds ) : entry.m_bounds.TestSphereHit( testPoint.m_vPoint, m_fPointableRadius )) ||
+               m_auiGridStamps[idx] == m_uiGridStamp )
+          {
+            continue;
+          }
+
+          m_auiGridStamps[idx] = m_uiGridStamp;
+
+          if ( pvFrom )
+          {
+            testSweptContactObject( idx, *pvFrom, testPoint );
+          }
+          else
+          {
+            testContactObject( idx, testPoint );
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
 
-    if ( GetUpdateRayCast() && (m_uiNumRayHits < static_cast<uint32_t>(kMaxRayHits)) )
-    {
-      SceneRayHit&  rayHit    = m_aRayHits[m_uiNumRayHits];
+void Scene::buildGrid()
+{
+  float fCellSize = m_fContactCellSize;
 
-      rayHit.m_ray            = SceneRay( vPos, TransformFrameDirection( pointable.direction() ) );
-      rayHit.m_iPointableID   = iPointableID;
+  // the mean largest extent of the objects, so that most objects cover few cells
+  if ( fCellSize <= 0.0f )
+  {
+    float     fSumExtents   = 0.0f;
+    uint32_t  uiNumBounded  = 0;
 
-      if ( testRayHitClosest( rayHit ) )
+    for ( uint32_t i = 0; i < m_uiNumObjects; i++ )
+    {
+      if ( m_auiObjectLeaves[i] != kBVHInvalidNode )
       {
-        m_uiNumRayHits++;
+        fSumExtents += MaxComponent( m_aObjectBounds[i].m_vMax - m_aObjectBounds[i].m_vMin );
+        uiNumBounded++;
       }
     }
 
-    if ( GetUpdateContact() )
-    {
-      updateContact( SceneContactPoint( vPos, iPointableID ) );
-    }
+    fCellSize = std::max( uiNumBounded ? fSumExtents / uiNumBounded : 0.0f, 2.0f * m_fPointableRadius );
   }
-}
 
-void Scene::updateInteraction( const Frame& frame )
-{
-  static const uint8_t kMaxContactMissedFrames = 64;
+  m_fGridInvCellSize = (fCellSize > kfEpsilon) ? 1.0f / fCellSize : 1.0f;
 
-  (void)frame;
+  // about 2 buckets per object
+  size_t uiNumBuckets = kGridMinBuckets;
 
-  for (size_t i=0; i < m_uiNumObjects; i++)
+  while ( uiNumBuckets < 2 * static_cast<size_t>(m_uiNumObjects) )
   {
-    const SceneObjectPtr& pObj = m_apObjects[i];
+    uiNumBuckets *= 2;
+  }
 
-    if (!pObj->HasInitialContact() && pObj->GetNumContacts() == 0 && pObj->GetNumPointing() == 0)
-    {
-      pObj->m_fTotalHitTime = 0.0f;
-    }
-    /// selection state change from not selected to selected
-    else if ( !pObj->IsSelected() && pObj->m_fTotalHitTime >= m_fSelectHitTime )
+  m_aaGridBuckets.resize( uiNumBuckets );
+
+  for ( size_t i = 0; i < uiNumBuckets; i++ )
+  {
+    m_aaGridBuckets[i].clear();
+  }
+
+  m_auiGridLargeObjects.clear();
+  m_aGridRanges.resize( m_uiNumObjects );
+  m_auiGridStamps.assign( m_uiNumObjects, 0 );
+  m_uiGridStamp = 0;
+
+  for ( uint32_t i = 0; i < m_uiNumObjects; i++ )
+  {
+    if ( m_auiObjectLeaves[i] != kBVHInvalidNode )
     {
-      SceneInteraction selection;
-      selection.m_uiFlags = kIT_SelectionChange | kIT_IsSelected;
-      selection.m_pObject = pObj;
-      queueInteraction( selection );
+      getGridRange( m_aObjectBounds[i], m_aGridRanges[i] );
+      insertGridObject( i );
     }
-    /// possible manipulation
-    else if ( pObj->IsSelected() )
-    {
-
-      if ( pObj->HasInitialContact() )
-      {
-        const SceneContactPoint& initContact  = pObj->m_initialContactPoint;
-        Leap::Pointable contactPointable      = frame.pointable(initContact.m_iPointableID);
+  }
+}
 
-        if ( contactPointable.isValid() )
-        {
-            const Vector      vPointablePos  = TransformFramePoint(contactPointable.tipPosition());
-            const Vector      vTrans         = (vPointablePos - pObj->GetCenter());
-            SceneInteraction  translation;
+void Scene::moveGridObject( uint32_t idx )
+{
+  GridRange range;
 
-            translation.m_mtxTransform.origin = vTrans;
-            translation.m_uiFlags |= kIT_Translation;
-            translation.m_pObject = pObj;
+  getGridRange( m_aObjectBounds[idx], range );
 
-            queueInteraction( translation );
+  if ( range != m_aGridRanges[idx] )
+  {
+    removeGridObject( idx );
+    m_aGridRanges[idx] = range;
+    insertGridObject( idx );
+    return;
+  }
 
-            pObj->m_uiHasInitialContact = kMaxContactMissedFrames;
-        }
-        else
-        {
-          pObj->m_uiHasInitialContact--;
+  // most moves stay within the same cells - only the bounds of the entries change
+  if ( range.GetNumCells() > static_cast<uint64_t>(kGridMaxObjectCells) )
+  {
+    return;
+  }
 
-          if ( !pObj->m_uiLastNumContacts )
-          {
-            pObj->ClearHits();
-          }
-        }
-      }
-      else
+  for ( int32_t z = range.m_aiMin[2]; z <= range.m_aiMax[2]; z++ )
+  {
+    for ( int32_t y = range.m_aiMin[1]; y <= range.m_aiMax[1]; y++ )
+    {
+      for ( int32_t x = range.m_aiMin[0]; x <= range.m_aiMax[0]; x++ )
       {
-        if ( pObj->GetNumContacts()  )
-        {
-          pObj->m_initialContactPoint = *(pObj->GetContactPoint(0));
-          pObj->m_initialContactPoint.m_vPoint -= pObj->GetCenter();
-          pObj->m_uiHasInitialContact = kMaxContactMissedFrames;
-        }
-        else if ( pObj->GetLastNumContacts() )
+        if ( GridEntry* pEntry = findGridEntry( x, y, z, idx ) )
         {
-          pObj->m_initialContactPoint = *(pObj->GetLastContactPoint(0));
-          pObj->m_initialContactPoint.m_vPoint -= pObj->GetCenter();
-          pObj->m_uiHasInitialContact = kMaxContactMissedFrames;
+          pEntry->m_bounds = m_aObjectBounds[idx];
         }
       }
+    }
+  }
+}
 
-      /// multi touch
-      if (pObj->GetLastNumContacts() >= 2 && pObj->GetNumContacts() >= 2)
-      {
-        const SceneContactPoint&  lastContact0  = *(pObj->GetLastContactPoint(0));
-        const SceneContactPoint&  lastContact1  = *(pObj->GetLastContactPoint(1));
-        const SceneContactPoint*  pCurContact0  = pObj->GetContactPointByPointableID( lastContact0.m_iPointableID );
-        const SceneContactPoint*  pCurContact1  = pObj->GetContactPointByPointableID( lastContact1.m_iPointableID );
+void Scene::insertGridObject( uint32_t idx )
+{
+  const GridRange& range = m_aGridRanges[idx];
 
-        if ( pCurContact0 && pCurContact1 )
-        {
-          const Vector lastVec = (lastContact1.m_vPoint - lastContact0.m_vPoint);
-          const Vector newVec = (pCurContact1->m_vPoint - pCurContact0->m_vPoint);
+  if ( range.GetNumCells() > static_cast<uint64_t>(kGridMaxObjectCells) )
+  {
+    m_auiGridLargeObjects.push_back( idx );
+    return;
+  }
 
-          if ( !IsNearEqual(lastVec, newVec) && !IsNearZero(lastVec) )
-          {
-            const float   fLastDist = lastVec.magnitude();
-            const float   fNewDist  = newVec.magnitude();
-            /// scale by change in pinch distance
-            const float   fScale    = fNewDist/fLastDist;
+  GridEntry entry;
 
-            /// rotate by tilt of fingers
-            const Vector  vLastDir  = lastVec * 1.0f/fLastDist;
-            const Vector  vNewDir   = newVec  * 1.0f/fNewDist;
+  entry.m_bounds    = m_aObjectBounds[idx];
+  entry.m_uiObject  = idx;
 
-            const Vector  vAxis     = vNewDir.cross(vLastDir);
-            const float   fAngle    = acosf( vNewDir.dot(vLastDir) );
+  for ( int32_t z = range.m_aiMin[2]; z <= range.m_aiMax[2]; z++ )
+  {
+    for ( int32_t y = range.m_aiMin[1]; y <= range.m_aiMax[1]; y++ )
+    {
+      for ( int32_t x = range.m_aiMin[0]; x <= range.m_aiMax[0]; x++ )
+      {
+        getGridBucket( x, y, z, entry.m_uiCell ).push_back( entry );
+      }
+    }
+  }
+}
 
-            /// translate by average movement
-            const Vector  vTrans    = ( (pCurContact0->m_vPoint - lastContact0.m_vPoint) +
-                                        (pCurContact1->m_vPoint - lastContact1.m_vPoint) ) * 0.5f;
+void Scene::removeGridObject( uint32_t idx )
+{
+  const GridRange& range = m_aGridRanges[idx];
 
-            SceneInteraction interaction;
+  if ( range.GetNumCells() > static_cast<uint64_t>(kGridMaxObjectCells) )
+  {
+    std::vector<uint32_t>::iterator it = std::find( m_auiGridLargeObjects.begin(), m_auiGridLargeObjects.end(), idx );
 
-            if ( !IsNearZero(fAngle) )
-            {
-              interaction.m_mtxTransform.setRotation( vAxis, fAngle );
-              interaction.m_uiFlags |= kIT_Rotation;
-            }
+    if ( it != m_auiGridLargeObjects.end() )
+    {
+      *it = m_auiGridLargeObjects.back();
+      m_auiGridLargeObjects.pop_back();
+    }
 
-            if ( !IsNearEqual(fScale, 1.0f) )
-            {
-              interaction.m_fScale = fScale;
-              interaction.m_uiFlags |= kIT_Scale;
-            }
+    return;
+  }
 
-            if ( !IsNearZero( vTrans ) )
-            {
-              interaction.m_mtxTransform.origin = vTrans;
-              interaction.m_uiFlags |= kIT_Translation;
-            }
+  for ( int32_t z = range.m_aiMin[2]; z <= range.m_aiMax[2]; z++ )
+  {
+    for ( int32_t y = range.m_aiMin[1]; y <= range.m_aiMax[1]; y++ )
+    {
+      for ( int32_t x = range.m_aiMin[0]; x <= range.m_aiMax[0]; x++ )
+      {
+        uint32_t                uiCell;
+        std::vector<GridEntry>& bucket = getGridBucket( x, y, z, uiCell );
 
-            if ( interaction.m_uiFlags )
-            {
-              interaction.m_pObject = pObj;
-              queueInteraction( interaction );
-            }
-          }
+        if ( GridEntry* pEntry = findGridEntry( x, y, z, idx ) )
+        {
+          *pEntry = bucket.back();
+          bucket.pop_back();
         }
       }
     }
-
-    pObj->rotateContactPoints();
-    pObj->m_uiNumPointing = 0;
   }
 }
 
-void Scene::processPendingRemovals()
+void Scene::getGridRange( const SceneBounds& bounds, GridRange& rangeOut ) const
 {
-  for ( uint32_t i = 0; (i < m_uiNumObjects) && m_uiNumPendingRemovals; m_uiNumPendingRemovals-- )
+  for ( unsigned int i = 0; i < 3; i++ )
   {
-    if ( m_apObjects[i]->m_bPendingRemoval )
-    {
-      deallocateObject( i );
-    }
-    else
-    {
-      i++;
-    }
+    rangeOut.m_aiMin[i] = gridCoord( bounds.m_vMin[i], m_fGridInvCellSize );
+    rangeOut.m_aiMax[i] = gridCoord( bounds.m_vMax[i], m_fGridInvCellSize );
   }
 }
 
-void Scene::queueDeselectAll()
+std::vector<Scene::GridEntry>& Scene::getGridBucket( int32_t x, int32_t y, int32_t z, uint32_t& uiCellOut )
 {
-  SceneInteraction deselection;
-  deselection.m_uiFlags = kIT_SelectionChange;
+  uiCellOut = (static_cast<uint32_t>(x) * 73856093u) ^
+              (static_cast<uint32_t>(y) * 19349663u) ^
+              (static_cast<uint32_t>(z) * 83492791u);
 
-  for (size_t i=0; i < m_uiNumObjects; i++)
+  return m_aaGridBuckets[uiCellOut & (m_aaGridBuckets.size() - 1)];
+}
+
+Scene::GridEntry* Scene::findGridEntry( int32_t x, int32_t y, int32_t z, uint32_t idx )
+{
+  uint32_t                uiCell;
+  std::vector<GridEntry>& bucket = getGridBucket( x, y, z, uiCell );
+
+  for ( size_t i = 0; i < bucket.size(); i++ )
   {
-    if ( m_apObjects[i]->IsSelected() )
+    if ( bucket[i].m_uiObject == idx && bucket[i].m_uiCell == uiCell )
     {
-      deselection.m_pObject = m_apObjects[i];
-      queueInteraction( deselection );
+      return &bucket[i];
     }
   }
+
+  return NULL;
 }
 
 //************************************
@@ -453,6 +1898,70 @@ void SceneRayHit::DebugDrawGL( float fHitSphereSize ) const
 //
 //************************************
 
+bool SceneObject::TestSweptSphereHit(const Vector& vFrom, const Vector& vTo, float fTestRadius, float& fTimeOut) const
+{
+  static const float    kfMaxSteps      = 256.0f;
+  static const uint32_t kNumBisections  = 16;
+
+  const SceneRay  sweep( vFrom, vTo - vFrom );
+  float           fEnter  = 0.0f;
+  float           fExit   = 1.0f;
+  SceneBounds     bounds;
+
+  // only the part of the motion within reach of the bounds
+  if ( GetBounds( bounds ) )
+  {
+    const Vector vRadius( fTestRadius, fTestRadius, fTestRadius );
+
+    bounds = SceneBounds( bounds.m_vMin - vRadius, bounds.m_vMax + vRadius );
+
+    if ( !rayHitsBounds( sweep, ComponentWiseReciprocal( sweep.m_vDirection ), bounds, 1.0f, fEnter, &fExit ) )
+    {
+      return false;
+    }
+  }
+
+  // steps of half a radius - a shape the center of the sphere passes through is touched by a step.
+  const float     fLength     = sweep.m_vDirection.magnitude() * (fExit - fEnter);
+  const float     fNumSteps   = (fTestRadius > 0.0f) ? ceilf( fLength / (0.5f * fTestRadius) ) : kfMaxSteps;
+  const uint32_t  uiNumSteps  = static_cast<uint32_t>( LeapUtil::Clamp( fNumSteps, 1.0f, kfMaxSteps ) );
+
+  for ( uint32_t i = 0; i <= uiNumSteps; i++ )
+  {
+    float fHit = fEnter + (fExit - fEnter) * i / uiNumSteps;
+
+    if ( !TestSphereHit( sweep.CalcPointOn( fHit ), fTestRadius ) )
+    {
+      continue;
+    }
+
+    // the first touch is between the previous step and this one
+    if ( i )
+    {
+      float fMiss = fEnter + (fExit - fEnter) * (i - 1) / uiNumSteps;
+
+      for ( uint32_t j = 0; j < kNumBisections; j++ )
+      {
+        const float fMid = (fMiss + fHit) * 0.5f;
+
+        if ( TestSphereHit( sweep.CalcPointOn( fMid ), fTestRadius ) )
+        {
+          fHit = fMid;
+        }
+        else
+        {
+          fMiss = fMid;
+        }
+      }
+    }
+
+    fTimeOut = fHit;
+    return true;
+  }
+
+  return false;
+}
+
 bool SceneBox::TestRayHit(const SceneRay& testRay, float& fHitDistOut) const
 {
   // by converting the test ray to object space the test is vs. an axis-aligned
@@ -498,6 +2007,19 @@ bool SceneBox::TestSphereHit(const Vector& vTestPoint, float fTestRadius) const
             ComponentWiseMax(vPos - vMax, Vector::zero()).magnitudeSquared() ) <= fTestRadius*fTestRadius;
 }
 
+bool SceneBox::GetBounds(SceneBounds& boundsOut) const
+{
+  // each half size of the box spans its basis vector - summed along each scene axis
+  const Vector  vHalfSize = GetSize() * fabs(m_fScale) * 0.5f;
+  const Matrix& mtx       = m_mtxTransform;
+  const Vector  vExtent(  fabs(mtx.xBasis.x) * vHalfSize.x + fabs(mtx.yBasis.x) * vHalfSize.y + fabs(mtx.zBasis.x) * vHalfSize.z,
+                          fabs(mtx.xBasis.y) * vHalfSize.x + fabs(mtx.yBasis.y) * vHalfSize.y + fabs(mtx.zBasis.y) * vHalfSize.z,
+                          fabs(mtx.xBasis.z) * vHalfSize.x + fabs(mtx.yBasis.z) * vHalfSize.y + fabs(mtx.zBasis.z) * vHalfSize.z );
+
+  boundsOut = SceneBounds( GetCenter() - vExtent, GetCenter() + vExtent );
+  return true;
+}
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
 void SceneBox::DebugDrawGL( eStyle drawStyle ) const
 {
@@ -623,6 +2145,20 @@ bool SceneCylinder::TestSphereHit(const Vector& vTestPoint, float fTestRadius) c
   return false;
 }
 
+bool SceneCylinder::GetBounds(SceneBounds& boundsOut) const
+{
+  // the half height along the axis plus the extent of the end caps
+  const Vector& vAxis         = GetAxis();
+  const float   fRadius       = fabs(m_fScale * m_fRadius);
+  const float   fHalfHeight   = fabs(m_fScale * m_fHeight) * 0.5f;
+  const Vector  vExtent(  fabs(vAxis.x) * fHalfHeight + diskExtent(fRadius, vAxis.x),
+                          fabs(vAxis.y) * fHalfHeight + diskExtent(fRadius, vAxis.y),
+                          fabs(vAxis.z) * fHalfHeight + diskExtent(fRadius, vAxis.z) );
+
+  boundsOut = SceneBounds( GetCenter() - vExtent, GetCenter() + vExtent );
+  return true;
+}
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
 void SceneCylinder::DebugDrawGL( eStyle drawStyle ) const
 {
@@ -722,6 +2258,16 @@ bool SceneDisk::TestSphereHit(const Vector& vTestPoint, float fTestRadius) const
   return false;
 }
 
+bool SceneDisk::GetBounds(SceneBounds& boundsOut) const
+{
+  const Vector& vNormal = GetNormal();
+  const float   fRadius = fabs(m_fScale * m_fRadius);
+  const Vector  vExtent( diskExtent(fRadius, vNormal.x), diskExtent(fRadius, vNormal.y), diskExtent(fRadius, vNormal.z) );
+
+  boundsOut = SceneBounds( GetCenter() - vExtent, GetCenter() + vExtent );
+  return true;
+}
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
 void SceneDisk::DebugDrawGL( eStyle drawStyle ) const
 {
@@ -781,6 +2327,30 @@ bool ScenePlane::TestSphereHit(const Vector& vTestPoint, float fTestRadius) cons
   return fabs((vTestPoint - GetCenter()).dot(GetNormal())) < fTestRadius;
 }
 
+bool ScenePlane::TestSweptSphereHit(const Vector& vFrom, const Vector& vTo, float fTestRadius, float& fTimeOut) const
+{
+  // signed distances to the plane at both ends of the motion
+  const float fFrom = (vFrom - GetCenter()).dot(GetNormal());
+  const float fTo   = (vTo - GetCenter()).dot(GetNormal());
+
+  if (fabs(fFrom) < fTestRadius)
+  {
+    fTimeOut = 0.0f;
+    return true;
+  }
+
+  // the distance at which the sphere touches the plane on the side it comes from
+  const float fReach = (fFrom > 0) ? fTestRadius : -fTestRadius;
+
+  if ((fFrom > 0) ? (fTo >= fReach) : (fTo <= fReach))
+  {
+    return false;
+  }
+
+  fTimeOut = (fFrom - fReach) / (fFrom - fTo);
+  return true;
+}
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
 void ScenePlane::DebugDrawGL( eStyle drawStyle ) const
 {
@@ -825,6 +2395,50 @@ bool SceneSphere::TestSphereHit(const Vector& vTestPoint, float fTestRadius) con
   return (GetCenter() - vTestPoint).magnitudeSquared() < (fMaxDist * fMaxDist);
 }
 
+bool SceneSphere::TestSweptSphereHit(const Vector& vFrom, const Vector& vTo, float fTestRadius, float& fTimeOut) const
+{
+  // the motion as a ray against a sphere grown by the test radius
+  const float   fMaxDist  = (m_fScale*m_fRadius + fTestRadius);
+  const Vector  vSweep    = vTo - vFrom;
+  const Vector  O         = vFrom - GetCenter();
+  const float   a         = vSweep.dot(vSweep);
+  const float   b         = O.dot(vSweep);
+  const float   c         = O.dot(O) - fMaxDist*fMaxDist;
+
+  if (c < 0)
+  {
+    fTimeOut = 0.0f;
+    return true;
+  }
+
+  const float   disc      = b*b - a*c;
+
+  // moving away or passing by
+  if (b >= 0 || disc <= 0)
+  {
+    return false;
+  }
+
+  const float   t         = (-b - sqrtf(disc)) / a;
+
+  if (t < 1)
+  {
+    fTimeOut = t;
+    return true;
+  }
+
+  return false;
+}
+
+bool SceneSphere::GetBounds(SceneBounds& boundsOut) const
+{
+  const float   fRadius = fabs(m_fScale * m_fRadius);
+  const Vector  vExtent( fRadius, fRadius, fRadius );
+
+  boundsOut = SceneBounds( GetCenter() - vExtent, GetCenter() + vExtent );
+  return true;
+}
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
 void SceneSphere::DebugDrawGL( eStyle drawStyle ) const
 {
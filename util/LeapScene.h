@@ -12,6 +12,8 @@
 #include "Leap.h"
 #include "LeapUtil.h"
 
+#include <vector>
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
   #include "LeapUtilGL.h"
 #endif
@@ -76,6 +78,46 @@ struct SceneRay
   Vector  m_vDirection;
 };
 
+/// axis-aligned bounds of a scene object in scene space.
+/// the scene keeps them in a bounding volume hierarchy to skip the objects
+/// that a ray or a contact sphere can not reach.
+struct SceneBounds
+{
+  SceneBounds() {}
+
+  SceneBounds( const Vector& vMin, const Vector& vMax ) : m_vMin( vMin ), m_vMax( vMax ) {}
+
+  /// grows the bounds to contain the other bounds
+  void Merge( const SceneBounds& other )
+  {
+    m_vMin = LeapUtil::ComponentWiseMin( m_vMin, other.m_vMin );
+    m_vMax = LeapUtil::ComponentWiseMax( m_vMax, other.m_vMax );
+  }
+
+  Vector GetCenter() const { return (m_vMin + m_vMax) * 0.5f; }
+
+  bool operator==( const SceneBounds& other ) const { return m_vMin == other.m_vMin && m_vMax == other.m_vMax; }
+
+  bool operator!=( const SceneBounds& other ) const { return !(*this == other); }
+
+  /// true if the bounds overlap other bounds
+  bool TestBoundsHit( const SceneBounds& other ) const
+  {
+    return  m_vMin.x <= other.m_vMax.x && m_vMin.y <= other.m_vMax.y && m_vMin.z <= other.m_vMax.z &&
+            other.m_vMin.x <= m_vMax.x && other.m_vMin.y <= m_vMax.y && other.m_vMin.z <= m_vMax.z;
+  }
+
+  /// true if a sphere touches the bounds
+  bool TestSphereHit( const Vector& vTestPoint, float fTestRadius ) const
+  {
+    return  ( LeapUtil::ComponentWiseMin(vTestPoint - m_vMin, Vector::zero()).magnitudeSquared() +
+              LeapUtil::ComponentWiseMax(vTestPoint - m_vMax, Vector::zero()).magnitudeSquared() ) <= fTestRadius*fTestRadius;
+  }
+
+  Vector  m_vMin;
+  Vector  m_vMax;
+};
+
 /// stores the result of a ray test that hit something
 struct SceneRayHit
 {
@@ -159,37 +201,72 @@ private:
 };
 
 /// contact point between a pointable (finger or tool) and a scene object.
+/// m_vPoint is the position of the pointable in the frame of the contact.
+/// with swept contact (see Scene::SetSweptContact()) the pointable may have touched the object
+/// earlier in its motion since the previous frame: m_fTimeOfImpact is the fraction of that motion
+/// at which it first touched it and m_vImpactPoint the position of the pointable then.
+/// contacts found at the position of the frame only have a time of impact of 1.
 struct SceneContactPoint
 {
-  SceneContactPoint() : m_iPointableID(-1) {}
-  SceneContactPoint( const Vector& vPoint, int iPointableID ) : m_vPoint( vPoint ), m_iPointableID( iPointableID ) {}
+  SceneContactPoint() : m_iPointableID(-1), m_fTimeOfImpact(1.0f) {}
+  SceneContactPoint( const Vector& vPoint, int iPointableID )
+    : m_vPoint( vPoint ), m_vImpactPoint( vPoint ), m_iPointableID( iPointableID ), m_fTimeOfImpact( 1.0f ) {}
   Vector  m_vPoint;
+  Vector  m_vImpactPoint;
   int     m_iPointableID;
+  float   m_fTimeOfImpact;
+};
+
+/// identifies a scene object for as long as it belongs to its scene.
+/// unlike its index, the handle of an object does not change when other objects are removed,
+/// and the handle of a removed object never refers to another object.
+/// a default constructed handle is invalid.
+struct SceneObjectHandle
+{
+  SceneObjectHandle() : m_uiSlot( 0 ), m_uiGeneration( 0 ) {}
+
+  SceneObjectHandle( uint32_t uiSlot, uint32_t uiGeneration ) : m_uiSlot( uiSlot ), m_uiGeneration( uiGeneration ) {}
+
+  bool IsValid() const { return m_uiGeneration != 0; }
+
+  bool operator==( const SceneObjectHandle& other ) const { return m_uiSlot == other.m_uiSlot && m_uiGeneration == other.m_uiGeneration; }
+
+  bool operator!=( const SceneObjectHandle& other ) const { return !(*this == other); }
+
+  uint32_t  m_uiSlot;
+  uint32_t  m_uiGeneration;
 };
 
 /// scene manages scene objects - handles selection and movement
 class LEAP_EXPORT_CLASS Scene
 {
+  friend class SceneObject;
+
 public:
   enum eFlag
   {
     kF_UpdateRayCast = 1 << 0,
-    kF_UpdateContact = 1 << 1
+    kF_UpdateContact = 1 << 1,
+    kF_SweptContact  = 1 << 2
+  };
+
+  /// broad-phases finding the objects a pointable sphere may touch
+  enum eContactBroadPhase
+  {
+    kCBP_BoundingVolumes,   ///< the bounding volume hierarchy of the ray casts (the default)
+    kCBP_SpatialHash        ///< a uniform grid of hashed cells - suited to many objects of similar size spread evenly
   };
 
   enum
   {
-    kMaxObjects             = 512,
+    kObjectChunkSize        = 256,
     kMaxRayHits             = 32,
     kInteractionQueueLength = 32
   };
 
   LEAP_EXPORT Scene();
 
-  LEAP_EXPORT virtual ~Scene()
-  {
-    Reset();
-  }
+  LEAP_EXPORT virtual ~Scene();
 
   /// AddObject allocates new objects and add them to the list of scene children to manage.
   /// raw pointers are returned for convenience.  use SceneObjectPtr type when storing scene object
@@ -219,9 +296,21 @@ public:
   LEAP_EXPORT void RayHitsDebugDrawGL() const;
 #endif
 
+  /// the index of an object changes when another object is removed.  use handles to refer to an object over time.
   const SceneObjectPtr& GetObjectByIndex( int idx ) const
   {
-    return (static_cast<uint32_t>(idx) < m_uiNumObjects) ? m_apObjects[idx] : SceneObjectPtr::Null();
+    return (static_cast<uint32_t>(idx) < m_uiNumObjects) ? objectAt(idx) : SceneObjectPtr::Null();
+  }
+
+  /// returns the object of a handle, or a null pointer if the object was removed since.
+  const SceneObjectPtr& GetObjectByHandle( const SceneObjectHandle& handle ) const
+  {
+    if ( handle.m_uiSlot < m_aSlots.size() && m_aSlots[handle.m_uiSlot].m_uiGeneration == handle.m_uiGeneration )
+    {
+      return objectAt( m_aSlots[handle.m_uiSlot].m_uiIndex );
+    }
+
+    return SceneObjectPtr::Null();
   }
 
   uint32_t GetNumObjects() const { return m_uiNumObjects; }
@@ -229,6 +318,10 @@ public:
   /// allows for casting an arbitrary ray and finding out what it hits (if anything)
   const SceneObjectPtr& TestRayHit( const SceneRay& ray ) const;
 
+  /// allows for testing an arbitrary sphere of the pointable radius for contact, swept from *pvFrom if it is not NULL.
+  /// contacts are added to the objects it touches as Update() does for the pointables.
+  LEAP_EXPORT void TestContact( const SceneContactPoint& testPoint, const Vector* pvFrom = NULL );
+
   /// processes pending removals
   /// clears ray hit results and queued interactions from previous frame
   /// caches ray hits from finger/tool (pointable) pointing.
@@ -262,6 +355,25 @@ public:
 
   float GetPointableRadius() const { return m_fPointableRadius; }
 
+  /// selects the broad-phase of the contact tests.  both report the same contacts.
+  void SetContactBroadPhase( eContactBroadPhase broadPhase )
+  {
+    m_bRebuildBVH = m_bRebuildBVH || (broadPhase != m_contactBroadPhase);
+    m_contactBroadPhase = broadPhase;
+  }
+
+  eContactBroadPhase GetContactBroadPhase() const { return m_contactBroadPhase; }
+
+  /// size of the cells of the spatial hash, in scene units.
+  /// 0 (the default) picks the mean size of the objects, at least the pointable diameter.
+  void SetContactCellSize( float fCellSize )
+  {
+    m_bRebuildBVH = m_bRebuildBVH || (fCellSize != m_fContactCellSize);
+    m_fContactCellSize = fCellSize;
+  }
+
+  float GetContactCellSize() const { return m_fContactCellSize; }
+
   /// the amount of time an object must be pointed at or touched before it is selected
   void SetSelectHitTime( float fSelectHitTime ) { m_fSelectHitTime = fSelectHitTime; }
 
@@ -315,6 +427,16 @@ public:
     m_uiFlags = bUpdateContact ? (m_uiFlags | kF_UpdateContact) : (m_uiFlags & ~kF_UpdateContact);
   }
 
+  /// swept contact tests the whole motion of each pointable sphere since the previous frame
+  /// instead of its position in the current frame only, so that a fast pointable does not pass
+  /// through thin objects between two frames.  off by default.
+  bool GetSweptContact() const { return (m_uiFlags & kF_SweptContact) != 0; }
+
+  void SetSweptContact( bool bSweptContact )
+  {
+    m_uiFlags = bSweptContact ? (m_uiFlags | kF_SweptContact) : (m_uiFlags & ~kF_SweptContact);
+  }
+
   bool GetUpdateRayCast() const { return (m_uiFlags & kF_UpdateRayCast) != 0; }
 
   void SetUpdateRayCast( bool bUpdateRayCast )
@@ -360,27 +482,111 @@ private:
 
   void updateContact( const SceneContactPoint& testPoint );
 
+  /// finds the closest object hit by a ray, returns its index or -1.
+  /// the bounding volume hierarchy has to be up to date.
+  int findRayHitClosest( const SceneRay& ray, float& fHitDistOut ) const;
+
+  struct BVHNode;
+
+  /// adds a contact to the objects of a leaf touched by the contact sphere
+  void testContactLeaf( const BVHNode& leaf, const SceneContactPoint& testPoint );
+
+  /// keeps the object of a leaf hit first by the ray if it is hit before the closest hit so far
+  void testRayHitLeaf( const BVHNode& leaf, const SceneRay& ray, float& fClosestHitDist, int& closestHitIndex ) const;
+
+  void addContact( SceneObject* pObj, const SceneContactPoint& testPoint );
+
+  /// called by SceneObject::InvalidateBounds() the first time an object moves since the last update of the hierarchy
+  void objectMoved( uint32_t idx )
+  {
+    // a rebuild refits every object anyway
+    if ( !m_bRebuildBVH )
+    {
+      m_auiMovedObjects.push_back( idx );
+    }
+  }
+
+  /// refits the hierarchy to the objects that moved, or rebuilds it when objects were added or removed.
+  /// the spatial hash follows in kCBP_SpatialHash mode.
+  void updateBVH();
+
+  void buildBVH();
+
+  /// builds the subtree of a node over uiCount entries of m_auiBVHObjects from uiFirst
+  void buildBVHNode( uint32_t uiNode, uint32_t uiFirst, uint32_t uiCount );
+
+  /// gives a leaf the next block of 4 lanes and puts uiCount objects of the same shape kernel in it
+  void assignLeafLanes( BVHNode& leaf, uint32_t uiNode, const uint32_t* puiObjects, uint32_t uiCount );
+
+  /// copies the scene space shape of an object to its lane for the batched hit tests
+  void writeShapeLane( uint32_t idx );
+
+  /// recomputes the bounds of a node from its children or objects, returns true if they changed
+  bool refitBVHNode( uint32_t uiNode );
+
+  struct GridRange;
+  struct GridEntry;
+
+  /// adds a contact to an object touched by the contact sphere
+  void testContactObject( uint32_t idx, const SceneContactPoint& testPoint );
+
+  /// contact of the sphere swept from vFrom to the contact point
+  void updateSweptContact( const Vector& vFrom, const SceneContactPoint& testPoint );
+
+  /// adds a contact to an object touched by the swept sphere, at its time of impact
+  void testSweptContactObject( uint32_t idx, const Vector& vFrom, const SceneContactPoint& testPoint );
+
+  /// contact through the spatial hash, swept from *pvFrom if it is not NULL.
+  /// returns false if the sphere covers too many cells to be worth it.
+  bool updateGridContact( const SceneContactPoint& testPoint, const Vector* pvFrom );
+
+  /// puts the bounded objects in the cells of the spatial hash, after a build of the hierarchy
+  void buildGrid();
+
+  /// moves an object whose bounds changed to the cells of its new bounds
+  void moveGridObject( uint32_t idx );
+
+  void insertGridObject( uint32_t idx );
+
+  void removeGridObject( uint32_t idx );
+
+  /// the cells covered by bounds
+  void getGridRange( const SceneBounds& bounds, GridRange& rangeOut ) const;
+
+  /// the bucket of a cell and the full hash of the cell
+  std::vector<GridEntry>& getGridBucket( int32_t x, int32_t y, int32_t z, uint32_t& uiCellOut );
+
+  /// the entry of an object in the bucket of a cell, NULL if it is not there
+  GridEntry* findGridEntry( int32_t x, int32_t y, int32_t z, uint32_t idx );
+
   template<class T>
   T* allocateObject()
   {
-    if ( m_uiNumObjects < static_cast<uint32_t>(kMaxObjects) )
-    {
-      if ( T* pObject = new T() )
-      {
-        pObject->m_pScene           = this;
-        pObject->m_serial           = m_uiNextSerial++;
-        pObject->m_index            = static_cast<uint16_t>(m_uiNumObjects);
-        m_apObjects[m_uiNumObjects++] = SceneObjectPtr(pObject);
+    T* pObject = new T();
 
-        return pObject;
-      }
-    }
+    addObject( pObject );
 
-    return NULL;
+    return pObject;
   }
 
+  /// takes ownership of a newly allocated object and gives it the next index and a handle
+  void addObject( SceneObject* pObject );
+
   void deallocateObject( uint32_t idxToRemove );
 
+  SceneObjectHandle allocateHandle( uint32_t idx );
+
+  void freeHandle( const SceneObjectHandle& handle );
+
+  /// objects are stored in chunks of kObjectChunkSize so that growing the scene never moves them.
+  SceneObjectPtr& objectAt( uint32_t idx ) { return m_apObjectChunks[idx / kObjectChunkSize][idx % kObjectChunkSize]; }
+
+  const SceneObjectPtr& objectAt( uint32_t idx ) const { return m_apObjectChunks[idx / kObjectChunkSize][idx % kObjectChunkSize]; }
+
+  // not copyable - the scene owns its chunks and its objects point back at it
+  Scene( const Scene& );
+  Scene& operator=( const Scene& );
+
 private:
   void*                   m_pUserData;
   float                   m_fDeltaTimeSeconds;
@@ -390,7 +596,7 @@ private:
   Matrix                  m_mtxFrameTransform;
   float                   m_fFrameScale;
 
-  SceneObjectPtr          m_apObjects[kMaxObjects];
+  std::vector<SceneObjectPtr*> m_apObjectChunks;
   SceneRayHit             m_aRayHits[kMaxRayHits];
   SceneInteraction        m_aInteractionQueue[kInteractionQueueLength];
 
@@ -400,6 +606,108 @@ private:
   uint32_t                m_uiNumPendingRemovals;
   uint32_t                m_uiNextSerial;
   uint32_t                m_uiFlags;
+
+  /// pointable positions of the previous and of the current frame, for swept contact
+  std::vector<SceneContactPoint> m_aLastTipPoints;
+  std::vector<SceneContactPoint> m_aTipPoints;
+
+  /// the slot of a handle holds the index of its object.
+  /// removing an object bumps the generation of its slot so that its handles become invalid.
+  struct Slot
+  {
+    uint32_t              m_uiIndex;
+    uint32_t              m_uiGeneration;
+  };
+
+  enum { kInvalidIndex = 0xffffffff };
+
+  std::vector<Slot>       m_aSlots;
+  std::vector<uint32_t>   m_auiFreeSlots;
+
+  /// bounding volume hierarchy over the objects having bounds.
+  /// the node 0 is the root, the 2 children of an inner node are next to each other.
+  /// a leaf holds up to 4 objects of the same shape kernel in a block of 4 lanes,
+  /// so that a single batched kernel tests all of them at once.
+  struct BVHNode
+  {
+    SceneBounds           m_bounds;
+    uint32_t              m_uiParent;
+    uint32_t              m_uiFirst;          // first child of an inner node, first lane of a leaf
+    uint16_t              m_uiCount;          // number of objects of a leaf, 0 for an inner node
+    uint16_t              m_uiKernel;         // shape kernel of the objects of a leaf, see LeapScene.cpp
+  };
+
+  enum
+  {
+    kBVHLeafSize          = 4,
+    kBVHStackSize         = 64,
+    kBVHInvalidNode       = 0xffffffff
+  };
+
+  // the per object arrays are sized for the objects of the last build
+  std::vector<BVHNode>    m_aBVHNodes;
+  std::vector<SceneBounds> m_aObjectBounds;
+  std::vector<uint32_t>   m_auiBVHObjects;                  // object indices while building
+  std::vector<uint32_t>   m_auiObjectLeaves;                // leaf of each object, kBVHInvalidNode if it has no bounds
+  std::vector<uint32_t>   m_auiObjectLanes;                 // lane of each object
+  std::vector<uint8_t>    m_auiObjectKernels;               // shape kernel of each object
+  std::vector<uint32_t>   m_auiMovedObjects;                // objects moved since the last update
+  std::vector<BVHNode>    m_aUnboundedLeaves;               // leaves of the objects without bounds, tested by every query
+  std::vector<uint32_t>   m_auiLaneObjects;                 // object of each lane
+  std::vector<float>      m_afShapeLanes;                   // shapes of each block of 4 lanes, channel by channel
+  uint32_t                m_uiNumBVHNodes;
+  uint32_t                m_uiNumLanes;
+  uint32_t                m_uiNumRefitsSinceBuild;
+  bool                    m_bRebuildBVH;
+
+  /// spatial hash of the bounds of the objects for kCBP_SpatialHash.
+  /// an object is in the bucket of each cell its bounds cover.  several cells may share a bucket -
+  /// the entries keep the full hash of their cell and the bounds of their object
+  /// so that most of the objects of a bucket are skipped without looking at them.
+  /// the objects covering more than kGridMaxObjectCells cells are kept aside and tested by every query.
+  struct GridRange
+  {
+    int32_t               m_aiMin[3];
+    int32_t               m_aiMax[3];
+
+    uint64_t GetNumCells() const
+    {
+      return  static_cast<uint64_t>(m_aiMax[0] - m_aiMin[0] + 1) *
+              static_cast<uint64_t>(m_aiMax[1] - m_aiMin[1] + 1) *
+              static_cast<uint64_t>(m_aiMax[2] - m_aiMin[2] + 1);
+    }
+
+    bool operator==( const GridRange& other ) const
+    {
+      return  m_aiMin[0] == other.m_aiMin[0] && m_aiMin[1] == other.m_aiMin[1] && m_aiMin[2] == other.m_aiMin[2] &&
+              m_aiMax[0] == other.m_aiMax[0] && m_aiMax[1] == other.m_aiMax[1] && m_aiMax[2] == other.m_aiMax[2];
+    }
+
+    bool operator!=( const GridRange& other ) const { return !(*this == other); }
+  };
+
+  struct GridEntry
+  {
+    SceneBounds           m_bounds;
+    uint32_t              m_uiCell;
+    uint32_t              m_uiObject;
+  };
+
+  enum
+  {
+    kGridMaxObjectCells   = 64,
+    kGridMaxQueryCells    = 64,
+    kGridMinBuckets       = 64
+  };
+
+  eContactBroadPhase      m_contactBroadPhase;
+  float                   m_fContactCellSize;               // requested, 0 to pick it at each build
+  float                   m_fGridInvCellSize;               // of the current grid
+  std::vector< std::vector<GridEntry> > m_aaGridBuckets;    // a power of 2 of them
+  std::vector<GridRange>  m_aGridRanges;                    // cells of each bounded object
+  std::vector<uint32_t>   m_auiGridLargeObjects;            // objects covering more than kGridMaxObjectCells cells
+  std::vector<uint32_t>   m_auiGridStamps;                  // query that last tested each object
+  uint32_t                m_uiGridStamp;
 }; // Scene
 
 /// type identifier for scene objects
@@ -432,7 +740,7 @@ public:
   static eSceneObjectType NextObjectType()
   {
     static uint32_t s_nextID = kSOT_SceneObject + 1;
-    return static_cast<eSceneObjectType>( s_nextID + 1 );
+    return static_cast<eSceneObjectType>( s_nextID++ );
   }
 
   enum { kMaxContactPoints = 5 };
@@ -450,6 +758,7 @@ public:
       m_uiHasInitialContact(0),
       m_bSelected(false),
       m_bPendingRemoval(false),
+      m_bMoved(false),
       m_pScene(NULL)
   {}
 
@@ -463,6 +772,17 @@ public:
 
   LEAP_EXPORT virtual bool TestSphereHit(const Vector& vTestPoint, float fTestRadius) const = 0;
 
+  /// scene space bounds containing every point the hit tests above can report.
+  /// returns false for unbounded objects (e.g. planes).  the scene tests those against every ray and contact.
+  /// the default implementation returns false so that existing subclasses keep working unaccelerated.
+  LEAP_EXPORT virtual bool GetBounds(SceneBounds& boundsOut) const { (void)boundsOut; return false; }
+
+  /// tests a sphere moving from vFrom to vTo.  fTimeOut is the fraction of the motion at which
+  /// it first touches the object, 0 if it touches it from the start.
+  /// the default implementation steps TestSphereHit() along the motion, half a radius apart, within the bounds
+  /// and then narrows down the time of impact.  it may miss a contact grazing the swept volume between two steps.
+  LEAP_EXPORT virtual bool TestSweptSphereHit(const Vector& vFrom, const Vector& vTo, float fTestRadius, float& fTimeOut) const;
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
   LEAP_EXPORT virtual void DebugDrawGL( LeapUtilGL::eStyle drawStyle=LeapUtilGL::kStyle_Solid ) const = 0;
 #endif
@@ -499,28 +819,47 @@ public:
   /// a unique serial number assigned to each object at creation time.
   uint32_t GetSerial() const { return m_serial; }
 
+  /// the handle of the object in its scene, invalid once it is removed.  see Scene::GetObjectByHandle().
+  const SceneObjectHandle& GetHandle() const { return m_handle; }
+
   Scene* GetScene() const { return m_pScene; }
 
-  void Translate(const Vector& translation) { m_mtxTransform.origin += translation; }
+  /// tells the scene that the bounds of the object changed so that it refits them before its next hit test.
+  /// the transform and size setters call it.  a subclass changing m_mtxTransform, m_fScale
+  /// or its own shape directly has to call it as well.
+  void InvalidateBounds()
+  {
+    if ( m_pScene && !m_bMoved )
+    {
+      m_bMoved = true;
+      m_pScene->objectMoved( m_index );
+    }
+  }
+
+  void Translate(const Vector& translation) { m_mtxTransform.origin += translation; InvalidateBounds(); }
 
   void Rotate(const Vector& axis, float angleRadians)
   {
     m_mtxTransform =  m_mtxTransform * Matrix(axis, angleRadians);
+    InvalidateBounds();
   }
 
   void Rotate(const Matrix& rotationMatrix)
   {
     m_mtxTransform = m_mtxTransform * LeapUtil::ExtractRotation( rotationMatrix );
+    InvalidateBounds();
   }
 
   void Scale(float scaleMult)
   {
     m_fScale *= scaleMult;
+    InvalidateBounds();
   }
 
   void Transform( const Matrix& mtxTransform )
   {
     m_mtxTransform = m_mtxTransform * mtxTransform;
+    InvalidateBounds();
   }
 
   bool ApplyInteraction( const SceneInteraction& interaction )
@@ -553,19 +892,21 @@ public:
     return true;
   }
 
-  void SetCenter(const Vector& vCenter) { m_mtxTransform.origin = vCenter; }
+  void SetCenter(const Vector& vCenter) { m_mtxTransform.origin = vCenter; InvalidateBounds(); }
 
   void SetRotation(const Vector& vAxis, float fAngleRadians)
   {
     m_mtxTransform.setRotation( vAxis, fAngleRadians );
+    InvalidateBounds();
   }
 
   void SetRotation(const Matrix& rotationMatrix)
   {
     m_mtxTransform = Matrix( rotationMatrix.xBasis, rotationMatrix.yBasis, rotationMatrix.zBasis, m_mtxTransform.origin );
+    InvalidateBounds();
   }
 
-  void SetScale(float scale) { m_fScale = scale; }
+  void SetScale(float scale) { m_fScale = scale; InvalidateBounds(); }
 
   const Vector& GetCenter() const { return m_mtxTransform.origin; }
 
@@ -708,8 +1049,10 @@ protected:
 
 private:
   uint8_t             m_bPendingRemoval;
-  uint16_t            m_index;
+  uint8_t             m_bMoved;
+  uint32_t            m_index;
   uint32_t            m_serial;
+  SceneObjectHandle   m_handle;
   Scene*              m_pScene;
 }; // SceneObject
 
@@ -744,12 +1087,14 @@ public:
 
   const Vector& GetSize() const { return m_vSize; }
 
-  void SetSize( const Vector& vSize ) { m_vSize = vSize; }
+  void SetSize( const Vector& vSize ) { m_vSize = vSize; InvalidateBounds(); }
 
   LEAP_EXPORT virtual bool TestRayHit(const SceneRay& testRay, float& fHitDistOut) const;
 
   LEAP_EXPORT virtual bool TestSphereHit(const Vector& vTestPoint, float fTestRadius) const;
 
+  LEAP_EXPORT virtual bool GetBounds(SceneBounds& boundsOut) const;
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
   LEAP_EXPORT virtual void DebugDrawGL( LeapUtilGL::eStyle drawStyle=LeapUtilGL::kStyle_Solid ) const;
 #endif
@@ -772,9 +1117,9 @@ public:
 
   virtual ~SceneCylinder() {}
 
-  void SetRadius(float radius) { m_fRadius = radius; }
+  void SetRadius(float radius) { m_fRadius = radius; InvalidateBounds(); }
 
-  void SetHeight(float height) { m_fHeight = height; }
+  void SetHeight(float height) { m_fHeight = height; InvalidateBounds(); }
 
   const Vector& GetAxis() const { return m_mtxTransform.yBasis; }
 
@@ -786,6 +1131,8 @@ public:
 
   LEAP_EXPORT virtual bool TestSphereHit(const Vector& vTestPoint, float fTestRadius) const;
 
+  LEAP_EXPORT virtual bool GetBounds(SceneBounds& boundsOut) const;
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
   LEAP_EXPORT virtual void DebugDrawGL( LeapUtilGL::eStyle drawStyle=LeapUtilGL::kStyle_Solid ) const;
 #endif
@@ -809,7 +1156,7 @@ public:
 
   virtual ~SceneDisk() {}
 
-  void SetRadius(float radius) { m_fRadius = radius; }
+  void SetRadius(float radius) { m_fRadius = radius; InvalidateBounds(); }
 
   const Vector& GetNormal() const { return m_mtxTransform.zBasis; }
 
@@ -819,6 +1166,8 @@ public:
 
   LEAP_EXPORT virtual bool TestSphereHit(const Vector& vTestPoint, float fTestRadius) const;
 
+  LEAP_EXPORT virtual bool GetBounds(SceneBounds& boundsOut) const;
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
   LEAP_EXPORT virtual void DebugDrawGL( LeapUtilGL::eStyle drawStyle=LeapUtilGL::kStyle_Solid ) const;
 #endif
@@ -847,6 +1196,8 @@ public:
 
   LEAP_EXPORT virtual bool TestSphereHit(const Vector& vPoint, float fRadius) const;
 
+  LEAP_EXPORT virtual bool TestSweptSphereHit(const Vector& vFrom, const Vector& vTo, float fTestRadius, float& fTimeOut) const;
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
   LEAP_EXPORT virtual void DebugDrawGL( LeapUtilGL::eStyle drawStyle=LeapUtilGL::kStyle_Solid ) const;
 #endif
@@ -866,7 +1217,7 @@ public:
 
   virtual ~SceneSphere() {}
 
-  void SetRadius(const float& radius) { m_fRadius = radius; }
+  void SetRadius(const float& radius) { m_fRadius = radius; InvalidateBounds(); }
 
   float GetRadius() const { return m_fRadius; }
 
@@ -874,6 +1225,10 @@ public:
 
   LEAP_EXPORT virtual bool TestSphereHit(const Vector& vTestCenter, float fTestRadius) const;
 
+  LEAP_EXPORT virtual bool TestSweptSphereHit(const Vector& vFrom, const Vector& vTo, float fTestRadius, float& fTimeOut) const;
+
+  LEAP_EXPORT virtual bool GetBounds(SceneBounds& boundsOut) const;
+
 #if defined(LEAP_SCENE_USE_UTIL_GL)
   LEAP_EXPORT virtual void DebugDrawGL( LeapUtilGL::eStyle drawStyle=LeapUtilGL::kStyle_Solid ) const;
 #endif
@@ -11,6 +11,8 @@
 
 #include "Leap.h"
 
+#include <vector>
+
 // Define integer types for Visual Studio 2005
 #if defined(_MSC_VER) && (_MSC_VER < 1600)
 typedef __int8 int8_t;
@@ -637,23 +639,121 @@ private:
   {
     ManagedType*  m_pPointer;
     uint32_t      m_uiRefCount;
+    uint32_t      m_uiIndex;
   };
 
   // this private, embedded class manages a pool of smart pointers for the given type.
   // there are separate pools for each created type of smart pointer.
-  // the pool is managed using a simple O(1) fixed size free list allocator
+  // the pool is managed using a simple O(1) free list allocator over chunks of kPoolSize entries.
+  // a chunk is added when every entry is in use.  entries never move so smart pointers can keep theirs.
+  // live entries are also indexed by raw pointer in an open addressing hash table so that
+  // creating a smart pointer from a raw pointer does not search the whole pool.
   struct ManagedPointerPool
   {
-    enum { kPoolSize = kManagedPointerPoolSize, kDeadPointer = 0xdeadbea7 };
+    enum { kPoolSize = kManagedPointerPoolSize, kDeadPointer = 0xdeadbea7, kNoFreeEntry = 0xffffffff };
 
     ManagedPointerPool()
-      : m_uiNextFree(0),
+      : m_uiNextFree(kNoFreeEntry),
         m_uiNumAllocated(0)
     {
+    }
+
+    // the chunks are not freed when the pool is destroyed.
+    // smart pointers held by static objects may be released after it.
+
+    ManagedPointerEntry* getEntry( uint32_t entryIndex )
+    {
+      return m_apChunks[entryIndex / kPoolSize] + (entryIndex % kPoolSize);
+    }
+
+    // first hash table slot to probe for a raw pointer. the table size is a power of two.
+    uint32_t hashSlot( const ManagedType* pPointer ) const
+    {
+      const size_t key = reinterpret_cast<size_t>(pPointer);
+
+      return static_cast<uint32_t>(((key >> 4) ^ (key >> 16)) * 2654435761u) & (static_cast<uint32_t>(m_auiTable.size()) - 1);
+    }
+
+    // index a live entry by its raw pointer
+    void hashInsert( const ManagedPointerEntry* pEntry )
+    {
+      const uint32_t mask = static_cast<uint32_t>(m_auiTable.size()) - 1;
+      uint32_t       slot = hashSlot( pEntry->m_pPointer );
+
+      while ( m_auiTable[slot] != kNoFreeEntry )
+      {
+        slot = (slot + 1) & mask;
+      }
+
+      m_auiTable[slot] = pEntry->m_uiIndex;
+    }
+
+    // remove a live entry from the hash table.
+    // the entries that follow it in its probe run are shifted back so that no tombstones are needed.
+    void hashRemove( const ManagedPointerEntry* pEntry )
+    {
+      const uint32_t mask = static_cast<uint32_t>(m_auiTable.size()) - 1;
+      uint32_t       slot = hashSlot( pEntry->m_pPointer );
+
+      while ( m_auiTable[slot] != pEntry->m_uiIndex )
+      {
+        if ( m_auiTable[slot] == kNoFreeEntry )
+        {
+          return;
+        }
+
+        slot = (slot + 1) & mask;
+      }
+
+      for ( uint32_t next = (slot + 1) & mask; m_auiTable[next] != kNoFreeEntry; next = (next + 1) & mask )
+      {
+        // an entry can move back to the hole only if its home slot is not between the hole and itself
+        const uint32_t home = hashSlot( getEntry( m_auiTable[next] )->m_pPointer );
+
+        if ( ((next - home) & mask) >= ((next - slot) & mask) )
+        {
+          m_auiTable[slot] = m_auiTable[next];
+          slot = next;
+        }
+      }
+
+      m_auiTable[slot] = kNoFreeEntry;
+    }
+
+    // add a chunk of entries to the head of the free list
+    void addChunk()
+    {
+      const uint32_t        firstIndex  = static_cast<uint32_t>(m_apChunks.size()) * kPoolSize;
+      ManagedPointerEntry*  pChunk      = new ManagedPointerEntry[kPoolSize];
+
       for ( uint32_t i = 0; i < static_cast<uint32_t>(kPoolSize); i++ )
       {
-        m_aEntryPool[i].m_pPointer    = reinterpret_cast<ManagedType*>(kDeadPointer);
-        m_aEntryPool[i].m_uiRefCount  = i + 1;
+        pChunk[i].m_pPointer    = reinterpret_cast<ManagedType*>(kDeadPointer);
+        pChunk[i].m_uiRefCount  = (i + 1 < static_cast<uint32_t>(kPoolSize)) ? firstIndex + i + 1 : m_uiNextFree;
+        pChunk[i].m_uiIndex     = firstIndex + i;
+      }
+
+      m_apChunks.push_back( pChunk );
+      m_uiNextFree = firstIndex;
+
+      // keep the hash table at most half full and index the live entries again
+      uint32_t tableSize = 16;
+
+      while ( tableSize < (firstIndex + kPoolSize) * 2 )
+      {
+        tableSize *= 2;
+      }
+
+      m_auiTable.assign( tableSize, kNoFreeEntry );
+
+      for ( uint32_t i = 0; i < firstIndex; i++ )
+      {
+        const ManagedPointerEntry* pEntry = getEntry( i );
+
+        if ( pEntry->m_pPointer != reinterpret_cast<ManagedType*>(kDeadPointer) )
+        {
+          hashInsert( pEntry );
+        }
       }
     }
 
@@ -662,7 +762,7 @@ private:
     {
       ManagedPointerEntry* pEntry = NULL;
 
-      // this incurs a linear search penalty each time
+      // this incurs a hash table lookup each time
       // we create a new smart pointer from a raw pointer
       // but adds significant safety - it prevents
       // assigning the same raw pointer to two different
@@ -675,10 +775,15 @@ private:
         // we found an existing managed pointer entry, just increase the reference count
         pEntry->m_uiRefCount++;
       }
-      else if ( (m_uiNextFree < kPoolSize) && pPointer )
+      else if ( pPointer )
       {
+        if ( m_uiNextFree == kNoFreeEntry )
+        {
+          addChunk();
+        }
+
         // grab the next free entry from the head of the free list
-        pEntry = m_aEntryPool + m_uiNextFree;
+        pEntry = getEntry( m_uiNextFree );
 
         // the head of the list now becomes the next free entry in the chain
         // (m_uiRefCount is serving double-duty as next index member for entries that are still in the pool)
@@ -688,6 +793,8 @@ private:
         pEntry->m_pPointer = pPointer;
         pEntry->m_uiRefCount = 1;
 
+        hashInsert( pEntry );
+
         // book keeping.
         m_uiNumAllocated++;
       }
@@ -698,16 +805,19 @@ private:
     // return an entry to the pool
     void freeEntry( ManagedPointerEntry* pEntry )
     {
-      // calculate the entry index as an offset from the start of the pool
-      const uint32_t entryIndex = static_cast<uint32_t>(pEntry - m_aEntryPool);
+      // the entry knows its own index
+      const uint32_t entryIndex = pEntry->m_uiIndex;
 
       // if this is a valid allocated entry (from this pool, and not already freed)
-      if (  (entryIndex < kPoolSize)  &&
+      if (  (entryIndex < static_cast<uint32_t>(m_apChunks.size()) * kPoolSize) &&
+            (getEntry( entryIndex ) == pEntry) &&
             (m_uiNumAllocated != 0)   &&
             (pEntry->m_pPointer != reinterpret_cast<ManagedType*>(kDeadPointer)) )
       {
-        // clear the entry
-        pEntry->m_pPointer = NULL;
+        hashRemove( pEntry );
+
+        // mark the entry dead so that lookups skip it
+        pEntry->m_pPointer = reinterpret_cast<ManagedType*>(kDeadPointer);
 
         // push it to the head of the free list
         pEntry->m_uiRefCount = m_uiNextFree;
@@ -722,24 +832,20 @@ private:
     // if pPointer is NULL, dead or not found.
     ManagedPointerEntry* findEntry( const ManagedType* pPointer )
     {
-      // don't bother if the pointer is NULL or marked as our dead value
-      if ( pPointer && (pPointer != reinterpret_cast<ManagedType*>(kDeadPointer)) )
+      // don't bother if the pointer is NULL, marked as our dead value or nothing has been allocated yet
+      if ( pPointer && (pPointer != reinterpret_cast<ManagedType*>(kDeadPointer)) && !m_auiTable.empty() )
       {
-        // linear search. stop after testing as many live entries as are allocated instead of always
-        // searching the entire pool.
-        for ( uint32_t i = 0, j = 0; j < m_uiNumAllocated && i < static_cast<uint32_t>(kPoolSize); i++ )
+        // probe from the home slot of the pointer until an empty slot ends the run
+        const uint32_t mask = static_cast<uint32_t>(m_auiTable.size()) - 1;
+
+        for ( uint32_t slot = hashSlot( pPointer ); m_auiTable[slot] != kNoFreeEntry; slot = (slot + 1) & mask )
         {
-          // if the entry is live (allocated)
-          if ( m_aEntryPool[i].m_pPointer != reinterpret_cast<ManagedType*>(kDeadPointer) )
+          ManagedPointerEntry* pEntry = getEntry( m_auiTable[slot] );
+
+          // a match? return it.
+          if ( pEntry->m_pPointer == pPointer )
           {
-            // a match? return it.
-            if ( m_aEntryPool[i].m_pPointer == pPointer )
-            {
-              return m_aEntryPool + i;
-            }
-
-            // not, increment the count of live entries encountered.
-            j++;
+            return pEntry;
           }
         }
       }
@@ -750,11 +856,14 @@ private:
     // number of allocated managed pointer entries
     uint32_t getNumAllocated() const { return m_uiNumAllocated; }
 
-    // number of available managed pointer entries.
-    uint32_t getNumFree() const { return static_cast<uint32_t>(kPoolSize) - m_uiNumAllocated; }
+    // number of available managed pointer entries before another chunk is added.
+    uint32_t getNumFree() const { return static_cast<uint32_t>(m_apChunks.size()) * kPoolSize - m_uiNumAllocated; }
+
+    // chunks of kPoolSize entries
+    std::vector<ManagedPointerEntry*> m_apChunks;
 
-    // actual entry pool
-    ManagedPointerEntry m_aEntryPool[kPoolSize];
+    // indices of the live entries hashed by raw pointer, kNoFreeEntry for an empty slot
+    std::vector<uint32_t> m_auiTable;
 
     // head of the free list
     uint32_t            m_uiNextFree;
@@ -892,7 +1001,7 @@ public:
   }
 
   /// returns the number of raw pointers of this type under management.
-  /// use SmartPointer::kManagedPointerPoolSize to get the total number of pointers of this type that can be managed.
+  /// there is no limit - entries are added SmartPointer::kManagedPointerPoolSize at a time.
   static uint32_t GetNumManagedPointers() { return s_pool().getNumAllocated(); }
 
 private: